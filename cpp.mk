@@ -28,9 +28,14 @@ FLAGS_64=-mpreferred-stack-boundary=4 $(ENABLE_SSE_FLAGS) $(DISABLE_AVX_FLAGS)
 # Activate Stack Smashing Protection
 FLAGS_64 += -fstack-protector
 
-KERNEL_CPP_FLAGS_64=$(COMMON_CPP_FLAGS) $(FLAGS_64)
+# The kernel does not use the FPU/SSE registers, they only hold the state
+# of the user processes and are switched lazily
+KERNEL_FLAGS_64=-mpreferred-stack-boundary=4 $(DISABLE_SSE_FLAGS) $(DISABLE_AVX_FLAGS) -mno-80387 -fstack-protector
 
-ACPICA_C_FLAGS= $(COMMON_C_FLAGS) $(FLAGS_64) -include include/thor_acenv.hpp -include include/thor_acenvex.hpp
+# Keep the frame pointers for the stacks of the profiler
+KERNEL_CPP_FLAGS_64=$(COMMON_CPP_FLAGS) $(KERNEL_FLAGS_64) -fno-omit-frame-pointer
+
+ACPICA_C_FLAGS= $(COMMON_C_FLAGS) $(KERNEL_FLAGS_64) -include include/thor_acenv.hpp -include include/thor_acenvex.hpp
 
 COMMON_LINK_FLAGS=-lgcc
 
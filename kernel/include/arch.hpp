@@ -5,6 +5,9 @@
 //  http://www.opensource.org/licenses/MIT)
 //=======================================================================
 
+#ifndef ARCH_H
+#define ARCH_H
+
 #include <types.hpp>
 
 namespace arch {
@@ -30,4 +33,87 @@ inline bool interrupts_enabled(){
     return flags & 0x200;
 }
 
+inline uint64_t read_msr(uint32_t msr){
+    uint32_t low;
+    uint32_t high;
+    asm volatile("rdmsr" : "=a" (low), "=d" (high) : "c" (msr));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+inline void write_msr(uint32_t msr, uint64_t value){
+    asm volatile("wrmsr" : : "c" (msr), "a" (static_cast<uint32_t>(value)), "d" (static_cast<uint32_t>(value >> 32)));
+}
+
+inline uint64_t get_cr3(){
+    uint64_t value;
+    asm volatile("mov %0, cr3" : "=r" (value));
+    return value;
+}
+
+inline void pause(){
+    asm volatile("pause" : : : "memory");
+}
+
+/*!
+ * \brief Set CR0.TS, the next FPU/SSE instruction will raise #NM
+ */
+inline void set_task_switched(){
+    uint64_t value;
+    asm volatile("mov %0, cr0" : "=r" (value));
+    asm volatile("mov cr0, %0" : : "r" (value | 0x8) : "memory");
+}
+
+/*!
+ * \brief Clear CR0.TS
+ */
+inline void clear_task_switched(){
+    asm volatile("clts" : : : "memory");
+}
+
+/*!
+ * \brief Indicates if CR0.TS is set
+ */
+inline bool task_switched(){
+    uint64_t value;
+    asm volatile("mov %0, cr0" : "=r" (value));
+    return value & 0x8;
+}
+
+/*!
+ * \brief Save the FPU/SSE state in the given 16-bytes aligned area
+ */
+inline void fxsave(void* area){
+    asm volatile("fxsave [%0]" : : "r" (area) : "memory");
+}
+
+/*!
+ * \brief Reset the FPU/SSE state, with all the exceptions masked
+ */
+inline void reset_fpu(){
+    uint32_t mxcsr = 0x1F80;
+    asm volatile("fninit; ldmxcsr %0" : : "m" (mxcsr) : "memory");
+}
+
+inline void cpuid(uint32_t leaf, uint32_t& eax, uint32_t& ebx, uint32_t& ecx, uint32_t& edx){
+    asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (leaf), "c" (0));
+}
+
+inline uint64_t rdtsc(){
+    uint32_t low;
+    uint32_t high;
+    asm volatile("rdtsc" : "=a" (low), "=d" (high));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+/*!
+ * \brief Returns the value of IA32_TSC_AUX, read with RDTSCP
+ */
+inline uint32_t tsc_aux(){
+    uint32_t aux;
+    asm volatile("rdtscp" : "=c" (aux) : : "rax", "rdx");
+    return aux;
+}
+
 } //enf of arch namespace
+
+#endif
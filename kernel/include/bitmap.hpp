@@ -10,23 +10,47 @@
 
 #include "assert.hpp"
 
+/*!
+ * \brief A bitmap over external storage where set bits are free.
+ *
+ * Two summaries, with one bit per word, track the words that have at
+ * least one set bit and the words that are completely set, so that
+ * searches only scan one word out of 64.
+ */
 struct static_bitmap {
     typedef uint64_t data_type;
 
     static constexpr const size_t bits_per_word = sizeof(data_type) * 8;
+    static constexpr const size_t npos = ~static_cast<size_t>(0); ///< Indicates that no bit was found
 
     size_t words;
     data_type* data;
+    data_type* free_summary; ///< One bit per word with at least one set bit
+    data_type* full_summary; ///< One bit per word with all bits set
+
+    /*!
+     * \brief Returns the number of summary words needed for the given number of words
+     */
+    static constexpr size_t summary_words(size_t words){
+        return (words + bits_per_word - 1) / bits_per_word;
+    }
 
-    template<typename Array>
-    void init(Array& array){
-        words = array.size();
-        data = array.data();
+    /*!
+     * \brief Returns the number of words of storage to give to init() for
+     * a bitmap of the given number of words
+     */
+    static constexpr size_t storage_words(size_t words){
+        return words + 2 * summary_words(words);
     }
 
+    /*!
+     * \brief Init the bitmap with w words, d must hold storage_words(w) words
+     */
     void init(size_t w, data_type* d){
         words = w;
         data = d;
+        free_summary = d + w;
+        full_summary = free_summary + summary_words(w);
     }
 
     static constexpr size_t word_offset(size_t bit){
@@ -45,32 +69,82 @@ struct static_bitmap {
         for(size_t i = 0; i < words; ++i){
             data[i] = 0;
         }
+
+        for(size_t s = 0; s < summary_words(words); ++s){
+            free_summary[s] = 0;
+            full_summary[s] = 0;
+        }
     }
 
     void set_all(){
         for(size_t i = 0; i < words; ++i){
             data[i] = ~static_cast<data_type>(0);
         }
+
+        // Only the bits of existing words are set in the summaries
+        for(size_t s = 0; s < summary_words(words); ++s){
+            auto remaining = words - s * bits_per_word;
+            auto mask = remaining >= bits_per_word ? ~static_cast<data_type>(0) : bit_mask(remaining) - 1;
+
+            free_summary[s] = mask;
+            full_summary[s] = mask;
+        }
     }
 
     size_t free_bit() const {
+        for(size_t s = 0; s < summary_words(words); ++s){
+            if(free_summary[s]){
+                auto w = s * bits_per_word + __builtin_ctzll(free_summary[s]);
+
+                return w * bits_per_word + __builtin_ctzll(data[w]);
+            }
+        }
+
+        thor_unreachable("static_bitmap has no free bit");
+    }
+
+    /*!
+     * \brief Returns the first bit of a run of count set bits, or npos if
+     * there is no such run
+     */
+    size_t free_run(size_t count) const {
+        size_t run = 0;
+
         for(size_t w = 0; w < words; ++w){
-            if(data[w] > 0){
-                for(size_t b = 0; b < bits_per_word; ++b){
-                    if(data[w] & bit_mask(b)){
-                        return w * bits_per_word + b;
+            // Skip the full words directly
+            if(data[w] == ~static_cast<data_type>(0)){
+                run += bits_per_word;
+
+                if(run >= count){
+                    return (w + 1) * bits_per_word - run;
+                }
+
+                continue;
+            }
+
+            if(data[w] == 0){
+                run = 0;
+                continue;
+            }
+
+            for(size_t b = 0; b < bits_per_word; ++b){
+                if(data[w] & bit_mask(b)){
+                    if(++run == count){
+                        return w * bits_per_word + b + 1 - count;
                     }
+                } else {
+                    run = 0;
                 }
             }
         }
 
-        thor_unreachable("static_bitmap has no free bit");
+        return npos;
     }
 
     size_t free_word() const {
-        for(size_t w = 0; w < words; ++w){
-            if(data[w] == ~static_cast<data_type>(0)){
-                return w * bits_per_word;
+        for(size_t s = 0; s < summary_words(words); ++s){
+            if(full_summary[s]){
+                return (s * bits_per_word + __builtin_ctzll(full_summary[s])) * bits_per_word;
             }
         }
 
@@ -82,11 +156,33 @@ struct static_bitmap {
     }
 
     void set(size_t bit){
-        data[word_offset(bit)] |= bit_mask(bit);
+        auto w = word_offset(bit);
+        data[w] |= bit_mask(bit);
+        update_summary(w);
     }
 
     void unset(size_t bit){
-        data[word_offset(bit)] &= ~bit_mask(bit);
+        auto w = word_offset(bit);
+        data[w] &= ~bit_mask(bit);
+        update_summary(w);
+    }
+
+private:
+    void update_summary(size_t w){
+        auto s = word_offset(w);
+        auto mask = bit_mask(w);
+
+        if(data[w]){
+            free_summary[s] |= mask;
+        } else {
+            free_summary[s] &= ~mask;
+        }
+
+        if(data[w] == ~static_cast<data_type>(0)){
+            full_summary[s] |= mask;
+        } else {
+            full_summary[s] &= ~mask;
+        }
     }
 };
 
@@ -49,9 +49,28 @@ public:
     size_t allocate(size_t pages){
         if(pages > max_block){
             if(pages > max_block * static_bitmap::bits_per_word){
-                logging::logf(logging::log_level::ERROR, "buddy: Impossible to allocate more than 33M block:%u\n", pages);
-                //TODO Implement larger allocation
-                return 0;
+                // Find a run of free blocks at the highest level
+                auto l = levels - 1;
+                auto blocks = top_blocks(pages);
+                auto index = bitmaps[l].free_run(blocks);
+
+                if(index == static_bitmap::npos){
+                    logging::logf(logging::log_level::ERROR, "buddy: No contiguous space for %u blocks\n", pages);
+                    return 0;
+                }
+
+                auto address = block_start(l, index);
+
+                if(address + blocks * level_size(l) * Unit >= last_address){
+                    logging::logf(logging::log_level::ERROR, "buddy: Address too high level:%u index:%u address:%h\n", l, index, address);
+                    return 0;
+                }
+
+                for(size_t b = 0; b < blocks; ++b){
+                    mark_used(l, index + b);
+                }
+
+                return address;
             } else {
                 // Select a level for which a whole word can hold the necessary pages
                 auto l = word_level(pages);
@@ -89,10 +108,15 @@ public:
     void free(size_t address, size_t pages){
         if(pages > max_block){
             if(pages > max_block * static_bitmap::bits_per_word){
-                logging::logf(logging::log_level::ERROR, "buddy: Impossible to free more than 33M block:%u\n", pages);
-                //TODO Implement larger allocation
+                auto l = levels - 1;
+                auto blocks = top_blocks(pages);
+                auto index = get_block_index(address, l);
+
+                for(size_t b = 0; b < blocks; ++b){
+                    mark_free(l, index + b);
+                }
             } else {
-                auto l = level(pages);
+                auto l = word_level(pages);
                 auto index = get_block_index(address, l);
 
                 //Mark all bits of the word as free
@@ -118,6 +142,21 @@ public:
         return size;
     }
 
+    /*!
+     * \brief Returns the number of units reserved by an allocation of the given number of units
+     */
+    static size_t allocated_units(size_t pages){
+        if(pages > max_block){
+            if(pages > max_block * static_bitmap::bits_per_word){
+                return top_blocks(pages) * max_block;
+            } else {
+                return level_size(word_level(pages)) * static_bitmap::bits_per_word;
+            }
+        } else {
+            return level_size(level(pages));
+        }
+    }
+
 private:
     static size_t level(size_t pages){
         if(pages > 64){
@@ -139,7 +178,11 @@ private:
         }
     }
 
-    size_t word_level(size_t pages) const {
+    static size_t top_blocks(size_t pages){
+        return (pages + max_block - 1) / max_block;
+    }
+
+    static size_t word_level(size_t pages){
         size_t size = 1;
 
         for(size_t i = 0; i < levels; ++i){
@@ -0,0 +1,73 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef INT_SPINLOCK_HPP
+#define INT_SPINLOCK_HPP
+
+#include <types.hpp>
+
+#include "arch.hpp"
+#include "conc/spinlock.hpp"
+
+/*!
+ * \brief An interrupt spinlock. This lock disable preemption on the
+ * current processor and then spins until the other processors release
+ * the lock.
+ *
+ * This must be used to protect data accessed by several processors
+ * and by interrupt handlers.
+ */
+struct int_spinlock {
+    /*!
+     * \brief Acquire the lock.
+     *
+     * This will wait indefinitely.
+     */
+    void lock() {
+        size_t flags;
+        arch::disable_hwint(flags);
+
+        spin.lock();
+
+        rflags = flags;
+    }
+
+    /*!
+     * \brief Try to acquire the lock.
+     * \return true if the lock has been acquired, false otherwise
+     */
+    bool try_lock() {
+        size_t flags;
+        arch::disable_hwint(flags);
+
+        if(spin.try_lock()){
+            rflags = flags;
+            return true;
+        }
+
+        arch::enable_hwint(flags);
+
+        return false;
+    }
+
+    /*!
+     * \brief Release the lock. This will enable preemption.
+     */
+    void unlock() {
+        auto flags = rflags;
+
+        spin.unlock();
+
+        arch::enable_hwint(flags);
+    }
+
+private:
+    spinlock spin; ///< The lock shared between processors
+    size_t rflags; ///< The CPU flags of the owner
+};
+
+#endif
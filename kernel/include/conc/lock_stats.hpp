@@ -0,0 +1,50 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef LOCK_STATS_H
+#define LOCK_STATS_H
+
+#include <types.hpp>
+
+/*!
+ * \brief Contention counters of the sleeping locks, exported in /sys/locks
+ */
+namespace lock_stats {
+
+/*!
+ * \brief Register the counters in sysfs
+ */
+void init();
+
+/*!
+ * \brief Indicates that a process had to wait for a mutex
+ */
+void mutex_contended();
+
+/*!
+ * \brief Indicates that a mutex was acquired by spinning, without blocking
+ */
+void mutex_spun();
+
+/*!
+ * \brief Indicates that the owner of a mutex inherited the priority of a waiter
+ */
+void mutex_boosted();
+
+/*!
+ * \brief Indicates that a process had to wait for a rw_lock
+ */
+void rw_lock_contended();
+
+/*!
+ * \brief Indicates that the writer of a rw_lock inherited the priority of a waiter
+ */
+void rw_lock_boosted();
+
+} //end of namespace lock_stats
+
+#endif
@@ -12,6 +12,7 @@
 #include <lock_guard.hpp>
 
 #include "conc/spinlock.hpp"
+#include "conc/lock_stats.hpp"
 
 #include "scheduler.hpp"
 #include "logging.hpp"
@@ -21,6 +22,13 @@
  *
  * Once the lock is acquired, the critical section is only accessible by the
  * thread who acquired the mutex.
+ *
+ * The mutex is adaptive: while the owner is running on another processor,
+ * it is likely to release the lock soon and the waiter spins for a bounded
+ * time before blocking.
+ *
+ * The owner of the mutex inherits the priority of the waiters and the mutex
+ * is handed to the waiter with the highest priority.
  */
 struct mutex {
     /*!
@@ -39,19 +47,37 @@ struct mutex {
      * \brief Acquire the lock
      */
     void lock() {
+        if (spin()) {
+            return;
+        }
+
         value_lock.lock();
 
+        auto pid = scheduler::get_pid();
+
         if (value > 0) {
             value = 0;
+            owner = pid;
 
             value_lock.unlock();
         } else {
-            auto pid = scheduler::get_pid();
             queue.push(pid);
 
+            lock_stats::mutex_contended();
+
+            // The owner runs with our priority until it releases the lock
+            if (owner != scheduler::INVALID_PID && scheduler::is_started()) {
+                if (scheduler::boost_priority(owner, scheduler::get_process(pid).priority)) {
+                    ++boosts;
+                    lock_stats::mutex_boosted();
+                }
+            }
+
             scheduler::block_process_light(pid);
             value_lock.unlock();
             scheduler::reschedule();
+
+            //The owner was set by unlock()
         }
     }
 
@@ -67,6 +93,7 @@ struct mutex {
 
         if (value > 0) {
             value = 0;
+            owner = scheduler::get_pid();
 
             return true;
         } else {
@@ -78,16 +105,30 @@ struct mutex {
      * \brief Release the lock
      */
     void unlock() {
-        std::lock_guard<spinlock> l(value_lock);
+        size_t restore;
 
-        if (queue.empty()) {
-            value = 1;
-        } else {
-            auto pid = queue.pop();
-            scheduler::unblock_process(pid);
+        {
+            std::lock_guard<spinlock> l(value_lock);
 
-            //No need to increment value, the process won't
-            //decrement it
+            restore = boosts;
+            boosts = 0;
+
+            if (queue.empty()) {
+                value = 1;
+                owner = scheduler::INVALID_PID;
+            } else {
+                auto pid = pop_waiter();
+                owner = pid;
+                scheduler::unblock_process(pid);
+
+                //No need to increment value, the process won't
+                //decrement it
+            }
+        }
+
+        // Give back the priority inherited from the waiters
+        if (restore) {
+            scheduler::restore_priority(restore);
         }
     }
 
@@ -99,8 +140,10 @@ struct mutex {
 
         if (queue.empty()) {
             value = 1;
+            owner = scheduler::INVALID_PID;
         } else {
-            auto pid = queue.pop();
+            auto pid = pop_waiter();
+            owner = pid;
             scheduler::unblock_process_hint(pid);
 
             //No need to increment value, the process won't
@@ -109,9 +152,68 @@ struct mutex {
     }
 
 private:
-    mutable spinlock value_lock;                 ///< The spin protecting the value
-    volatile size_t value = 1;                   ///< The value of the mutex
-    circular_buffer<scheduler::pid_t, 16> queue; ///< The sleep queue
+    static constexpr const size_t SPIN_LIMIT = 1024; ///< The maximum number of spins before blocking
+
+    /*!
+     * \brief Try to acquire the lock while the owner is running on
+     * another processor.
+     *
+     * \return true if the lock was acquired, false otherwise.
+     */
+    bool spin() {
+        for (size_t i = 0; i < SPIN_LIMIT; ++i) {
+            if (value > 0 && try_lock()) {
+                if (i) {
+                    lock_stats::mutex_spun();
+                }
+
+                return true;
+            }
+
+            auto current = owner;
+
+            if (current == scheduler::INVALID_PID || !scheduler::is_started() || !scheduler::is_running_remotely(current)) {
+                return false;
+            }
+
+            arch::pause();
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Remove the first waiter with the highest priority from the queue
+     */
+    scheduler::pid_t pop_waiter() {
+        scheduler::pid_t waiters[16];
+        size_t n = 0;
+        size_t best = 0;
+
+        while (!queue.empty()) {
+            waiters[n] = queue.pop();
+
+            if (scheduler::get_process(waiters[n]).priority > scheduler::get_process(waiters[best]).priority) {
+                best = n;
+            }
+
+            ++n;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            if (i != best) {
+                queue.push(waiters[i]);
+            }
+        }
+
+        return waiters[best];
+    }
+
+    mutable spinlock value_lock;                     ///< The spin protecting the value
+    volatile size_t value = 1;                       ///< The value of the mutex
+    scheduler::pid_t owner = scheduler::INVALID_PID; ///< The process holding the mutex
+    size_t boosts = 0;                               ///< The number of inheritances of the owner from this mutex
+    circular_buffer<scheduler::pid_t, 16> queue;     ///< The sleep queue
 };
 
 #endif
@@ -10,6 +10,7 @@
 
 #include "conc/mutex.hpp"
 #include "conc/condition_variable.hpp"
+#include "conc/lock_stats.hpp"
 
 struct rw_lock;
 
@@ -71,7 +72,7 @@ private:
  * \brief A Read/Write lock implementation.
  *
  * There can be multiple readers, but only one writer. The writer has exclusive
- * access.
+ * access and inherits the priority of the processes waiting for it.
  */
 struct rw_lock final {
     /*!
@@ -80,6 +81,10 @@ struct rw_lock final {
     void read_lock(){
         m.lock();
 
+        if(writer){
+            contended();
+        }
+
         while(writer){
             m.unlock();
             write.wait();
@@ -113,6 +118,10 @@ struct rw_lock final {
     void write_lock(){
         m.lock();
 
+        if(writer || readers){
+            contended();
+        }
+
         while(writer || readers){
             m.unlock();
             write.wait();
@@ -120,6 +129,7 @@ struct rw_lock final {
         }
 
         writer = true;
+        writer_pid = scheduler::get_pid();
 
         m.unlock();
     }
@@ -131,11 +141,20 @@ struct rw_lock final {
         m.lock();
 
         writer = false;
+        writer_pid = scheduler::INVALID_PID;
+
+        auto restore = boosts;
+        boosts = 0;
 
         // Notify all writers and readers
         write.notify_all();
 
         m.unlock();
+
+        // Give back the priority inherited from the waiters
+        if(restore){
+            scheduler::restore_priority(restore);
+        }
     }
 
     /*!
@@ -153,10 +172,26 @@ struct rw_lock final {
     }
 
 private:
-    condition_variable write; ///< The write condition variable
-    mutex m;                  ///< Mutex protecting the counter
-    size_t readers = 0;       ///< Number of readers
-    bool writer    = false;   ///< Boolean flag indicating if there is a writer
+    /*!
+     * \brief Account for a wait and lend the priority of the current
+     * process to the writer. Must be called with m held.
+     */
+    void contended(){
+        lock_stats::rw_lock_contended();
+
+        // The readers are not tracked, only the writer can inherit
+        if(writer && scheduler::boost_priority(writer_pid, scheduler::get_process(scheduler::get_pid()).priority)){
+            ++boosts;
+            lock_stats::rw_lock_boosted();
+        }
+    }
+
+    condition_variable write;                             ///< The write condition variable
+    mutex m;                                              ///< Mutex protecting the counter
+    size_t readers = 0;                                   ///< Number of readers
+    bool writer    = false;                               ///< Boolean flag indicating if there is a writer
+    scheduler::pid_t writer_pid = scheduler::INVALID_PID; ///< The process holding the lock for writing
+    size_t boosts = 0;                                    ///< The number of inheritances of the writer from this lock
 };
 
 inline void writer_rw_lock::lock(){
@@ -8,10 +8,17 @@
 #ifndef SPINLOCK_H
 #define SPINLOCK_H
 
+#include <types.hpp>
+
+#include "arch.hpp"
+#include "tlb.hpp"
+
 /*!
  * \brief Implementation of a spinlock
  *
- * A spinlock simply waits in a loop until the lock is available.
+ * A spinlock simply waits in a loop until the lock is available. This is
+ * a ticket lock: the processors acquire the lock in the order they
+ * arrived and only read the shared line while waiting.
  */
 struct spinlock {
     /*!
@@ -20,19 +27,26 @@ struct spinlock {
      * This will wait indefinitely.
      */
     void lock() {
-        while (!__sync_bool_compare_and_swap(&value, 0, 1))
-            ;
+        auto ticket = __sync_fetch_and_add(&next, 1);
+
+        while (owner != ticket) {
+            // The owner may be waiting for this processor to invalidate its TLB
+            tlb::poll();
+            arch::pause();
+        }
+
         __sync_synchronize();
-        //TODO The last synchronize is probably not necessary
     }
 
     /*!
-     * \brief Acquire the lock.
-     *
-     * This will wait indefinitely.
+     * \brief Try to acquire the lock.
+     * \return true if the lock has been acquired, false otherwise
      */
     bool try_lock() {
-        if(__sync_bool_compare_and_swap(&value, 0, 1)){
+        auto ticket = owner;
+
+        // The lock is free only if nobody took a ticket after the owner
+        if(__sync_bool_compare_and_swap(&next, ticket, ticket + 1)){
             __sync_synchronize();
             return true;
         }
@@ -45,11 +59,12 @@ struct spinlock {
      */
     void unlock() {
         __sync_synchronize();
-        value = 0;
+        owner = owner + 1;
     }
 
 private:
-    volatile size_t value = 0; ///< The value of the lock
+    volatile size_t next = 0;  ///< The next ticket to give
+    volatile size_t owner = 0; ///< The ticket holding the lock
 };
 
 #endif
@@ -0,0 +1,153 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef CPU_RING_DEVICE_H
+#define CPU_RING_DEVICE_H
+
+#include <array.hpp>
+#include <circular_buffer.hpp>
+#include <lock_guard.hpp>
+
+#include <tlib/errors.hpp>
+
+#include "smp.hpp"
+
+#include "conc/int_spinlock.hpp"
+
+#include "fs/devfs.hpp"
+
+/*!
+ * \brief Per-processor rings of records exposed as a character device.
+ *
+ * Reading the device consumes the records of all the processors. Writing
+ * a decimal value to the device stops the producer, empties the rings and
+ * restarts the producer with the value.
+ */
+template<typename T, size_t S>
+struct cpu_ring_device : devfs::dev_driver {
+    typedef void (*stop_fun)();
+    typedef void (*start_fun)(size_t value);
+
+    /*!
+     * \brief Allocate the rings of the started processors and register the
+     * device under /dev/.
+     *
+     * The rings are allocated here to keep them out of the kernel image.
+     */
+    void init(const char* name, stop_fun stop_callback, start_fun start_callback){
+        stop = stop_callback;
+        start = start_callback;
+
+        for(size_t cpu = 0; cpu < smp::cpus(); ++cpu){
+            rings[cpu] = new cpu_ring_t;
+        }
+
+        devfs::register_device("/dev/", name, devfs::device_type::CHAR_DEVICE, this, nullptr);
+    }
+
+    /*!
+     * \brief Push a record in the ring of the given processor, dropping the
+     * oldest one when it is full.
+     *
+     * The records pushed before init() are lost.
+     */
+    void push(size_t cpu, const T& record){
+        auto ring = rings[cpu];
+
+        if(!ring){
+            return;
+        }
+
+        std::lock_guard<int_spinlock> l(ring->lock);
+
+        // Keep the most recent records
+        if(ring->records.full()){
+            ring->records.pop();
+            ++dropped;
+        }
+
+        ring->records.push(record);
+    }
+
+    /*!
+     * \brief Returns the number of records dropped since the last write
+     */
+    size_t dropped_records() const {
+        return dropped;
+    }
+
+    // The records are consumed, the offset is not used
+    size_t read(void*, char* buffer, size_t count, size_t, size_t& read){
+        auto records = reinterpret_cast<T*>(buffer);
+        auto max = count / sizeof(T);
+
+        size_t n = 0;
+
+        for(size_t cpu = 0; cpu < smp::cpus() && n < max; ++cpu){
+            auto& ring = *rings[cpu];
+
+            std::lock_guard<int_spinlock> l(ring.lock);
+
+            while(!ring.records.empty() && n < max){
+                records[n++] = ring.records.pop();
+            }
+        }
+
+        read = n * sizeof(T);
+
+        return 0;
+    }
+
+    size_t write(void*, const char* buffer, size_t count, size_t, size_t& written){
+        size_t value = 0;
+
+        for(size_t i = 0; i < count && buffer[i] >= '0' && buffer[i] <= '9'; ++i){
+            value = value * 10 + (buffer[i] - '0');
+        }
+
+        stop();
+
+        for(size_t cpu = 0; cpu < smp::cpus(); ++cpu){
+            auto& ring = *rings[cpu];
+
+            std::lock_guard<int_spinlock> l(ring.lock);
+
+            while(!ring.records.empty()){
+                ring.records.pop();
+            }
+        }
+
+        dropped = 0;
+
+        start(value);
+
+        written = count;
+
+        return 0;
+    }
+
+    size_t clear(void*, size_t, size_t, size_t&){
+        return std::ERROR_UNSUPPORTED;
+    }
+
+    size_t size(void*){
+        return 0;
+    }
+
+private:
+    struct cpu_ring_t {
+        int_spinlock lock;
+        circular_buffer<T, S> records;
+    };
+
+    std::array<cpu_ring_t*, smp::MAX_CPUS> rings;
+    volatile size_t dropped;
+    stop_fun stop;
+    start_fun start;
+};
+
+#endif
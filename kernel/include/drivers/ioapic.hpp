@@ -0,0 +1,45 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef DRIVER_IOAPIC_H
+#define DRIVER_IOAPIC_H
+
+#include <types.hpp>
+
+namespace ioapic {
+
+/*!
+ * \brief Register an I/O APIC found in the MADT
+ * \param id The id of the I/O APIC
+ * \param address The physical address of its registers
+ * \param gsi_base The first global system interrupt it handles
+ */
+void add(uint8_t id, uint64_t address, uint32_t gsi_base);
+
+/*!
+ * \brief Register an interrupt source override found in the MADT
+ * \param irq The ISA IRQ
+ * \param gsi The global system interrupt it is connected to
+ * \param flags The MPS INTI flags (polarity and trigger mode)
+ */
+void add_override(uint8_t irq, uint32_t gsi, uint16_t flags);
+
+/*!
+ * \brief Map the registered I/O APICs and route the ISA IRQs to the
+ * given processor. After this, the 8259 PIC is not used anymore.
+ * \return true if the I/O APICs are now handling the interrupts, false otherwise
+ */
+bool install(uint32_t apic_id);
+
+/*!
+ * \brief Indicates if the I/O APIC is handling the interrupts
+ */
+bool enabled();
+
+} //end of namespace ioapic
+
+#endif
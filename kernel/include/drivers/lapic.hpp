@@ -0,0 +1,76 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef DRIVER_LAPIC_H
+#define DRIVER_LAPIC_H
+
+#include <types.hpp>
+
+namespace lapic {
+
+/*!
+ * \brief Map the local APIC of the bootstrap processor and enable it
+ * \param address The physical address of the local APIC registers
+ */
+bool install(uint64_t address);
+
+/*!
+ * \brief Enable the local APIC of the current application processor
+ */
+void init_ap();
+
+/*!
+ * \brief Indicates if the local APIC has been installed
+ */
+bool enabled();
+
+/*!
+ * \brief Returns the APIC id of the current processor
+ */
+uint32_t id();
+
+/*!
+ * \brief Signal the end of the current interrupt
+ */
+void eoi();
+
+/*!
+ * \brief Send an INIT IPI to the given processor
+ */
+void send_init(uint32_t apic_id);
+
+/*!
+ * \brief Send a STARTUP IPI to the given processor
+ * \param page The physical page (address / 4096) where the processor will start
+ */
+void send_startup(uint32_t apic_id, uint8_t page);
+
+/*!
+ * \brief Send a fixed IPI with the given vector to the given processor
+ */
+void send_ipi(uint32_t apic_id, uint8_t vector);
+
+/*!
+ * \brief Calibrate the local APIC timer against the system counter
+ */
+void calibrate_timer();
+
+/*!
+ * \brief Start the local APIC timer of the current processor in periodic mode
+ * \param frequency The number of interrupts per second
+ * \param vector The interrupt vector to fire
+ */
+void start_timer(uint64_t frequency, uint8_t vector);
+
+/*!
+ * \brief Stop the local APIC timer of the current processor
+ */
+void stop_timer();
+
+} //end of namespace lapic
+
+#endif
@@ -17,7 +17,8 @@
 namespace devfs {
 
 enum class device_type {
-    BLOCK_DEVICE
+    BLOCK_DEVICE,
+    CHAR_DEVICE
 };
 
 struct dev_driver {
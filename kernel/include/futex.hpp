@@ -0,0 +1,48 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef FUTEX_HPP
+#define FUTEX_HPP
+
+#include <types.hpp>
+#include <expected.hpp>
+
+#include "process.hpp"
+
+/*!
+ * \brief Wait queues on user memory words.
+ *
+ * The queues are keyed by the physical address of the word so that the
+ * threads of a process and processes sharing memory use the same queue.
+ */
+namespace futex {
+
+/*!
+ * \brief Wait on the given user word as long as it contains the expected
+ * value.
+ *
+ * \param address The user address of the 32-bit word
+ * \param expected The value the word must have to wait
+ * \param ms The timeout in milliseconds, 0 to wait indefinitely
+ */
+std::expected<void> wait(size_t address, uint32_t expected, size_t ms);
+
+/*!
+ * \brief Wake up at most n processes waiting on the given user word
+ * \return The number of processes that were woken up
+ */
+std::expected<size_t> wake(size_t address, size_t n);
+
+/*!
+ * \brief Remove the given process from the queue it is waiting on, if any,
+ * and wake it up.
+ */
+void interrupt(scheduler::pid_t pid);
+
+} //end of namespace futex
+
+#endif
@@ -9,13 +9,41 @@
 #define GDT_H
 
 #include "gdt_types.hpp"
+#include "smp.hpp"
 
 namespace gdt {
 
-void flush_tss();
+/*!
+ * \brief The segments used by SYSCALL/SYSRET, placed after the TSS
+ * descriptors. SYSCALL loads the kernel code and data segments and
+ * SYSRET the user data and code segments, in this order.
+ */
+constexpr const uint16_t SYSCALL_CODE_SELECTOR = (6 + 2 * smp::MAX_CPUS) * 8;
+constexpr const uint16_t SYSCALL_DATA_SELECTOR = SYSCALL_CODE_SELECTOR + 8;
+constexpr const uint16_t SYSRET_DATA_SELECTOR = SYSCALL_CODE_SELECTOR + 16;
+constexpr const uint16_t SYSRET_CODE_SELECTOR = SYSCALL_CODE_SELECTOR + 24;
 
+/*!
+ * \brief Install the kernel GDT, with one TSS per processor, on the
+ * bootstrap processor
+ */
+void init();
+
+/*!
+ * \brief Load the kernel GDT and the TSS of the given application processor
+ */
+void init_ap(size_t cpu);
+
+/*!
+ * \brief Returns the TSS of the current processor
+ */
 task_state_segment_t& tss();
 
+/*!
+ * \brief Returns the TSS of the given processor
+ */
+task_state_segment_t& tss(size_t cpu);
+
 } //end of namespace gdt
 
 #endif
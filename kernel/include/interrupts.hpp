@@ -15,6 +15,14 @@ namespace interrupt {
 constexpr const size_t SYSCALL_FIRST = 50;
 constexpr const size_t SYSCALL_MAX = 10;
 
+constexpr const size_t IRQ_VECTOR_BASE = 32; ///< The vector of the first IRQ
+constexpr const size_t IRQ_LAPIC_TIMER = 16; ///< The IRQ of the local APIC timer
+constexpr const size_t IRQ_RESCHEDULE = 17;  ///< The IRQ of the reschedule IPI
+constexpr const size_t IRQ_TLB_SHOOTDOWN = 18; ///< The IRQ of the TLB shootdown IPI
+constexpr const size_t IRQ_MAX = 19;
+
+constexpr const size_t TLB_SHOOTDOWN_VECTOR = 60; ///< The vector of the TLB shootdown IPI (after the syscalls)
+
 struct fault_regs {
     uint64_t error_no;
     uint64_t error_code;
@@ -25,8 +33,9 @@ struct fault_regs {
     uint64_t ss;
 } __attribute__((packed));
 
+// The FPU/SSE registers are not part of the frame, the kernel does not
+// use them and they are switched lazily (see scheduler::fpu_trap)
 struct syscall_regs {
-    sse_128 xmm_registers[16];
     uint64_t rax;
     uint64_t rbx;
     uint64_t rcx;
@@ -52,6 +61,18 @@ struct syscall_regs {
 
 void setup_interrupts();
 
+/*!
+ * \brief Load the IDT and enable the SYSCALL instruction on an
+ * application processor
+ */
+void setup_ap(size_t cpu);
+
+/*!
+ * \brief Mask the 8259 PIC, the interrupts are then acknowledged
+ * through the local APIC
+ */
+void disable_pic();
+
 bool register_irq_handler(size_t irq, void (*handler)(syscall_regs*, void*), void* data);
 bool register_syscall_handler(size_t irq, void (*handler)(syscall_regs*));
 
@@ -0,0 +1,33 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef IO_RING_HPP
+#define IO_RING_HPP
+
+#include <types.hpp>
+#include <expected.hpp>
+
+#include <tlib/io_ring_layout.hpp>
+
+namespace io_ring {
+
+/*!
+ * \brief Register the ring of the current process
+ * \param address The user address of the ring, 0 to unregister it
+ */
+std::expected<void> setup(size_t address);
+
+/*!
+ * \brief Execute the pending submissions of the ring of the current process
+ * \param count The maximum number of submissions to execute
+ * \return The number of executed submissions
+ */
+std::expected<size_t> enter(size_t count);
+
+} //end of namespace io_ring
+
+#endif
@@ -26,6 +26,10 @@ void _irq12();
 void _irq13();
 void _irq14();
 void _irq15();
+void _irq16();
+void _irq17();
+void _irq18();
+void _irq_spurious();
 
 } //end of extern "C"
 
@@ -27,6 +27,12 @@ bool is_file();
 void finalize();
 void to_file();
 
+/*!
+ * \brief Start the writer task, the messages are then buffered in per-processor
+ * rings and written to the outputs in batches by the task.
+ */
+void start_writer();
+
 void log(log_level level, const char* s);
 void log(log_level level, const std::string& s);
 void logf(log_level level, const char* s, va_list va);
@@ -15,6 +15,7 @@
 
 #include "net/network.hpp"
 #include "net/ip_layer.hpp"
+#include "net/socket.hpp"
 
 namespace network {
 
@@ -8,8 +8,7 @@
 #ifndef NETWORK_H
 #define NETWORK_H
 
-#include <conc/mutex.hpp>
-#include <conc/semaphore.hpp>
+#include <conc/int_spinlock.hpp>
 
 #include <types.hpp>
 #include <string.hpp>
@@ -40,23 +39,40 @@ struct interface_descriptor {
     network::ip::address ip_address; ///< The interface IP address
     network::ip::address gateway;    ///< The interface IP gateway
 
-    mutable mutex tx_lock; ///< Mutex protecting the queues
-    mutable semaphore tx_sem; ///< Semaphore for transmission
-    mutable semaphore rx_sem; ///< Semaphore for reception
+    mutable int_spinlock tx_lock; ///< Lock protecting the transmission queue
+    mutable int_spinlock rx_lock; ///< Lock protecting the reception queue
 
-    size_t rx_thread_pid; ///< The pid of the rx thread
-    size_t tx_thread_pid; ///< The pid of the tx thread
+    volatile bool tx_scheduled; ///< Indicates if the transmission work is posted
+    volatile bool rx_scheduled; ///< Indicates if the reception work is posted
+    volatile bool tx_resumed;   ///< Indicates that the driver freed transmission resources during the work
 
     circular_buffer<ethernet::packet, 32> rx_queue; ///< The reception queue
     circular_buffer<ethernet::packet, 32> tx_queue; ///< The transmission queue
 
-    void (*hw_send)(interface_descriptor&, ethernet::packet& p);
-
-    void send(ethernet::packet& p){
-        std::lock_guard<mutex> l(tx_lock);
-        tx_queue.push(p);
-        tx_sem.unlock();
-    }
+    /*!
+     * \brief Transmit a packet with the hardware, without blocking.
+     * \return false if the hardware has no free resource, the packet is then
+     * kept in the queue until the driver calls tx_ready()
+     */
+    bool (*hw_send)(interface_descriptor&, ethernet::packet& p);
+
+    /*!
+     * \brief Queue a packet for transmission by a kernel worker
+     */
+    void send(ethernet::packet& p);
+
+    /*!
+     * \brief Resume the transmission queue, called by the driver from its
+     * interrupt handler once transmission resources are freed
+     */
+    void tx_ready();
+
+    /*!
+     * \brief Queue a received packet to be decoded by a kernel worker.
+     *
+     * The interface takes the ownership of the payload.
+     */
+    void receive(ethernet::packet& p);
 
     bool is_loopback() const {
         return driver == "loopback";
@@ -68,13 +84,6 @@ struct interface_descriptor {
  */
 void init();
 
-/*
- * \brief Finalization of the network initialization.
- *
- * Must be called after initialization of the scheduler.
- */
-void finalize();
-
 /*!
  * \brief Returns the number of interfaces
  */
@@ -13,6 +13,7 @@
 #include "net/ethernet_layer.hpp"
 #include "net/ip_layer.hpp"
 #include "net/network.hpp"
+#include "net/socket.hpp"
 
 namespace network {
 
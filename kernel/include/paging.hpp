@@ -23,6 +23,12 @@ namespace paging {
 //The size of page in memory
 constexpr const size_t PAGE_SIZE = 4096;
 
+//The size of a large page (mapped directly by a PD entry)
+constexpr const size_t LARGE_PAGE_SIZE = 2_MiB;
+
+//The number of pages in a large page
+constexpr const size_t LARGE_PAGE_PAGES = LARGE_PAGE_SIZE / PAGE_SIZE;
+
 //The physical memory that a PML4T Entry can map
 constexpr const size_t pml4e_allocations = 512_GiB;
 
@@ -70,6 +76,7 @@ constexpr const uint8_t USER = 0x4;
 constexpr const uint8_t WRITE_THROUGH = 0x8;
 constexpr const uint8_t CACHE_DISABLED = 0x10;
 constexpr const uint8_t ACCESSED= 0x20;
+constexpr const uint8_t LARGE = 0x80; ///< A PD entry mapping a large page directly
 
 constexpr bool page_aligned(size_t addr){
     return !(addr & (paging::PAGE_SIZE - 1));
@@ -79,6 +86,10 @@ constexpr size_t page_align(size_t addr){
     return (addr / paging::PAGE_SIZE) * paging::PAGE_SIZE;
 }
 
+constexpr bool large_page_aligned(size_t addr){
+    return !(addr & (paging::LARGE_PAGE_SIZE - 1));
+}
+
 void early_init();
 void init();
 void finalize();
@@ -95,12 +106,38 @@ bool identity_map_pages(size_t virt, size_t pages, uint8_t flags = PRESENT | WRI
 bool map(size_t virt, size_t physical, uint8_t flags = PRESENT | WRITE);
 bool map_pages(size_t virt, size_t physical, size_t pages, uint8_t flags = PRESENT | WRITE);
 
+/*!
+ * \brief Map the given pages, using large pages for the parts of the range
+ * where both addresses are aligned on a large page, and normal pages elsewhere.
+ *
+ * The large pages are released by unmap_pages when the whole large page is
+ * unmapped.
+ */
+bool map_large_pages(size_t virt, size_t physical, size_t pages, uint8_t flags = PRESENT | WRITE);
+
 bool unmap(size_t virt);
 bool unmap_pages(size_t virt, size_t pages);
 
 void map_kernel_inside_user(scheduler::process_t& process);
-bool user_map(scheduler::process_t& process, size_t virt, size_t physical);
-bool user_map_pages(scheduler::process_t& process, size_t virt, size_t physical, size_t pages);
+bool user_map(scheduler::process_t& process, size_t virt, size_t physical, uint8_t flags = PRESENT | WRITE | USER);
+
+/*!
+ * \brief Map a large page in the user space of the process. Fails if some
+ * pages are already mapped in its range.
+ */
+bool user_map_large(scheduler::process_t& process, size_t virt, size_t physical, uint8_t flags = PRESENT | WRITE | USER);
+
+/*!
+ * \brief Map the given pages in the user space of the process. If large is
+ * true, large pages are used where both addresses are aligned on a large page.
+ */
+bool user_map_pages(scheduler::process_t& process, size_t virt, size_t physical, size_t pages, bool large = false);
+
+/*!
+ * \brief Returns the physical address of a user virtual address of the
+ * given process, or 0 if it is not mapped for user access.
+ */
+size_t user_physical_address(scheduler::process_t& process, size_t virt);
 
 size_t get_physical_pml4t();
 
@@ -28,7 +28,7 @@ public:
                         virt = 0;
                     }
                 } else {
-                    if(!paging::map_pages(virt, phys, pages)){
+                    if(!paging::map_large_pages(virt, phys, pages)){
                         virt = 0;
                     }
                 }
@@ -33,6 +33,8 @@ typedef size_t pid_t;
 
 constexpr const pid_t INVALID_PID = 1024 * 1024 * 1024; //I'm pretty sure we won't violate this limit
 
+constexpr const size_t FPU_STATE_SIZE = 512; ///< The size of a FXSAVE area
+
 enum class process_state : char {
     EMPTY = 0,
     NEW = 1,
@@ -54,6 +56,10 @@ struct process_t {
     pid_t pid;
     pid_t ppid;
 
+    // The process owning the address space, the handles and the
+    // sockets. This is the process itself, unless this is a thread
+    pid_t leader;
+
     bool system;
 
     size_t priority;
@@ -72,6 +78,13 @@ struct process_t {
     size_t brk_start;
     size_t brk_end;
 
+    size_t io_ring; // The user address of the submission ring, if any
+
+    size_t thread_slot;          // The user stack slot of a thread
+    uint64_t thread_slots_used;  // The stack slots used by the threads of a leader
+    uint64_t thread_slots_mapped; // The stack slots already mapped in the address space of a leader
+    volatile size_t threads;     // The number of threads of a leader not cleaned yet
+
     // Only for system kernels
     char* user_stack;
     char* kernel_stack;
@@ -92,11 +105,40 @@ constexpr const auto kernel_stack_size = 2 * paging::PAGE_SIZE;
 constexpr const auto user_stack_start = program_base + 0x700000;
 constexpr const auto user_rsp = user_stack_start + (user_stack_size - 8);
 
+// The user stacks of the threads, separated by a guard page
+constexpr const size_t MAX_THREADS = 64;
+constexpr const auto thread_stack_start = program_base + 0x800000;
+constexpr const auto thread_stack_slot = user_stack_size + paging::PAGE_SIZE;
+
 struct process_control_t {
     scheduler::process_t process;
     scheduler::process_state state;
+    bool unreaped;        ///< Indicates that the slot is kept until the parent awaits the process
     size_t rounds;
-    size_t sleep_timeout;
+    uint64_t wake_tick;   ///< The tick at which the process must be woken up
+    bool timer_queued;    ///< Indicates if the process is in the timer wheel
+    size_t timer_slot;    ///< The slot of the timer wheel holding the process
+    pid_t next_timer;     ///< The next process in the timer wheel slot
+    pid_t prev_timer;     ///< The previous process in the timer wheel slot
+    size_t cpu;          ///< The processor whose run queue holds the process
+    volatile bool on_cpu; ///< Indicates if the context of the process is in use by a processor
+    bool queued;          ///< Indicates if the process is in the ready list of its processor
+    pid_t next_ready;     ///< The next process in the ready list
+    pid_t prev_ready;     ///< The previous process in the ready list
+    size_t base_priority; ///< The priority of the process before inheriting one, 0 if it did not
+    size_t boosts;        ///< The number of inheritances not yet given back by restore_priority()
+    volatile bool exit_requested; ///< Indicates that the thread must terminate at its next return to user space
+    uint64_t last_tsc;              ///< The TSC at the start of the current accounting period
+    uint64_t ready_tsc;             ///< The TSC when the process became READY, 0 if it is not waiting
+    uint64_t user_time;             ///< The TSC cycles spent in user mode
+    uint64_t kernel_time;           ///< The TSC cycles spent in kernel mode
+    uint64_t wait_time;             ///< The TSC cycles spent READY in a run queue
+    size_t voluntary_switches;      ///< The number of times the process blocked
+    size_t involuntary_switches;    ///< The number of times the process was preempted
+    size_t system_calls;            ///< The number of system calls made by the process
+    size_t fpu_cpu;       ///< The processor whose registers hold the FPU/SSE state of the process
+    size_t fpu_traps;     ///< The number of #NM taken to load the FPU/SSE state
+    alignas(16) char fpu_state[FPU_STATE_SIZE]; ///< The saved FPU/SSE state (FXSAVE format)
     std::vector<path> handles;
     std::vector<network::socket> sockets;
     path working_directory;
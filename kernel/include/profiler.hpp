@@ -0,0 +1,36 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <types.hpp>
+
+#include "interrupts.hpp"
+
+/*!
+ * \brief Sampling profiler driven by the timer interrupts.
+ *
+ * Writing a period (in ticks) to /dev/profiler starts the sampling, writing
+ * 0 stops it. Reading /dev/profiler consumes the samples.
+ */
+namespace profiler {
+
+/*!
+ * \brief Register the profiler device
+ */
+void init();
+
+/*!
+ * \brief Record a sample of the interrupted context, called on each tick
+ * of the current processor.
+ */
+void tick(const interrupt::syscall_regs* regs);
+
+} //end of namespace profiler
+
+#endif
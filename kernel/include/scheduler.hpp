@@ -17,8 +17,12 @@
 
 #include "vfs/path.hpp"
 
+struct mutex;
+
 namespace scheduler {
 
+constexpr const size_t MAX_SOCKETS = 32; ///< The maximum number of sockets of a process
+
 constexpr const size_t MAX_PROCESS = 128;
 
 pid_t get_pid();
@@ -29,17 +33,100 @@ void block_process(pid_t pid);
 void unblock_process(pid_t pid);
 void unblock_process_hint(pid_t pid);
 
+/*!
+ * \brief Unblock the given process only if it is still BLOCKED, it may
+ * have been woken up by its timeout in between.
+ * \return true if the process has been unblocked, false otherwise
+ */
+bool try_unblock_process(pid_t pid);
+
 void init();
 void start() __attribute__((noreturn));
 bool is_started();
 
+/*!
+ * \brief Indicates if the given process is currently running on another
+ * processor than the current one.
+ */
+bool is_running_remotely(pid_t pid);
+
+/*!
+ * \brief Prepare the scheduling of the given application processor
+ *
+ * Must be called by the bootstrap processor before the processor is started.
+ */
+void init_ap(size_t cpu);
+
+/*!
+ * \brief Start scheduling on the current application processor
+ */
+void start_ap() __attribute__((noreturn));
+
 std::expected<pid_t> exec(const std::string& path, const std::vector<std::string>& params);
 
+/*!
+ * \brief Create a thread sharing the address space, the handles and the
+ * sockets of the current process.
+ *
+ * The thread starts at the given user entry with the two arguments in
+ * rdi and rsi.
+ *
+ * \return The pid of the new thread
+ */
+std::expected<pid_t> create_thread(size_t entry, size_t arg0, size_t arg1);
+
+/*!
+ * \brief Returns the process owning the address space of the current process
+ */
+scheduler::process_t& get_leader();
+
+/*!
+ * \brief Indicates if the current thread must terminate because its
+ * process exited
+ */
+bool exit_requested();
+
 void kill_current_process();
+
+/*!
+ * \brief Account the time spent in user mode by the current process,
+ * called when it enters the kernel.
+ *
+ * \param system_call Indicates if the kernel is entered for a system call
+ */
+void kernel_entry(bool system_call);
+
+/*!
+ * \brief Account the time spent in kernel mode by the current process,
+ * called when it returns to user mode.
+ */
+void kernel_exit();
+
+/*!
+ * \brief Raise the priority of the given process to the given priority,
+ * for priority inheritance.
+ *
+ * \return true if the process inherits the priority, false if its own
+ * priority is already high enough. Each inheritance must be given back
+ * with restore_priority().
+ */
+bool boost_priority(pid_t pid, size_t priority);
+
+/*!
+ * \brief Give back the given number of inheritances of the current
+ * process. Its own priority is restored once it has none left.
+ */
+void restore_priority(size_t boosts);
 void await_termination(pid_t pid);
 void sbrk(size_t inc);
 
 void tick();
+
+/*!
+ * \brief Tick of the local timer of an application processor
+ */
+void local_tick();
+
 void reschedule();
 
 /*!
@@ -47,22 +134,58 @@ void reschedule();
  */
 void fault();
 
+/*!
+ * \brief Make the current process the owner of the FPU/SSE registers,
+ * after a #NM trap.
+ * \return The address of the state to restore
+ */
+size_t fpu_trap();
+
+/*!
+ * \brief Give the FPU/SSE registers to the kernel until kernel_fpu_end().
+ *
+ * The kernel is built without SSE, only the functions compiled for it
+ * (target attribute or inline assembly) can use the registers inside the
+ * section. The state of the owner process is saved first and reloaded on
+ * its next #NM. Interrupts are disabled inside the section.
+ * \param rflags Receives the flags to restore in kernel_fpu_end()
+ */
+void kernel_fpu_begin(size_t& rflags);
+
+/*!
+ * \brief End the FPU/SSE section started by kernel_fpu_begin()
+ * \param rflags The flags returned by kernel_fpu_begin()
+ */
+void kernel_fpu_end(size_t& rflags);
+
 void sleep_ms(size_t time);
 void sleep_ms(pid_t pid, size_t time);
 
+/*!
+ * \brief Returns the lock protecting the handles, the sockets and the
+ * working directory of the given leader, shared by its threads
+ */
+mutex& resources_lock(pid_t pid);
+
 size_t register_new_handle(const path& p);
-const path& get_handle(size_t fd);
+path get_handle(size_t fd);
 bool has_handle(size_t fd);
 void release_handle(size_t fd);
 
-size_t register_new_socket(network::socket_domain domain, network::socket_type type, network::socket_protocol protocol);
+/*!
+ * \brief Register a new socket for the current process.
+ *
+ * The storage of the sockets is never reallocated, the references
+ * returned by get_socket() remain valid.
+ */
+std::expected<size_t> register_new_socket(network::socket_domain domain, network::socket_type type, network::socket_protocol protocol);
 network::socket& get_socket(size_t fd);
 bool has_socket(size_t fd);
 void release_socket(size_t fd);
 std::vector<network::socket>& get_sockets();
 std::vector<network::socket>& get_sockets(pid_t pid);
 
-const path& get_working_directory();
+path get_working_directory();
 void set_working_directory(const path& directory);
 
 void block_process_light(pid_t pid);
@@ -71,6 +194,7 @@ void block_process_timeout_light(pid_t pid, size_t ms);
 process_t& create_kernel_task(const char* name, char* user_stack, char* kernel_stack, void (*fun)());
 process_t& create_kernel_task_args(const char* name, char* user_stack, char* kernel_stack, void (*fun)(void*), void* data);
 void queue_system_process(pid_t pid);
+void queue_system_process(pid_t pid, size_t cpu);
 
 /*!
  * \brief Queue an initilization task that will be run after the
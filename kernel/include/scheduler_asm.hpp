@@ -12,6 +12,7 @@ extern "C" {
 
 uint64_t get_context_address(size_t pid);
 uint64_t get_process_cr3(size_t pid);
+void finish_task_switch(size_t old_pid, size_t new_pid);
 
 } //end of extern "C"
 
@@ -0,0 +1,119 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <types.hpp>
+
+#include "conc/int_spinlock.hpp"
+
+#include "smp.hpp"
+
+/*!
+ * \brief Object caches for fixed-size kernel objects.
+ *
+ * Each cache allocates its objects from slabs of SLAB_SIZE bytes. The
+ * slabs are aligned on their size, the slab of an object is therefore
+ * found from its address. Small dynamic allocations (up to MAX_SIZE bytes)
+ * are served by general caches of power of two sizes.
+ *
+ * Each processor keeps two magazines of objects per cache, the common
+ * allocations and frees only use them, with the interrupts disabled. The
+ * magazines are exchanged in batches with the depot of the cache.
+ */
+namespace slab {
+
+constexpr const size_t SLAB_PAGES = 16;               ///< The number of pages of a slab
+constexpr const size_t SLAB_SIZE = SLAB_PAGES * 4096; ///< The size of a slab, in bytes
+constexpr const size_t MIN_SIZE = 16;                 ///< The size of the smallest general cache
+constexpr const size_t MAX_SIZE = 4096;               ///< The size of the largest general cache
+constexpr const size_t MAGAZINE_SIZE = 32;            ///< The number of objects of a magazine
+constexpr const size_t DEPOT_SIZE = 8;                ///< The maximum number of full magazines in a depot
+
+struct slab_t;
+struct magazine_t;
+struct cpu_cache_t;
+
+/*!
+ * \brief A cache of objects of the same size
+ */
+struct cache {
+    const char* name;              ///< The name of the cache
+    size_t object_size;            ///< The size of the objects
+    size_t slot_size;              ///< The space taken by an object in a slab
+    size_t objects_per_slab;       ///< The number of objects in each slab
+    void (*constructor)(void*);    ///< Called once on each object when its slab is created
+
+    int_spinlock lock;             ///< The lock protecting the slab lists
+    slab_t* partial;               ///< The slabs with free and used objects
+    slab_t* full;                  ///< The slabs without free objects
+    slab_t* empty;                 ///< The slab kept without used objects
+
+    magazine_t* full_magazines;    ///< The full magazines of the depot
+    magazine_t* empty_magazines;   ///< The empty magazines of the depot
+    size_t depot_full;             ///< The number of full magazines in the depot
+
+    cpu_cache_t* cpus[smp::MAX_CPUS]; ///< The magazines of each processor, allocated on first use
+
+    volatile size_t slabs;         ///< The number of slabs of the cache
+    volatile size_t used;          ///< The number of objects in use
+    volatile size_t allocations;   ///< The number of objects allocated from the slabs
+    volatile size_t exchanges;     ///< The number of magazines exchanged with the depot
+};
+
+/*!
+ * \brief Create the general caches
+ */
+void init();
+
+/*!
+ * \brief Register the statistics in sysfs
+ */
+void finalize();
+
+/*!
+ * \brief Indicates if the general caches can be used
+ */
+bool initialized();
+
+/*!
+ * \brief Create a new cache of objects.
+ *
+ * The constructor is called once on each object when its slab is
+ * allocated, the objects must be returned to the cache in their
+ * constructed state.
+ *
+ * \return The cache, or nullptr if there are too many caches
+ */
+cache* create_cache(const char* name, size_t size, void (*constructor)(void*) = nullptr);
+
+/*!
+ * \brief Allocate an object from the given cache
+ * \return the object, or nullptr if there is not enough memory
+ */
+void* allocate(cache& c);
+
+/*!
+ * \brief Allocate a block of the given size from the general caches
+ * \return the block, or nullptr if there is not enough memory
+ */
+void* allocate(size_t size);
+
+/*!
+ * \brief Indicates if the given address has been allocated from a cache
+ */
+bool is_slab(const void* address);
+
+/*!
+ * \brief Return an object to its cache
+ */
+void free(void* address);
+
+} //end of namespace slab
+
+#endif
@@ -0,0 +1,64 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef SMP_H
+#define SMP_H
+
+#include <types.hpp>
+
+namespace smp {
+
+constexpr const size_t MAX_CPUS = 16;
+
+// The frequency of the local APIC timer of each processor
+constexpr const uint64_t LAPIC_TIMER_FREQUENCY = 1000;
+
+struct cpu_t {
+    size_t id;                   ///< The logical id of the processor
+    uint32_t apic_id;            ///< The id of its local APIC
+    volatile bool online;        ///< Indicates if the processor is running
+    volatile uint64_t ticks;     ///< The number of local timer ticks
+    char* stack;                 ///< The boot stack of the processor
+};
+
+/*!
+ * \brief Queue the startup of the application processors
+ *
+ * The MADT is only available once ACPI is initialized, the
+ * processors are therefore started asynchronously.
+ */
+void init();
+
+/*!
+ * \brief Parse the MADT, switch to the I/O APIC and start all the
+ * application processors
+ */
+void late_install();
+
+/*!
+ * \brief Returns the logical id of the current processor
+ */
+size_t current_cpu();
+
+/*!
+ * \brief Returns the number of processors found
+ */
+size_t cpus();
+
+/*!
+ * \brief Returns the number of processors running
+ */
+size_t online_cpus();
+
+/*!
+ * \brief Returns the descriptor of the given processor
+ */
+cpu_t& cpu(size_t id);
+
+} //end of namespace smp
+
+#endif
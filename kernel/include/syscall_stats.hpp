@@ -0,0 +1,50 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef SYSCALL_STATS_H
+#define SYSCALL_STATS_H
+
+#include <types.hpp>
+#include <string.hpp>
+
+/*!
+ * \brief Counters and latency histograms of the system calls, globally
+ * (in /sys/syscalls/stats) and per process (in /proc/<pid>/syscalls).
+ *
+ * Each line of the statistics contains the system call number, the
+ * number of calls, the total number of TSC cycles and the histogram of
+ * the latencies. The bucket i of the histogram counts the calls that
+ * took between 2^i and 2^(i+1) cycles.
+ */
+namespace syscall_stats {
+
+constexpr const size_t BUCKETS = 32; ///< The number of buckets of the latency histograms
+
+/*!
+ * \brief Register the global statistics in sysfs
+ */
+void init();
+
+/*!
+ * \brief Record a call of the given system call by the given process
+ * \param cycles The duration of the call, in TSC cycles
+ */
+void record(size_t pid, uint64_t code, uint64_t cycles);
+
+/*!
+ * \brief Release the statistics of the given process
+ */
+void release(size_t pid);
+
+/*!
+ * \brief Returns the statistics of the given process
+ */
+std::string process_statistics(size_t pid);
+
+} //end of namespace syscall_stats
+
+#endif
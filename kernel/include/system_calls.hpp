@@ -10,7 +10,7 @@
 
 #include "interrupts.hpp"
 
-void system_call_entry(const interrupt::syscall_regs& regs);
+void system_call_entry(interrupt::syscall_regs* regs);
 
 void install_system_calls();
 
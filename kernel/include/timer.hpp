@@ -27,6 +27,15 @@ uint64_t seconds();
  */
 uint64_t milliseconds();
 
+/*!
+ * \brief Returns a up-counter in nanoseconds.
+ *
+ * With an invariant TSC, this is computed from the TSC and has a
+ * resolution of a few nanoseconds, otherwise it has the resolution of
+ * the counter.
+ */
+uint64_t nanoseconds();
+
 /*!
  * \brief Let the timer know of a new tick
  */
@@ -57,11 +66,57 @@ uint64_t counter_frequency();
  */
 void counter_frequency(uint64_t freq);
 
+/*!
+ * \brief Returns the calibrated frequency in Hz of the TSC, or 0 if it is
+ * not calibrated yet.
+ */
+uint64_t tsc_frequency();
+
 /*!
  * \brief Sets the function to use to get the counter value;
  */
 void counter_fun(uint64_t (*fun)());
 
+/*!
+ * \brief Sets the function to use to program the next timer interrupt
+ * in the given number of ticks. This is optional, without it, the
+ * tick cannot be stopped.
+ */
+void oneshot_fun(void (*fun)(uint64_t ticks));
+
+/*!
+ * \brief Stop the periodic tick, the next timer interrupt will
+ * happen after the given number of ticks.
+ *
+ * Must be called with interrupts disabled.
+ *
+ * \return true if the tick has been stopped, false otherwise
+ */
+bool stop_tick(uint64_t ticks);
+
+/*!
+ * \brief Returns the number of ticks elapsed since stop_tick(), 0 if the
+ * tick is not stopped
+ */
+uint64_t tickless_ticks();
+
+/*!
+ * \brief Restart the periodic tick after a stop_tick()
+ * \return The number of ticks that were skipped
+ */
+uint64_t restart_tick();
+
+/*!
+ * \brief Indicates if the periodic tick is currently stopped
+ */
+bool tickless();
+
+/*!
+ * \brief Returns the physical address of the time page, to be mapped
+ * read-only in the processes
+ */
+size_t time_page_physical();
+
 } //end of timer namespace
 
 #endif
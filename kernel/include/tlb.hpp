@@ -0,0 +1,55 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TLB_HPP
+#define TLB_HPP
+
+#include <types.hpp>
+
+/*!
+ * \brief Invalidation of the kernel translations cached by the other
+ * processors.
+ *
+ * The kernel address space is shared by all the processors, a page that
+ * is unmapped on one processor must be invalidated on all the others
+ * before its virtual or physical memory can be reused.
+ */
+namespace tlb {
+
+extern volatile size_t pending; ///< The number of processors that still have to invalidate
+
+/*!
+ * \brief Register the handler of the shootdown IPI
+ */
+void init();
+
+/*!
+ * \brief Invalidate the given pages on all the other online processors
+ * and wait for them to be done.
+ *
+ * The current processor must have invalidated its own TLB.
+ */
+void shootdown(size_t virt, size_t pages);
+
+/*!
+ * \brief Perform the invalidation requested to the current processor, if any
+ */
+void serve();
+
+/*!
+ * \brief Serve the pending invalidations while spinning with interrupts
+ * disabled, so that an initiator holding the awaited lock can progress
+ */
+inline void poll(){
+    if(pending){
+        serve();
+    }
+}
+
+} //end of namespace tlb
+
+#endif
@@ -0,0 +1,52 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <types.hpp>
+
+#include <tlib/trace.hpp>
+
+/*!
+ * \brief Binary trace of kernel events.
+ *
+ * The events are recorded in per-processor rings of fixed-size records,
+ * the oldest records being overwritten when a ring is full. Writing a
+ * mask of events to /dev/trace enables them, reading /dev/trace consumes
+ * the records.
+ *
+ * Defining THOR_CONFIG_NO_TRACE removes all the tracepoints at compile time.
+ */
+namespace trace {
+
+extern volatile uint64_t enabled_events; ///< The mask of the enabled events
+
+/*!
+ * \brief Allocate the rings and register the trace device
+ */
+void init();
+
+/*!
+ * \brief Record an event in the ring of the current processor
+ */
+void record_event(event e, uint16_t flags, uint64_t arg0, uint64_t arg1);
+
+/*!
+ * \brief Tracepoint, only a test of the mask when the event is disabled
+ */
+inline void emit(event e, uint64_t arg0 = 0, uint64_t arg1 = 0, uint16_t flags = 0){
+#ifndef THOR_CONFIG_NO_TRACE
+    if(__builtin_expect(enabled_events & event_bit(e), 0)){
+        record_event(e, flags, arg0, arg1);
+    }
+#endif
+}
+
+} //end of namespace trace
+
+#endif
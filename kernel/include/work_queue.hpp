@@ -0,0 +1,67 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef WORK_QUEUE_HPP
+#define WORK_QUEUE_HPP
+
+#include <types.hpp>
+
+/*!
+ * \brief Deferred work executed by kernel worker tasks.
+ *
+ * Interrupt handlers should only acknowledge the device and post the
+ * rest of their work to be executed later with interrupts enabled.
+ */
+namespace work_queue {
+
+/*!
+ * \brief A function to execute later
+ */
+using work_function = void (*)(void* data);
+
+/*!
+ * \brief Initialize the queues.
+ *
+ * Work can be posted after this but is only executed once the workers
+ * are started.
+ */
+void init();
+
+/*!
+ * \brief Start the worker task of the bootstrap processor.
+ *
+ * Must be called after initialization of the scheduler.
+ */
+void finalize();
+
+/*!
+ * \brief Start the worker task of an application processor.
+ *
+ * Until then, the work posted on this processor is executed by the
+ * worker of the bootstrap processor.
+ */
+void start_worker(size_t cpu);
+
+/*!
+ * \brief Post work to the queue of the current processor
+ * \param fun The function to execute
+ * \param data The argument of the function
+ * \return true if the work was queued, false if the queue is full
+ */
+bool post(work_function fun, void* data);
+
+/*!
+ * \brief Post work to the queue of the current processor, from an IRQ handler
+ * \param fun The function to execute
+ * \param data The argument of the function
+ * \return true if the work was queued, false if the queue is full
+ */
+bool irq_post(work_function fun, void* data);
+
+} //end of namespace work_queue
+
+#endif
@@ -0,0 +1,120 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT_1_0.txt)
+//=======================================================================
+
+.intel_syntax noprefix
+
+// The trampoline is copied by the BSP at this address before the
+// application processors are started. It must be position independent
+// relatively to this address.
+.set TRAMPOLINE_BASE, 0x8000
+
+.global ap_trampoline_start
+.global ap_trampoline_end
+.global ap_trampoline_cr3
+.global ap_trampoline_stack
+.global ap_trampoline_entry
+
+.code16
+
+ap_trampoline_start:
+    cli
+    cld
+
+    // The APs start at 0x0800:0x0000
+    xor ax, ax
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+
+    lgdt [TRAMPOLINE_BASE + (trampoline_gdtr - ap_trampoline_start)]
+
+    // Enable protected mode
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+
+    ljmp 0x08, TRAMPOLINE_BASE + (trampoline_32 - ap_trampoline_start)
+
+.code32
+
+trampoline_32:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    // Enable PAE
+    mov eax, cr4
+    or eax, 1 << 5
+    mov cr4, eax
+
+    // Use the paging structures of the kernel
+    mov eax, [TRAMPOLINE_BASE + (ap_trampoline_cr3 - ap_trampoline_start)]
+    mov cr3, eax
+
+    // Enable Long Mode
+    mov ecx, 0xC0000080
+    rdmsr
+    or eax, 1 << 8
+    wrmsr
+
+    // Enable paging
+    mov eax, cr0
+    or eax, 1 << 31
+    mov cr0, eax
+
+    ljmp 0x18, TRAMPOLINE_BASE + (trampoline_64 - ap_trampoline_start)
+
+.code64
+
+trampoline_64:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    mov rax, TRAMPOLINE_BASE + (ap_trampoline_stack - ap_trampoline_start)
+    mov rsp, [rax]
+
+    mov rax, TRAMPOLINE_BASE + (ap_trampoline_entry - ap_trampoline_start)
+    mov rax, [rax]
+    call rax
+
+    // The entry point should never return
+    trampoline_halt:
+    cli
+    hlt
+    jmp trampoline_halt
+
+.align 8
+
+trampoline_gdt:
+    .quad 0x0000000000000000 // Null
+    .quad 0x00CF9A000000FFFF // 32-bit code
+    .quad 0x00CF92000000FFFF // Data
+    .quad 0x00AF9A000000FFFF // 64-bit code
+
+trampoline_gdtr:
+    .word trampoline_gdtr - trampoline_gdt - 1
+    .long TRAMPOLINE_BASE + (trampoline_gdt - ap_trampoline_start)
+
+// Parameters written by the BSP before each startup
+
+ap_trampoline_cr3:
+    .quad 0
+
+ap_trampoline_stack:
+    .quad 0
+
+ap_trampoline_entry:
+    .quad 0
+
+ap_trampoline_end:
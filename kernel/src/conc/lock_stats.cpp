@@ -0,0 +1,68 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include "conc/lock_stats.hpp"
+
+#include "fs/sysfs.hpp"
+
+namespace {
+
+volatile size_t mutex_contentions = 0;
+volatile size_t mutex_spins = 0;
+volatile size_t mutex_boosts = 0;
+volatile size_t rw_lock_contentions = 0;
+volatile size_t rw_lock_boosts = 0;
+
+std::string sysfs_mutex_contentions(){
+    return std::to_string(mutex_contentions);
+}
+
+std::string sysfs_mutex_spins(){
+    return std::to_string(mutex_spins);
+}
+
+std::string sysfs_mutex_boosts(){
+    return std::to_string(mutex_boosts);
+}
+
+std::string sysfs_rw_lock_contentions(){
+    return std::to_string(rw_lock_contentions);
+}
+
+std::string sysfs_rw_lock_boosts(){
+    return std::to_string(rw_lock_boosts);
+}
+
+} //end of anonymous namespace
+
+void lock_stats::init(){
+    sysfs::set_dynamic_value(path("/sys"), path("/locks/mutex/contentions"), &sysfs_mutex_contentions);
+    sysfs::set_dynamic_value(path("/sys"), path("/locks/mutex/spins"), &sysfs_mutex_spins);
+    sysfs::set_dynamic_value(path("/sys"), path("/locks/mutex/boosts"), &sysfs_mutex_boosts);
+    sysfs::set_dynamic_value(path("/sys"), path("/locks/rw_lock/contentions"), &sysfs_rw_lock_contentions);
+    sysfs::set_dynamic_value(path("/sys"), path("/locks/rw_lock/boosts"), &sysfs_rw_lock_boosts);
+}
+
+void lock_stats::mutex_contended(){
+    __sync_fetch_and_add(&mutex_contentions, 1);
+}
+
+void lock_stats::mutex_spun(){
+    __sync_fetch_and_add(&mutex_spins, 1);
+}
+
+void lock_stats::mutex_boosted(){
+    __sync_fetch_and_add(&mutex_boosts, 1);
+}
+
+void lock_stats::rw_lock_contended(){
+    __sync_fetch_and_add(&rw_lock_contentions, 1);
+}
+
+void lock_stats::rw_lock_boosted(){
+    __sync_fetch_and_add(&rw_lock_boosts, 1);
+}
@@ -13,6 +13,7 @@
 #include "drivers/ata_constants.hpp"
 
 #include "conc/mutex.hpp"
+#include "conc/semaphore.hpp"
 
 #include "kernel_utils.hpp"
 #include "kalloc.hpp"
@@ -21,6 +22,8 @@
 #include "console.hpp"
 #include "disks.hpp"
 #include "block_cache.hpp"
+#include "work_queue.hpp"
+#include "trace.hpp"
 
 namespace {
 
@@ -30,17 +33,25 @@ ata::drive_descriptor* drives;
 
 mutex ata_lock;
 
-mutex primary_lock;
-mutex secondary_lock;
+// Signaled at the completion of each command, these have no owner to boost
+semaphore primary_lock;
+semaphore secondary_lock;
 
 block_cache cache;
 
 volatile bool primary_invoked = false;
 volatile bool secondary_invoked = false;
 
+// The waiting process is woken up by a worker, the lock of the semaphore
+// is never taken from the interrupt handler
+
+void unlock_work(void* data){
+    static_cast<semaphore*>(data)->unlock();
+}
+
 void primary_controller_handler(interrupt::syscall_regs*, void*){
     if(scheduler::is_started()){
-        primary_lock.irq_unlock();
+        work_queue::irq_post(&unlock_work, &primary_lock);
     } else {
         primary_invoked = true;
     }
@@ -48,7 +59,7 @@ void primary_controller_handler(interrupt::syscall_regs*, void*){
 
 void secondary_controller_handler(interrupt::syscall_regs*, void*){
     if(scheduler::is_started()){
-        secondary_lock.irq_unlock();
+        work_queue::irq_post(&unlock_work, &secondary_lock);
     } else {
         secondary_invoked = true;
     }
@@ -136,7 +147,7 @@ enum class sector_operation {
     CLEAR
 };
 
-bool read_write_sector(ata::drive_descriptor& drive, uint64_t start, void* data, sector_operation operation){
+bool execute_sector_operation(ata::drive_descriptor& drive, uint64_t start, void* data, sector_operation operation){
     std::lock_guard<decltype(ata_lock)> lock(ata_lock);
 
     //Select the device
@@ -207,6 +218,19 @@ bool read_write_sector(ata::drive_descriptor& drive, uint64_t start, void* data,
     return true;
 }
 
+bool read_write_sector(ata::drive_descriptor& drive, uint64_t start, void* data, sector_operation operation){
+    uint64_t device = (drive.controller << 8) + drive.drive;
+    uint16_t write = operation == sector_operation::READ ? 0 : 1;
+
+    trace::emit(trace::event::BLOCK_SUBMIT, device, start, write);
+
+    auto result = execute_sector_operation(drive, start, data, operation);
+
+    trace::emit(trace::event::BLOCK_COMPLETE, device, start, write | (result ? 0 : 2));
+
+    return result;
+}
+
 bool reset_controller(uint16_t controller){
     out_byte(controller + ATA_DEV_CTL, ATA_CTL_SRST);
 
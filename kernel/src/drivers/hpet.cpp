@@ -15,6 +15,7 @@
 #include "kernel.hpp" // For suspend_kernel
 #include "scheduler.hpp" // For async init
 #include "timer.hpp"     // For setting the frequency
+#include "profiler.hpp"
 
 #include "drivers/pit.hpp" // For uninstalling it
 
@@ -74,7 +75,9 @@ void clear_register_bits(size_t reg, uint64_t bits){
     write_register(reg, read_register(reg) & ~bits);
 }
 
-void timer_handler(interrupt::syscall_regs*, void*){
+void timer_handler(interrupt::syscall_regs* regs, void*){
+    profiler::tick(regs);
+
     // Clears Tn_INT_STS
     set_register_bits(GENERAL_INTERRUPT_REGISTER, 1 << 0);
 
@@ -84,6 +87,10 @@ void timer_handler(interrupt::syscall_regs*, void*){
     timer::tick();
 }
 
+void oneshot(uint64_t ticks){
+    write_register(timer_comparator_reg(0), read_register(MAIN_COUNTER) + ticks * comparator_update);
+}
+
 } //End of anonymous namespace
 
 void hpet::init(){
@@ -158,6 +165,9 @@ void hpet::late_install(){
         timer::counter_fun(hpet::counter);
         timer::counter_frequency(hpet_frequency);
 
+        // The comparator can be programmed for tickless idle
+        timer::oneshot_fun(oneshot);
+
         // Uninstall the PIT driver
         pit::remove();
 
@@ -0,0 +1,197 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <array.hpp>
+
+#include "drivers/ioapic.hpp"
+
+#include "conc/int_lock.hpp"
+
+#include "interrupts.hpp"
+#include "logging.hpp"
+#include "mmap.hpp"
+#include "paging.hpp"
+
+namespace {
+
+constexpr const size_t MAX_IOAPICS = 4;
+constexpr const size_t ISA_IRQS = 16;
+
+// Offset of the registers inside the I/O APIC memory
+constexpr const size_t SELECT_REGISTER = 0x00 / 4;
+constexpr const size_t WINDOW_REGISTER = 0x10 / 4;
+
+// Indirect registers
+constexpr const uint32_t VERSION_REGISTER = 0x01;
+constexpr const uint32_t REDIRECTION_REGISTER = 0x10;
+
+constexpr const uint64_t REDIRECTION_ACTIVE_LOW = 1 << 13;
+constexpr const uint64_t REDIRECTION_LEVEL = 1 << 15;
+constexpr const uint64_t REDIRECTION_MASKED = 1 << 16;
+
+// MPS INTI flags
+constexpr const uint16_t INTI_POLARITY_MASK = 0x3;
+constexpr const uint16_t INTI_POLARITY_LOW = 0x3;
+constexpr const uint16_t INTI_TRIGGER_MASK = 0xC;
+constexpr const uint16_t INTI_TRIGGER_LEVEL = 0xC;
+
+struct ioapic_t {
+    uint8_t id;
+    uint64_t address;
+    uint32_t gsi_base;
+    uint32_t gsi_count;
+    volatile uint32_t* map;
+};
+
+struct override_t {
+    bool present;
+    uint32_t gsi;
+    uint16_t flags;
+};
+
+std::array<ioapic_t, MAX_IOAPICS> ioapics;
+size_t ioapics_count = 0;
+
+std::array<override_t, ISA_IRQS> overrides;
+
+bool installed = false;
+
+uint32_t read_register(ioapic_t& ioapic, uint32_t reg){
+    ioapic.map[SELECT_REGISTER] = reg;
+    return ioapic.map[WINDOW_REGISTER];
+}
+
+void write_register(ioapic_t& ioapic, uint32_t reg, uint32_t value){
+    ioapic.map[SELECT_REGISTER] = reg;
+    ioapic.map[WINDOW_REGISTER] = value;
+}
+
+void write_redirection(ioapic_t& ioapic, uint32_t pin, uint64_t value){
+    write_register(ioapic, REDIRECTION_REGISTER + 2 * pin, value & 0xFFFFFFFF);
+    write_register(ioapic, REDIRECTION_REGISTER + 2 * pin + 1, value >> 32);
+}
+
+ioapic_t* find_ioapic(uint32_t gsi){
+    for(size_t i = 0; i < ioapics_count; ++i){
+        auto& ioapic = ioapics[i];
+
+        if(gsi >= ioapic.gsi_base && gsi < ioapic.gsi_base + ioapic.gsi_count){
+            return &ioapic;
+        }
+    }
+
+    return nullptr;
+}
+
+void route(uint32_t gsi, uint8_t vector, uint16_t flags, uint32_t apic_id){
+    auto* ioapic = find_ioapic(gsi);
+
+    if(!ioapic){
+        logging::logf(logging::log_level::ERROR, "ioapic: No I/O APIC for GSI %u\n", size_t(gsi));
+        return;
+    }
+
+    uint64_t entry = vector;
+
+    if((flags & INTI_POLARITY_MASK) == INTI_POLARITY_LOW){
+        entry |= REDIRECTION_ACTIVE_LOW;
+    }
+
+    if((flags & INTI_TRIGGER_MASK) == INTI_TRIGGER_LEVEL){
+        entry |= REDIRECTION_LEVEL;
+    }
+
+    entry |= static_cast<uint64_t>(apic_id) << 56;
+
+    write_redirection(*ioapic, gsi - ioapic->gsi_base, entry);
+}
+
+} //End of anonymous namespace
+
+void ioapic::add(uint8_t id, uint64_t address, uint32_t gsi_base){
+    if(ioapics_count == MAX_IOAPICS){
+        logging::logf(logging::log_level::ERROR, "ioapic: Too many I/O APICs, ignoring %u\n", size_t(id));
+        return;
+    }
+
+    auto& ioapic = ioapics[ioapics_count++];
+
+    ioapic.id = id;
+    ioapic.address = address;
+    ioapic.gsi_base = gsi_base;
+    ioapic.gsi_count = 0;
+    ioapic.map = nullptr;
+}
+
+void ioapic::add_override(uint8_t irq, uint32_t gsi, uint16_t flags){
+    if(irq >= ISA_IRQS){
+        return;
+    }
+
+    overrides[irq].present = true;
+    overrides[irq].gsi = gsi;
+    overrides[irq].flags = flags;
+}
+
+bool ioapic::install(uint32_t apic_id){
+    if(!ioapics_count){
+        logging::logf(logging::log_level::DEBUG, "ioapic: No I/O APIC found\n");
+        return false;
+    }
+
+    for(size_t i = 0; i < ioapics_count; ++i){
+        auto& ioapic = ioapics[i];
+
+        ioapic.map = static_cast<volatile uint32_t*>(mmap_phys(ioapic.address, paging::PAGE_SIZE));
+
+        if(!ioapic.map){
+            logging::logf(logging::log_level::ERROR, "ioapic: Unable to map I/O APIC %u\n", size_t(ioapic.id));
+            return false;
+        }
+
+        ioapic.gsi_count = ((read_register(ioapic, VERSION_REGISTER) >> 16) & 0xFF) + 1;
+
+        logging::logf(logging::log_level::TRACE, "ioapic: I/O APIC %u handles GSI %u-%u\n",
+            size_t(ioapic.id), size_t(ioapic.gsi_base), size_t(ioapic.gsi_base + ioapic.gsi_count - 1));
+    }
+
+    // The routing must not be interrupted
+    direct_int_lock lock;
+
+    // Mask everything first
+    for(size_t i = 0; i < ioapics_count; ++i){
+        for(uint32_t pin = 0; pin < ioapics[i].gsi_count; ++pin){
+            write_redirection(ioapics[i], pin, REDIRECTION_MASKED);
+        }
+    }
+
+    // Route the ISA IRQs to their usual vectors
+    for(size_t irq = 0; irq < ISA_IRQS; ++irq){
+        // IRQ 2 is only the cascade of the PIC
+        if(irq == 2 && !overrides[irq].present){
+            continue;
+        }
+
+        if(overrides[irq].present){
+            route(overrides[irq].gsi, interrupt::IRQ_VECTOR_BASE + irq, overrides[irq].flags, apic_id);
+        } else {
+            route(irq, interrupt::IRQ_VECTOR_BASE + irq, 0, apic_id);
+        }
+    }
+
+    interrupt::disable_pic();
+
+    installed = true;
+
+    logging::logf(logging::log_level::TRACE, "ioapic: ISA IRQs routed to APIC %u\n", size_t(apic_id));
+
+    return true;
+}
+
+bool ioapic::enabled(){
+    return installed;
+}
@@ -0,0 +1,177 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include "drivers/lapic.hpp"
+
+#include "arch.hpp"
+#include "logging.hpp"
+#include "mmap.hpp"
+#include "paging.hpp"
+#include "timer.hpp"
+
+namespace {
+
+constexpr const uint32_t APIC_BASE_MSR = 0x1B;
+constexpr const uint64_t APIC_BASE_ENABLE = 1 << 11;
+
+// Offset of the registers inside the local APIC memory
+constexpr const size_t ID_REGISTER = 0x20 / 4;
+constexpr const size_t TPR_REGISTER = 0x80 / 4;
+constexpr const size_t EOI_REGISTER = 0xB0 / 4;
+constexpr const size_t SPURIOUS_REGISTER = 0xF0 / 4;
+constexpr const size_t ICR_LOW_REGISTER = 0x300 / 4;
+constexpr const size_t ICR_HIGH_REGISTER = 0x310 / 4;
+constexpr const size_t LVT_TIMER_REGISTER = 0x320 / 4;
+constexpr const size_t LVT_LINT0_REGISTER = 0x350 / 4;
+constexpr const size_t LVT_LINT1_REGISTER = 0x360 / 4;
+constexpr const size_t LVT_ERROR_REGISTER = 0x370 / 4;
+constexpr const size_t TIMER_INITIAL_REGISTER = 0x380 / 4;
+constexpr const size_t TIMER_CURRENT_REGISTER = 0x390 / 4;
+constexpr const size_t TIMER_DIVIDE_REGISTER = 0x3E0 / 4;
+
+constexpr const uint32_t SPURIOUS_ENABLE = 1 << 8;
+constexpr const uint32_t SPURIOUS_VECTOR = 63;
+
+constexpr const uint32_t LVT_MASKED = 1 << 16;
+constexpr const uint32_t LVT_TIMER_PERIODIC = 1 << 17;
+
+constexpr const uint32_t ICR_INIT = 0x5 << 8;
+constexpr const uint32_t ICR_STARTUP = 0x6 << 8;
+constexpr const uint32_t ICR_PENDING = 1 << 12;
+constexpr const uint32_t ICR_ASSERT = 1 << 14;
+
+constexpr const uint32_t TIMER_DIVIDE_16 = 0x3;
+
+// Duration of the calibration of the timer
+constexpr const uint64_t CALIBRATION_MS = 10;
+
+volatile uint32_t* lapic_map = nullptr;
+uint64_t timer_ticks_per_second = 0;
+
+uint32_t read_register(size_t reg){
+    return lapic_map[reg];
+}
+
+void write_register(size_t reg, uint32_t value){
+    lapic_map[reg] = value;
+}
+
+void wait_icr(){
+    while(read_register(ICR_LOW_REGISTER) & ICR_PENDING){
+        arch::pause();
+    }
+}
+
+void send_icr(uint32_t apic_id, uint32_t value){
+    wait_icr();
+
+    write_register(ICR_HIGH_REGISTER, apic_id << 24);
+    write_register(ICR_LOW_REGISTER, value);
+
+    wait_icr();
+}
+
+void enable_local(){
+    // Make sure the APIC is globally enabled
+    arch::write_msr(APIC_BASE_MSR, arch::read_msr(APIC_BASE_MSR) | APIC_BASE_ENABLE);
+
+    // Accept all interrupts
+    write_register(TPR_REGISTER, 0);
+
+    // Mask the local interrupts, they are not used
+    write_register(LVT_TIMER_REGISTER, LVT_MASKED);
+    write_register(LVT_LINT0_REGISTER, LVT_MASKED);
+    write_register(LVT_LINT1_REGISTER, LVT_MASKED);
+    write_register(LVT_ERROR_REGISTER, LVT_MASKED);
+
+    // Software enable the APIC
+    write_register(SPURIOUS_REGISTER, SPURIOUS_ENABLE | SPURIOUS_VECTOR);
+}
+
+} //End of anonymous namespace
+
+bool lapic::install(uint64_t address){
+    lapic_map = static_cast<volatile uint32_t*>(mmap_phys(address, paging::PAGE_SIZE));
+
+    if(!lapic_map){
+        logging::logf(logging::log_level::ERROR, "lapic: Unable to map the local APIC\n");
+        return false;
+    }
+
+    enable_local();
+
+    logging::logf(logging::log_level::TRACE, "lapic: Local APIC %u enabled at %h\n", size_t(id()), address);
+
+    return true;
+}
+
+void lapic::init_ap(){
+    enable_local();
+}
+
+bool lapic::enabled(){
+    return lapic_map;
+}
+
+uint32_t lapic::id(){
+    return read_register(ID_REGISTER) >> 24;
+}
+
+void lapic::eoi(){
+    write_register(EOI_REGISTER, 0);
+}
+
+void lapic::send_init(uint32_t apic_id){
+    send_icr(apic_id, ICR_INIT | ICR_ASSERT);
+}
+
+void lapic::send_startup(uint32_t apic_id, uint8_t page){
+    send_icr(apic_id, ICR_STARTUP | ICR_ASSERT | page);
+}
+
+void lapic::send_ipi(uint32_t apic_id, uint8_t vector){
+    send_icr(apic_id, ICR_ASSERT | vector);
+}
+
+void lapic::calibrate_timer(){
+    auto counter_frequency = timer::counter_frequency();
+    auto wait = (counter_frequency * CALIBRATION_MS) / 1000;
+
+    write_register(TIMER_DIVIDE_REGISTER, TIMER_DIVIDE_16);
+    write_register(LVT_TIMER_REGISTER, LVT_MASKED);
+
+    // Wait for the beginning of a new counter period
+    auto start = timer::counter();
+    while(timer::counter() == start){
+        arch::pause();
+    }
+
+    start = timer::counter();
+    write_register(TIMER_INITIAL_REGISTER, 0xFFFFFFFF);
+
+    while(timer::counter() - start < wait){
+        arch::pause();
+    }
+
+    auto elapsed = 0xFFFFFFFF - read_register(TIMER_CURRENT_REGISTER);
+    write_register(TIMER_INITIAL_REGISTER, 0);
+
+    timer_ticks_per_second = (elapsed * 1000) / CALIBRATION_MS;
+
+    logging::logf(logging::log_level::TRACE, "lapic: Timer frequency %uHz\n", timer_ticks_per_second);
+}
+
+void lapic::start_timer(uint64_t frequency, uint8_t vector){
+    write_register(TIMER_DIVIDE_REGISTER, TIMER_DIVIDE_16);
+    write_register(LVT_TIMER_REGISTER, LVT_TIMER_PERIODIC | vector);
+    write_register(TIMER_INITIAL_REGISTER, timer_ticks_per_second / frequency);
+}
+
+void lapic::stop_timer(){
+    write_register(LVT_TIMER_REGISTER, LVT_MASKED);
+    write_register(TIMER_INITIAL_REGISTER, 0);
+}
@@ -22,17 +22,19 @@ struct loopback_t {
     network::interface_descriptor* interface;
 };
 
-void send_packet(network::interface_descriptor& interface, network::ethernet::packet& packet){
+bool send_packet(network::interface_descriptor& interface, network::ethernet::packet& packet){
     logging::logf(logging::log_level::TRACE, "loopback: Transmit packet\n");
 
     auto packet_buffer = new char[packet.payload_size];
 
     std::copy_n(packet.payload, packet.payload_size, packet_buffer);
 
-    interface.rx_queue.emplace_push(packet_buffer, packet.payload_size);
-    interface.rx_sem.unlock();
+    network::ethernet::packet loop_packet(packet_buffer, packet.payload_size);
+    interface.receive(loop_packet);
 
     logging::logf(logging::log_level::TRACE, "loopback: Packet transmitted correctly\n");
+
+    return true;
 }
 
 } //end of anonymous namespace
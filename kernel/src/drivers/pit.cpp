@@ -12,6 +12,7 @@
 #include "scheduler.hpp"
 #include "kernel_utils.hpp"
 #include "logging.hpp"
+#include "profiler.hpp"
 
 namespace {
 
@@ -19,9 +20,11 @@ constexpr const uint64_t PIT_FREQUENCY = 1000;
 
 size_t pit_counter = 0;
 
-void timer_handler(interrupt::syscall_regs*, void*){
+void timer_handler(interrupt::syscall_regs* regs, void*){
     ++pit_counter;
 
+    profiler::tick(regs);
+
     timer::tick();
 }
 
@@ -7,7 +7,7 @@
 
 #include "drivers/rtl8139.hpp"
 
-#include "conc/int_lock.hpp"
+#include "conc/semaphore.hpp"
 
 #include "net/ethernet_layer.hpp"
 
@@ -17,6 +17,7 @@
 #include "virtual_allocator.hpp"
 #include "interrupts.hpp"
 #include "paging.hpp"
+#include "work_queue.hpp"
 
 #define MAC0 0x00
 #define MAC4 0x04
@@ -84,25 +85,25 @@ struct rtl8139_t {
     tx_desc_t tx_desc[tx_buffers];
     semaphore tx_sem;
 
+    volatile bool rx_scheduled; //Indicates if the reception work is posted
+
     network::interface_descriptor* interface;
 };
 
-void packet_handler(interrupt::syscall_regs*, void* data){
+bool rx_empty(rtl8139_t& desc){
+    return in_byte(desc.iobase + CMD) & CMD_NOT_EMPTY;
+}
+
+// Copy the received packets out of the receive buffer, outside of the
+// interrupt handler. Only one reception work is posted at a time.
+void rx_work(void* data){
     auto& desc = *static_cast<rtl8139_t*>(data);
     auto& interface = *desc.interface;
 
-    // Get the interrupt status
-    auto status = in_word(desc.iobase + ISR);
-
-    // Acknowledge the handling of the packet
-    out_word(desc.iobase + ISR, status);
-
-    if(status & RX_OK){
-        logging::logf(logging::log_level::TRACE, "rtl8139: Packet received correctly OK\n");
-
+    while(true){
         auto cur_rx = desc.cur_rx;
 
-        while((in_byte(desc.iobase + CMD) & CMD_NOT_EMPTY) == 0){
+        while(!rx_empty(desc)){
             auto cur_offset = cur_rx % 0x3000;
             auto buffer_rx = reinterpret_cast<char*>(desc.buffer_rx);
 
@@ -129,8 +130,7 @@ void packet_handler(interrupt::syscall_regs*, void* data){
 
                 network::ethernet::packet packet(packet_buffer, packet_only_length);
 
-                interface.rx_queue.push(packet);
-                interface.rx_sem.irq_unlock();
+                interface.receive(packet);
             }
 
             cur_rx = (cur_rx + packet_length + 4 + 3) & ~3; //align on 4 bytes
@@ -140,6 +140,35 @@ void packet_handler(interrupt::syscall_regs*, void* data){
         }
 
         desc.cur_rx = cur_rx;
+
+        desc.rx_scheduled = false;
+        __sync_synchronize();
+
+        // A packet may have arrived after the buffer was seen empty,
+        // unless the interrupt handler already posted a new work
+        if(rx_empty(desc) || __sync_lock_test_and_set(&desc.rx_scheduled, true)){
+            break;
+        }
+    }
+}
+
+void packet_handler(interrupt::syscall_regs*, void* data){
+    auto& desc = *static_cast<rtl8139_t*>(data);
+
+    // Get the interrupt status
+    auto status = in_word(desc.iobase + ISR);
+
+    // Acknowledge the handling of the packet
+    out_word(desc.iobase + ISR, status);
+
+    if(status & RX_OK){
+        logging::logf(logging::log_level::TRACE, "rtl8139: Packet received correctly OK\n");
+
+        if(!__sync_lock_test_and_set(&desc.rx_scheduled, true)){
+            if(!work_queue::irq_post(&rx_work, &desc)){
+                desc.rx_scheduled = false;
+            }
+        }
     }
 
     if(status & (TX_OK | TX_ERR)){
@@ -173,6 +202,10 @@ void packet_handler(interrupt::syscall_regs*, void* data){
         }
 
         desc.tx_sem.irq_release(cleaned_up);
+
+        if(cleaned_up && desc.interface){
+            desc.interface->tx_ready();
+        }
     }
 
     if(!(status & (RX_OK | TX_OK | TX_ERR))){
@@ -182,7 +215,7 @@ void packet_handler(interrupt::syscall_regs*, void* data){
     }
 }
 
-void send_packet(network::interface_descriptor& interface, network::ethernet::packet& packet){
+bool send_packet(network::interface_descriptor& interface, network::ethernet::packet& packet){
     logging::logf(logging::log_level::TRACE, "rtl8139: Start transmitting packet\n");
 
     auto* ether_header = reinterpret_cast<network::ethernet::header*>(packet.payload);
@@ -193,21 +226,21 @@ void send_packet(network::interface_descriptor& interface, network::ethernet::pa
 
         std::copy_n(packet.payload, packet.payload_size, packet_buffer);
 
-        direct_int_lock lock;
-
-        interface.rx_queue.emplace_push(packet_buffer, packet.payload_size);
-        interface.rx_sem.unlock();
+        network::ethernet::packet self_packet(packet_buffer, packet.payload_size);
+        interface.receive(self_packet);
 
         logging::logf(logging::log_level::TRACE, "rtl8139: Packet to self transmitted correctly\n");
 
-        return;
+        return true;
     }
 
     auto& desc = *reinterpret_cast<rtl8139_t*>(interface.driver_data);
     auto iobase = desc.iobase;
 
-    // Wait for a free entry in the tx buffers
-    desc.tx_sem.lock();
+    // The packet is sent again once the interrupt handler frees an entry
+    if(!desc.tx_sem.try_lock()){
+        return false;
+    }
 
     // Claim an entry in the tx buffers
     auto entry = __sync_fetch_and_add(&desc.cur_tx, 1) % tx_buffers;
@@ -218,6 +251,8 @@ void send_packet(network::interface_descriptor& interface, network::ethernet::pa
 
     out_dword(iobase + TX_ADDR + entry * 4, tx_desc.buffer_phys);
     out_dword(iobase + TX_STATUS + entry * 4, uint32_t(256) << 16 | packet.payload_size);
+
+    return true;
 }
 
 } //end of anonymous namespace
@@ -231,6 +266,7 @@ void rtl8139::init_driver(network::interface_descriptor& interface, pci::device_
     interface.hw_send = send_packet;
 
     desc->tx_sem.init(tx_buffers);
+    desc->rx_scheduled = false;
 
     for(size_t i = 0; i < tx_buffers; ++i){
         auto& tx_desc = desc->tx_desc[i];
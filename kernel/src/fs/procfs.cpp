@@ -16,6 +16,8 @@
 
 #include "scheduler.hpp"
 #include "logging.hpp"
+#include "timer.hpp"
+#include "syscall_stats.hpp"
 
 namespace {
 
@@ -34,6 +36,17 @@ size_t read(const std::string& value, char* buffer, size_t count, size_t offset,
     return 0;
 }
 
+// Convert TSC cycles to microseconds
+uint64_t microseconds(uint64_t cycles){
+    auto frequency = timer::tsc_frequency();
+
+    if(frequency < 1000000){
+        return 0;
+    }
+
+    return cycles / (frequency / 1000000);
+}
+
 std::string get_value(uint64_t pid, const std::string& name){
     auto& process = pcb[pid];
 
@@ -51,6 +64,22 @@ std::string get_value(uint64_t pid, const std::string& name){
         return process.process.name;
     } else if(name == "memory"){
         return std::to_string(process.process.brk_end - process.process.brk_start);
+    } else if(name == "user_time"){
+        return std::to_string(microseconds(process.user_time));
+    } else if(name == "kernel_time"){
+        return std::to_string(microseconds(process.kernel_time));
+    } else if(name == "wait_time"){
+        return std::to_string(microseconds(process.wait_time));
+    } else if(name == "voluntary_switches"){
+        return std::to_string(process.voluntary_switches);
+    } else if(name == "involuntary_switches"){
+        return std::to_string(process.involuntary_switches);
+    } else if(name == "system_calls"){
+        return std::to_string(process.system_calls);
+    } else if(name == "fpu_traps"){
+        return std::to_string(process.fpu_traps);
+    } else if(name == "syscalls"){
+        return syscall_stats::process_statistics(pid);
     } else {
         return "";
     }
@@ -63,7 +92,7 @@ void procfs::set_pcb(const scheduler::process_control_t* pcb_ptr){
 }
 
 procfs::procfs_file_system::procfs_file_system(path mp) : mount_point(mp) {
-    standard_contents.reserve(7);
+    standard_contents.reserve(15);
     standard_contents.emplace_back("pid", false, false, false, 0UL);
     standard_contents.emplace_back("ppid", false, false, false, 0UL);
     standard_contents.emplace_back("state", false, false, false, 0UL);
@@ -71,6 +100,14 @@ procfs::procfs_file_system::procfs_file_system(path mp) : mount_point(mp) {
     standard_contents.emplace_back("priority", false, false, false, 0UL);
     standard_contents.emplace_back("name", false, false, false, 0UL);
     standard_contents.emplace_back("memory", false, false, false, 0UL);
+    standard_contents.emplace_back("user_time", false, false, false, 0UL);
+    standard_contents.emplace_back("kernel_time", false, false, false, 0UL);
+    standard_contents.emplace_back("wait_time", false, false, false, 0UL);
+    standard_contents.emplace_back("voluntary_switches", false, false, false, 0UL);
+    standard_contents.emplace_back("involuntary_switches", false, false, false, 0UL);
+    standard_contents.emplace_back("system_calls", false, false, false, 0UL);
+    standard_contents.emplace_back("syscalls", false, false, false, 0UL);
+    standard_contents.emplace_back("fpu_traps", false, false, false, 0UL);
 }
 
 procfs::procfs_file_system::~procfs_file_system(){
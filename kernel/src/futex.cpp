@@ -0,0 +1,169 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <array.hpp>
+#include <lock_guard.hpp>
+
+#include <tlib/errors.hpp>
+
+#include "futex.hpp"
+#include "scheduler.hpp"
+#include "paging.hpp"
+#include "logging.hpp"
+
+#include "conc/int_spinlock.hpp"
+
+namespace {
+
+constexpr const size_t buckets = 64;
+
+// A process waiting on a word, the pcb is indexed by pid
+struct waiter_t {
+    size_t key;             ///< The physical address of the word
+    scheduler::pid_t next;  ///< The next waiter in the bucket
+    volatile bool queued;   ///< Indicates if the process is in a queue
+};
+
+struct bucket_t {
+    int_spinlock lock;
+    scheduler::pid_t head = scheduler::INVALID_PID;
+};
+
+std::array<waiter_t, scheduler::MAX_PROCESS> waiters;
+std::array<bucket_t, buckets> table;
+
+bucket_t& bucket_of(size_t key){
+    // The low bits are constant for aligned words
+    auto hash = (key >> 2) ^ (key >> 12);
+    return table[hash % buckets];
+}
+
+void push(bucket_t& bucket, scheduler::pid_t pid, size_t key){
+    auto& waiter = waiters[pid];
+
+    waiter.key = key;
+    waiter.next = bucket.head;
+    waiter.queued = true;
+
+    bucket.head = pid;
+}
+
+// Unlink the given process from the bucket
+void remove(bucket_t& bucket, scheduler::pid_t pid){
+    auto* link = &bucket.head;
+
+    while(*link != scheduler::INVALID_PID){
+        if(*link == pid){
+            *link = waiters[pid].next;
+            break;
+        }
+
+        link = &waiters[*link].next;
+    }
+
+    waiters[pid].queued = false;
+}
+
+size_t key_of(size_t address){
+    if(address & 3){
+        return 0;
+    }
+
+    return paging::user_physical_address(scheduler::get_leader(), address);
+}
+
+} //end of anonymous namespace
+
+std::expected<void> futex::wait(size_t address, uint32_t expected, size_t ms){
+    auto key = key_of(address);
+
+    if(!key){
+        return std::make_unexpected<void>(std::ERROR_INVALID_REQUEST);
+    }
+
+    auto pid = scheduler::get_pid();
+    auto& bucket = bucket_of(key);
+
+    bucket.lock.lock();
+
+    // The value may have changed since userspace checked it
+    if(*reinterpret_cast<volatile uint32_t*>(address) != expected){
+        bucket.lock.unlock();
+
+        return std::make_unexpected<void>(std::ERROR_WOULD_BLOCK);
+    }
+
+    push(bucket, pid, key);
+
+    if(ms){
+        scheduler::block_process_timeout_light(pid, ms);
+    } else {
+        scheduler::block_process_light(pid);
+    }
+
+    bucket.lock.unlock();
+
+    scheduler::reschedule();
+
+    // Still in the queue means nobody woke us up
+    std::lock_guard<int_spinlock> l(bucket.lock);
+
+    if(waiters[pid].queued){
+        remove(bucket, pid);
+
+        return std::make_unexpected<void>(std::ERROR_TIMEOUT);
+    }
+
+    return {};
+}
+
+std::expected<size_t> futex::wake(size_t address, size_t n){
+    auto key = key_of(address);
+
+    if(!key){
+        return std::make_unexpected<size_t>(std::ERROR_INVALID_REQUEST);
+    }
+
+    auto& bucket = bucket_of(key);
+
+    std::lock_guard<int_spinlock> l(bucket.lock);
+
+    size_t woken = 0;
+
+    auto* link = &bucket.head;
+
+    while(*link != scheduler::INVALID_PID && woken < n){
+        auto pid = *link;
+        auto& waiter = waiters[pid];
+
+        // A waiter that timed out removes itself from the queue
+        if(waiter.key == key && scheduler::try_unblock_process(pid)){
+            *link = waiter.next;
+            waiter.queued = false;
+
+            ++woken;
+        } else {
+            link = &waiter.next;
+        }
+    }
+
+    return woken;
+}
+
+void futex::interrupt(scheduler::pid_t pid){
+    if(!waiters[pid].queued){
+        return;
+    }
+
+    auto& bucket = bucket_of(waiters[pid].key);
+
+    std::lock_guard<int_spinlock> l(bucket.lock);
+
+    if(waiters[pid].queued && scheduler::try_unblock_process(pid)){
+        remove(bucket, pid);
+    }
+}
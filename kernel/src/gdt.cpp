@@ -5,13 +5,102 @@
 //  http://www.opensource.org/licenses/MIT)
 //=======================================================================
 
+#include <algorithms.hpp>
+
 #include "gdt.hpp"
-#include "early_memory.hpp"
+#include "smp.hpp"
+
+namespace {
+
+// Number of segments set up by the init stage (null, code, data, long, user code, user data)
+constexpr const size_t SEGMENTS = 6;
+
+struct gdt_pointer_64 {
+    uint16_t length;
+    uint64_t pointer;
+} __attribute__ ((packed));
+
+// Number of segments used by SYSCALL/SYSRET
+constexpr const size_t SYSCALL_SEGMENTS = 4;
+
+// Each TSS descriptor takes two entries
+gdt::gdt_descriptor_t gdt_table[SEGMENTS + 2 * smp::MAX_CPUS + SYSCALL_SEGMENTS];
+gdt::task_state_segment_t tss_table[smp::MAX_CPUS];
+
+gdt_pointer_64 gdtr;
+
+uint16_t tss_selector(size_t cpu){
+    return gdt::TSS_SELECTOR + cpu * sizeof(gdt::tss_descriptor_t);
+}
+
+void set_tss_descriptor(size_t cpu){
+    auto base = reinterpret_cast<uint64_t>(&tss_table[cpu]);
+    auto limit = sizeof(gdt::task_state_segment_t) - 1;
+
+    auto tss_descriptor = reinterpret_cast<gdt::tss_descriptor_t*>(&gdt_table[SEGMENTS + 2 * cpu]);
+    tss_descriptor->type = gdt::SEG_TSS_AVAILABLE;
+    tss_descriptor->always_0_1 = 0;
+    tss_descriptor->always_0_2 = 0;
+    tss_descriptor->always_0_3 = 0;
+    tss_descriptor->dpl = 3;
+    tss_descriptor->present = 1;
+    tss_descriptor->avl = 0;
+    tss_descriptor->granularity = 0;
+
+    tss_descriptor->base_low = base & 0xFFFFFF;
+    tss_descriptor->base_middle = (base >> 24) & 0xFF;
+    tss_descriptor->base_high = base >> 32;
+
+    tss_descriptor->limit_low = limit & 0xFFFF;
+    tss_descriptor->limit_high = (limit >> 16) & 0xF;
+
+    // No I/O permission bitmap
+    tss_table[cpu].io_map_base_address = sizeof(gdt::task_state_segment_t);
+}
 
-void gdt::flush_tss(){
-    asm volatile("mov ax, %0; ltr ax;" : : "i" (gdt::TSS_SELECTOR + 0x3) : "rax");
+void load_gdt(){
+    asm volatile("lgdt [%0]" : : "m" (gdtr));
+}
+
+void load_tss(size_t cpu){
+    asm volatile("ltr %0" : : "r" (static_cast<uint16_t>(tss_selector(cpu) + 0x3)));
+}
+
+} //end of anonymous namespace
+
+void gdt::init(){
+    // Reuse the segments prepared by the init stage
+    gdt_pointer_64 current;
+    asm volatile("sgdt %0" : "=m" (current));
+
+    std::copy_n(reinterpret_cast<gdt_descriptor_t*>(current.pointer), SEGMENTS, &gdt_table[0]);
+
+    for(size_t cpu = 0; cpu < smp::MAX_CPUS; ++cpu){
+        set_tss_descriptor(cpu);
+    }
+
+    // SYSCALL/SYSRET need the segments in a fixed order
+    gdt_table[SYSCALL_CODE_SELECTOR / 8] = gdt_table[LONG_SELECTOR / 8];
+    gdt_table[SYSCALL_DATA_SELECTOR / 8] = gdt_table[DATA_SELECTOR / 8];
+    gdt_table[SYSRET_DATA_SELECTOR / 8] = gdt_table[USER_DATA_SELECTOR / 8];
+    gdt_table[SYSRET_CODE_SELECTOR / 8] = gdt_table[USER_CODE_SELECTOR / 8];
+
+    gdtr.length = sizeof(gdt_table) - 1;
+    gdtr.pointer = reinterpret_cast<uint64_t>(&gdt_table[0]);
+
+    load_gdt();
+    load_tss(0);
+}
+
+void gdt::init_ap(size_t cpu){
+    load_gdt();
+    load_tss(cpu);
 }
 
 gdt::task_state_segment_t& gdt::tss(){
-    return *reinterpret_cast<task_state_segment_t*>(early::tss_address);
+    return tss_table[smp::current_cpu()];
+}
+
+gdt::task_state_segment_t& gdt::tss(size_t cpu){
+    return tss_table[cpu];
 }
@@ -6,13 +6,19 @@
 //=======================================================================
 
 #include <types.hpp>
+#include <array.hpp>
 
 #include "interrupts.hpp"
 #include "console.hpp"
 #include "kernel_utils.hpp"
 #include "gdt.hpp"
+#include "arch.hpp"
+#include "smp.hpp"
 #include "scheduler.hpp"
 #include "logging.hpp"
+#include "trace.hpp"
+
+#include "drivers/lapic.hpp"
 
 #include "isrs.hpp"
 #include "irqs.hpp"
@@ -49,10 +55,35 @@ struct idtr {
 idt_entry idt_64[64];
 idtr idtr_64;
 
-void (*irq_handlers[16])(interrupt::syscall_regs*, void*);
-void* irq_handler_data[16];
+void (*irq_handlers[interrupt::IRQ_MAX])(interrupt::syscall_regs*, void*);
+void* irq_handler_data[interrupt::IRQ_MAX];
 void (*syscall_handlers[interrupt::SYSCALL_MAX])(interrupt::syscall_regs*);
 
+// Indicates if the interrupts are acknowledged through the local APIC
+volatile bool apic_eoi = false;
+
+constexpr const uint32_t MSR_EFER = 0xC0000080;
+constexpr const uint32_t MSR_STAR = 0xC0000081;
+constexpr const uint32_t MSR_LSTAR = 0xC0000082;
+constexpr const uint32_t MSR_SFMASK = 0xC0000084;
+constexpr const uint32_t MSR_KERNEL_GS_BASE = 0xC0000102;
+
+constexpr const uint64_t EFER_SCE = 1 << 0;
+
+// TF, IF and DF are cleared on SYSCALL
+constexpr const uint64_t SYSCALL_FLAGS_MASK = 0x700;
+
+// The per-processor data used by the SYSCALL entry point, through
+// the kernel GS base. The layout is used by syscalls.s
+struct syscall_cpu_t {
+    gdt::task_state_segment_t* tss; ///< The TSS of the processor, holding the kernel stack
+    uint64_t user_rsp;              ///< Scratch space for the user stack pointer
+    uint64_t user_ss;               ///< The user stack segment set by SYSRET
+    uint64_t user_cs;               ///< The user code segment set by SYSRET
+} __attribute__((packed));
+
+std::array<syscall_cpu_t, smp::MAX_CPUS> syscall_cpus;
+
 void idt_set_gate(size_t gate, void (*function)(void), uint16_t gdt_selector, idt_flags flags){
     auto& entry = idt_64[gate];
 
@@ -88,8 +119,8 @@ void install_idt(){
     std::fill_n(reinterpret_cast<size_t*>(idt_64), 64 * sizeof(idt_entry) / sizeof(size_t), 0);
 
     //Clear the IRQ handlers
-    std::fill_n(irq_handlers, 16, nullptr);
-    std::fill_n(irq_handler_data, 16, nullptr);
+    std::fill_n(irq_handlers, interrupt::IRQ_MAX, nullptr);
+    std::fill_n(irq_handler_data, interrupt::IRQ_MAX, nullptr);
 
     //Give the IDTR address to the CPU
     asm volatile("lidt [%0]" : : "m" (idtr_64));
@@ -170,6 +201,12 @@ void install_irqs(){
     idt_set_gate(45, _irq13, gdt::LONG_SELECTOR, {gdt::SEG_INTERRUPT_GATE, 0, 0, 1});
     idt_set_gate(46, _irq14, gdt::LONG_SELECTOR, {gdt::SEG_INTERRUPT_GATE, 0, 0, 1});
     idt_set_gate(47, _irq15, gdt::LONG_SELECTOR, {gdt::SEG_INTERRUPT_GATE, 0, 0, 1});
+
+    // Interrupts coming from the local APIC
+    idt_set_gate(48, _irq16, gdt::LONG_SELECTOR, {gdt::SEG_INTERRUPT_GATE, 0, 0, 1});
+    idt_set_gate(49, _irq17, gdt::LONG_SELECTOR, {gdt::SEG_INTERRUPT_GATE, 0, 0, 1});
+    idt_set_gate(interrupt::TLB_SHOOTDOWN_VECTOR, _irq18, gdt::LONG_SELECTOR, {gdt::SEG_INTERRUPT_GATE, 0, 0, 1});
+    idt_set_gate(63, _irq_spurious, gdt::LONG_SELECTOR, {gdt::SEG_INTERRUPT_GATE, 0, 0, 1});
 }
 
 void install_syscalls(){
@@ -185,6 +222,23 @@ void install_syscalls(){
     idt_set_gate(interrupt::SYSCALL_FIRST+9, _syscall9, gdt::LONG_SELECTOR, {gdt::SEG_INTERRUPT_GATE, 0, 3, 1});
 }
 
+void install_fast_syscalls(size_t cpu){
+    auto& data = syscall_cpus[cpu];
+
+    data.tss = &gdt::tss(cpu);
+    data.user_ss = gdt::SYSRET_DATA_SELECTOR + 3;
+    data.user_cs = gdt::SYSRET_CODE_SELECTOR + 3;
+
+    arch::write_msr(MSR_KERNEL_GS_BASE, reinterpret_cast<uint64_t>(&data));
+
+    // SYSRET adds 8 (SS) and 16 (CS) to its base selector
+    arch::write_msr(MSR_STAR, (uint64_t(gdt::SYSCALL_DATA_SELECTOR) << 48) | (uint64_t(gdt::SYSCALL_CODE_SELECTOR) << 32));
+    arch::write_msr(MSR_LSTAR, reinterpret_cast<uint64_t>(&_syscall_fast));
+    arch::write_msr(MSR_SFMASK, SYSCALL_FLAGS_MASK);
+
+    arch::write_msr(MSR_EFER, arch::read_msr(MSR_EFER) | EFER_SCE);
+}
+
 void enable_interrupts(){
     asm volatile("sti" : : );
 }
@@ -253,28 +307,68 @@ void _fault_handler(interrupt::fault_regs regs){
     }
 }
 
+size_t _fpu_trap_handler(){
+    return scheduler::fpu_trap();
+}
+
 void _irq_handler(interrupt::syscall_regs* regs){
-    //If the IRQ is on the slave controller, send EOI to it
-    if(regs->code >= 8){
-        out_byte(0xA0, 0x20);
+    trace::emit(trace::event::IRQ_ENTRY, regs->code, regs->rip);
+
+    bool from_user = (regs->cs & 3) == 3 && scheduler::is_started();
+
+    if(from_user){
+        scheduler::kernel_entry(false);
     }
 
-    //Send EOI to the master controller
-    out_byte(0x20, 0x20);
+    if(apic_eoi || regs->code >= 16){
+        lapic::eoi();
+    } else {
+        //If the IRQ is on the slave controller, send EOI to it
+        if(regs->code >= 8){
+            out_byte(0xA0, 0x20);
+        }
+
+        //Send EOI to the master controller
+        out_byte(0x20, 0x20);
+    }
 
     //If there is an handler, call it
     if(irq_handlers[regs->code]){
         irq_handlers[regs->code](regs, irq_handler_data[regs->code]);
     }
+
+    if(from_user){
+        //A thread whose process exited terminates before returning to user space
+        if(scheduler::exit_requested()){
+            scheduler::kill_current_process();
+        }
+
+        scheduler::kernel_exit();
+    }
 }
 
 void _syscall_handler(interrupt::syscall_regs* regs){
+    bool started = scheduler::is_started();
+
+    if(started){
+        scheduler::kernel_entry(true);
+    }
+
     //If there is a handler call it
     if(syscall_handlers[regs->code]){
         syscall_handlers[regs->code](regs);
     }
 
     //TODO Emit an error somehow if there is no handler
+
+    if(started){
+        //A thread whose process exited terminates before returning to user space
+        if(scheduler::exit_requested()){
+            scheduler::kill_current_process();
+        }
+
+        scheduler::kernel_exit();
+    }
 }
 
 } //end of extern "C"
@@ -285,7 +379,7 @@ bool interrupt::register_irq_handler(size_t irq, void (*handler)(interrupt::sysc
         return false;
     }
 
-    if(irq > 15){
+    if(irq >= interrupt::IRQ_MAX){
         logging::logf(logging::log_level::ERROR, "Register interrupt %u too high\n", irq);
         return false;
     }
@@ -318,7 +412,7 @@ bool interrupt::unregister_irq_handler(size_t irq, void (*handler)(interrupt::sy
         return false;
     }
 
-    if(irq > 15){
+    if(irq >= interrupt::IRQ_MAX){
         logging::logf(logging::log_level::ERROR, "Unregister interrupt %u too high\n", irq);
         return false;
     }
@@ -362,5 +456,20 @@ void interrupt::setup_interrupts(){
     remap_irqs();
     install_irqs();
     install_syscalls();
+    install_fast_syscalls(0);
     enable_interrupts();
 }
+
+void interrupt::setup_ap(size_t cpu){
+    asm volatile("lidt [%0]" : : "m" (idtr_64));
+
+    install_fast_syscalls(cpu);
+}
+
+void interrupt::disable_pic(){
+    //Mask all IRQs in both PICs
+    out_byte(0x21, 0xFF);
+    out_byte(0xA1, 0xFF);
+
+    apic_eoi = true;
+}
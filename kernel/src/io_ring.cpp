@@ -0,0 +1,173 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <algorithms.hpp>
+
+#include <tlib/errors.hpp>
+
+#include "io_ring.hpp"
+#include "system_calls.hpp"
+#include "scheduler.hpp"
+#include "paging.hpp"
+#include "logging.hpp"
+
+namespace {
+
+// Only the calls that neither wait for a remote peer without a timeout
+// nor change the execution of the process can be submitted through the
+// ring. The submissions run synchronously, a read waiting for input only
+// delays the following ones, like the equivalent system calls.
+bool allowed(uint64_t code){
+    switch(code){
+        case 0:      // print_char
+        case 1:      // print_string
+        case 2:      // log_string
+            return true;
+
+        case 0x2000: // ioctl
+            return true;
+
+        case 300:    // open
+        case 301:    // stat
+        case 302:    // close
+        case 303:    // read
+        case 304:    // pwd
+        case 305:    // cwd
+        case 306:    // mkdir
+        case 307:    // rm
+        case 308:    // entries
+        case 309:    // mounts
+        case 310:    // statfs
+        case 311:    // write
+        case 312:    // truncate
+        case 313:    // clear
+        case 314:    // mount
+            return true;
+
+        case 0x3000: // socket_open
+        case 0x3001: // socket_close
+        case 0x3007: // client_bind
+        case 0x300A: // client_unbind
+        case 0x300B: // send (the acknowledgement is awaited with a timeout)
+        case 0x300C: // receive (with a timeout, 0 does not wait)
+        case 0x300D: // client_bind_port
+            return true;
+
+        default:
+            // prepare/wait_for_packet (two results) and the calls waiting for a peer
+            return false;
+    }
+}
+
+// The calls that do not set rax
+bool has_result(uint64_t code){
+    switch(code){
+        case 0:      // print_char
+        case 1:      // print_string
+        case 2:      // log_string
+        case 302:    // close
+        case 304:    // pwd
+        case 305:    // cwd
+        case 0x3001: // socket_close
+            return false;
+
+        default:
+            return true;
+    }
+}
+
+// Every page of the ring must be mapped in the user address space
+bool mapped(size_t address){
+    auto& process = scheduler::get_leader();
+
+    auto end = address + sizeof(io::io_ring_layout);
+
+    for(size_t page = paging::page_align(address); page < end; page += paging::PAGE_SIZE){
+        if(!paging::user_physical_address(process, page)){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} //End of anonymous namespace
+
+std::expected<void> io_ring::setup(size_t address){
+    auto& process = scheduler::get_process(scheduler::get_pid());
+
+    if(address && (address < scheduler::program_base || address % sizeof(uint64_t))){
+        return std::make_unexpected<void>(std::ERROR_INVALID_REQUEST);
+    }
+
+    if(address && (address + sizeof(io::io_ring_layout) < address || !mapped(address))){
+        return std::make_unexpected<void>(std::ERROR_INVALID_REQUEST);
+    }
+
+    process.io_ring = address;
+
+    logging::logf(logging::log_level::TRACE, "io_ring: Process %u registered ring %h\n", process.pid, address);
+
+    return {};
+}
+
+std::expected<size_t> io_ring::enter(size_t count){
+    auto address = scheduler::get_process(scheduler::get_pid()).io_ring;
+
+    // The memory of the ring may have been released since its setup
+    if(!address || !mapped(address)){
+        return std::make_unexpected<size_t>(std::ERROR_INVALID_REQUEST);
+    }
+
+    auto* ring = reinterpret_cast<io::io_ring_layout*>(address);
+
+    // The counters are written by the process, read them once and check
+    // them before using them
+    uint64_t sq_head = ring->sq_head;
+    uint64_t sq_tail = ring->sq_tail;
+    uint64_t cq_head = ring->cq_head;
+    uint64_t cq_tail = ring->cq_tail;
+
+    if(sq_tail - sq_head > io::io_ring_entries || cq_tail - cq_head > io::io_ring_entries){
+        return std::make_unexpected<size_t>(std::ERROR_INVALID_REQUEST);
+    }
+
+    count = std::min(count, sq_tail - sq_head);
+
+    size_t executed = 0;
+
+    // Leave the remaining submissions if there is no room to complete them
+    while(executed < count && cq_tail - cq_head < io::io_ring_entries){
+        auto& submission = ring->sq[sq_head % io::io_ring_entries];
+        auto& completion = ring->cq[cq_tail % io::io_ring_entries];
+
+        auto code = submission.code;
+
+        completion.user_data = submission.user_data;
+
+        if(allowed(code)){
+            interrupt::syscall_regs regs{};
+            regs.rax = code;
+            regs.rbx = submission.args[0];
+            regs.rcx = submission.args[1];
+            regs.rdx = submission.args[2];
+            regs.rsi = submission.args[3];
+
+            system_call_entry(&regs);
+
+            completion.result = has_result(code) ? regs.rax : 0;
+        } else {
+            completion.result = -std::ERROR_INVALID_REQUEST;
+        }
+
+        ring->sq_head = ++sq_head;
+        ring->cq_tail = ++cq_tail;
+        ++executed;
+    }
+
+    return executed;
+}
@@ -17,7 +17,7 @@ std::expected<size_t> ioctl(size_t device_fd, io::ioctl_request request, void* d
         return std::make_unexpected<size_t>(std::ERROR_INVALID_FILE_DESCRIPTOR);
     }
 
-    auto& device = scheduler::get_handle(device_fd);
+    auto device = scheduler::get_handle(device_fd);
 
     if(request == io::ioctl_request::GET_BLK_SIZE){
         return devfs::get_device_size(device, *reinterpret_cast<size_t*>(data));
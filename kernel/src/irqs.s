@@ -35,6 +35,16 @@ create_irq 13
 create_irq 14
 create_irq 15
 
+// Local APIC interrupts
+create_irq 16
+create_irq 17
+create_irq 18
+
+// Spurious interrupts of the local APIC must not be acknowledged
+.global _irq_spurious
+_irq_spurious:
+    iretq
+
 // Common handler
 
 irq_common_handler:
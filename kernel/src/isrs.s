@@ -35,7 +35,6 @@ create_irq_dummy 3
 create_irq_dummy 4
 create_irq_dummy 5
 create_irq_dummy 6
-create_irq_dummy 7
 create_irq 8
 create_irq_dummy 9
 create_irq 10
@@ -61,6 +60,39 @@ create_irq_dummy 29
 create_irq_dummy 30
 create_irq_dummy 31
 
+// Device not available, raised by the first FPU/SSE instruction
+// after a task switch, the state of the current process is loaded
+
+.global _isr7
+_isr7:
+    cli
+    clts
+
+    push rax
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push r8
+    push r9
+    push r10
+    push r11
+
+    call _fpu_trap_handler
+    fxrstor [rax]
+
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rax
+
+    iretq
+
 isr_common_handler:
     //TODO Kernel segments should be restored
 
@@ -5,13 +5,15 @@
 //  http://www.opensource.org/licenses/MIT)
 //=======================================================================
 
+#include <lock_guard.hpp>
+
 #include "kalloc.hpp"
 #include "console.hpp"
 #include "physical_allocator.hpp"
 #include "paging.hpp"
 #include "e820.hpp"
 
-#include "conc/int_lock.hpp"
+#include "conc/int_spinlock.hpp"
 
 #include "fs/sysfs.hpp"
 
@@ -25,6 +27,9 @@ const bool TRACE_MALLOC = false;
 size_t _used_memory;
 size_t _allocated_memory;
 
+// The heap is shared between all the processors
+int_spinlock heap_lock;
+
 struct malloc_footer_chunk;
 
 class malloc_header_chunk {
@@ -339,7 +344,7 @@ void kalloc::finalize(){
 }
 
 void* kalloc::k_malloc(uint64_t bytes){
-    direct_int_lock lock;
+    std::lock_guard<int_spinlock> l(heap_lock);
 
     auto current = malloc_head->next();
 
@@ -425,7 +430,7 @@ void* kalloc::k_malloc(uint64_t bytes){
 }
 
 void kalloc::k_free(void* block){
-    direct_int_lock lock;
+    std::lock_guard<int_spinlock> l(heap_lock);
 
     auto free_header = reinterpret_cast<malloc_header_chunk*>(
         reinterpret_cast<uintptr_t>(block) - sizeof(malloc_header_chunk));
@@ -10,6 +10,7 @@
 #include "virtual_allocator.hpp"
 #include "paging.hpp"
 #include "kalloc.hpp"
+#include "slab.hpp"
 #include "timer.hpp"
 #include "drivers/keyboard.hpp"
 #include "drivers/mouse.hpp"
@@ -30,6 +31,13 @@
 #include "vfs/vfs.hpp"
 #include "fs/sysfs.hpp"
 #include "drivers/hpet.hpp"
+#include "smp.hpp"
+#include "tlb.hpp"
+#include "work_queue.hpp"
+#include "conc/lock_stats.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "syscall_stats.hpp"
 
 extern "C" {
 
@@ -50,7 +58,7 @@ void kernel_main(){
 
     arch::enable_sse();
 
-    gdt::flush_tss();
+    gdt::init();
 
     // Necessary for logging with Qemu
     serial::init();
@@ -82,6 +90,9 @@ void kernel_main(){
     //Call global constructors
     _init();
 
+    //Init the object caches, after the constructors of their globals
+    slab::init();
+
     //Try to init VESA
     if(vesa::enabled() && !vesa::init()){
         vesa::disable();
@@ -99,10 +110,16 @@ void kernel_main(){
     physical_allocator::finalize();
     virtual_allocator::finalize();
     kalloc::finalize();
+    slab::finalize();
+
+    //Drivers can post deferred work from now on
+    work_queue::init();
 
     // Asynchronously initialized drivers
     acpi::init();
     hpet::init();
+    smp::init();
+    tlb::init();
 
     //Install drivers
     timer::install();
@@ -124,12 +141,18 @@ void kernel_main(){
     sysfs::set_constant_value(path("/sys"), path("/version"), "0.1");
     sysfs::set_constant_value(path("/sys"), path("/author"), "Baptiste Wicht");
 
+    lock_stats::init();
+    profiler::init();
+    trace::init();
+    syscall_stats::init();
+
     // Initialize the scheduler
     scheduler::init();
 
     // Start the secondary kernel processes
-    network::finalize();
+    work_queue::finalize();
     stdio::finalize();
+    logging::start_writer();
 
     // Start the scheduler
     scheduler::start();
@@ -5,7 +5,9 @@
 //  http://www.opensource.org/licenses/MIT)
 //=======================================================================
 
+#include <array.hpp>
 #include <string.hpp>
+#include <algorithms.hpp>
 
 #include <tlib/flags.hpp>
 
@@ -14,14 +16,56 @@
 #include "console.hpp"
 #include "virtual_debug.hpp"
 #include "early_memory.hpp"
+#include "scheduler.hpp"
+#include "smp.hpp"
+#include "arch.hpp"
 #include "vfs/vfs.hpp"
 
+#include "fs/sysfs.hpp"
+
 namespace {
 
+constexpr const size_t RING_SIZE = 16384;     ///< The size of the ring of each processor, in bytes
+constexpr const size_t MAX_MESSAGE = 1024;    ///< The maximum length of a buffered message
+constexpr const size_t FLUSH_PERIOD = 10;     ///< The period of the writer task, in milliseconds
+
+static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "The ring size must be a power of two");
+
 bool early_mode = true;
 bool file = false;
 
-std::string buffer;
+/*!
+ * \brief The header of a message in a log ring, aligned on its own size
+ */
+struct entry_header {
+    uint64_t tsc;               ///< The TSC when the message was logged, to merge the rings
+    uint32_t length;            ///< The length of the entry, header included
+    uint16_t text_length;       ///< The length of the message
+    uint8_t level;              ///< The log level
+    volatile uint8_t committed; ///< Indicates that the message is completely written
+};
+
+static_assert(sizeof(entry_header) == 16, "The entry lengths are rounded to the header size");
+static_assert(RING_SIZE % sizeof(entry_header) == 0, "A header must never wrap around the ring");
+
+/*!
+ * \brief A multiple-producers single-consumer ring of messages.
+ *
+ * The producers reserve space by advancing the head with a CAS, write
+ * their message and then mark it committed. The writer task consumes
+ * the committed messages in order and advances the tail.
+ */
+struct log_ring_t {
+    volatile uint64_t head; ///< The end of the reserved space
+    volatile uint64_t tail; ///< The start of the messages not yet consumed
+    char data[RING_SIZE];
+};
+
+std::array<log_ring_t*, smp::MAX_CPUS> rings;
+
+volatile bool async = false;
+scheduler::pid_t writer_pid = scheduler::INVALID_PID;
+volatile size_t dropped = 0;
 
 inline const char* level_to_string(logging::log_level level){
     switch(level){
@@ -40,17 +84,15 @@ inline const char* level_to_string(logging::log_level level){
     return "UNKNOWN";
 }
 
+// The messages must be terminated by a new line
 void append_to_file(const char* s, size_t length){
     auto fd = vfs::open("/messages", std::OPEN_CREATE);
 
     if(fd){
         vfs::stat_info info;
         if(vfs::stat(*fd, info)){
-            if(vfs::truncate(*fd, info.size + length + 1)){
-                std::string buffer = s;
-                buffer += '\n';
-
-                vfs::write(*fd, buffer.c_str(), buffer.size(), info.size);
+            if(vfs::truncate(*fd, info.size + length)){
+                vfs::write(*fd, s, length, info.size);
             }
         }
 
@@ -58,6 +100,139 @@ void append_to_file(const char* s, size_t length){
     }
 }
 
+void print(logging::log_level level, const char* s){
+    // Print to the virtual debugger
+    virtual_debug(level_to_string(level));
+    virtual_debug(": ");
+    virtual_debug(s);
+}
+
+bool push(log_ring_t& ring, logging::log_level level, const char* s){
+    auto text_length = std::min(std::str_len(s), MAX_MESSAGE);
+    auto length = (sizeof(entry_header) + text_length + sizeof(entry_header) - 1) & ~(sizeof(entry_header) - 1);
+
+    uint64_t head;
+
+    // Reserve the space in the ring
+    do {
+        head = ring.head;
+
+        if(head + length - ring.tail > RING_SIZE){
+            return false;
+        }
+    } while(!__sync_bool_compare_and_swap(&ring.head, head, head + length));
+
+    // The entries are multiples of the header size, so a header never wraps around
+    auto* header = reinterpret_cast<entry_header*>(&ring.data[head & (RING_SIZE - 1)]);
+    header->tsc = arch::rdtsc();
+    header->length = length;
+    header->text_length = text_length;
+    header->level = static_cast<uint8_t>(level);
+
+    auto text = head + sizeof(entry_header);
+
+    for(size_t i = 0; i < text_length; ++i){
+        ring.data[(text + i) & (RING_SIZE - 1)] = s[i];
+    }
+
+    __atomic_store_n(&header->committed, 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+// Returns the oldest message of the ring, if it is committed
+entry_header* peek(log_ring_t& ring){
+    auto tail = ring.tail;
+
+    if(tail == __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE)){
+        return nullptr;
+    }
+
+    auto* header = reinterpret_cast<entry_header*>(&ring.data[tail & (RING_SIZE - 1)]);
+
+    // The producer has not finished writing its message
+    if(!__atomic_load_n(&header->committed, __ATOMIC_ACQUIRE)){
+        return nullptr;
+    }
+
+    return header;
+}
+
+// Consume the messages of all the rings, in order of their timestamps
+void flush(){
+    std::string batch;
+
+    char text[MAX_MESSAGE + 1];
+
+    while(true){
+        log_ring_t* oldest = nullptr;
+        entry_header* oldest_header = nullptr;
+
+        for(size_t cpu = 0; cpu < smp::cpus(); ++cpu){
+            auto* header = peek(*rings[cpu]);
+
+            if(header && (!oldest_header || header->tsc < oldest_header->tsc)){
+                oldest = rings[cpu];
+                oldest_header = header;
+            }
+        }
+
+        if(!oldest){
+            break;
+        }
+
+        auto start = oldest->tail + sizeof(entry_header);
+
+        for(size_t i = 0; i < oldest_header->text_length; ++i){
+            text[i] = oldest->data[(start + i) & (RING_SIZE - 1)];
+        }
+
+        text[oldest_header->text_length] = '\0';
+
+        auto level = static_cast<logging::log_level>(oldest_header->level);
+        auto length = oldest_header->length;
+
+        // Clear the entry so that no stale byte looks like a committed header
+        for(size_t i = 0; i < length; ++i){
+            oldest->data[(oldest->tail + i) & (RING_SIZE - 1)] = 0;
+        }
+
+        // Release the space to the producers
+        __atomic_store_n(&oldest->tail, oldest->tail + length, __ATOMIC_RELEASE);
+
+        print(level, text);
+
+        if(file){
+            batch += text;
+            batch += '\n';
+        }
+    }
+
+    // A single write for all the messages of the batch
+    if(!batch.empty()){
+        append_to_file(batch.c_str(), batch.size());
+    }
+}
+
+void writer_task(){
+    size_t reported = 0;
+
+    while(true){
+        flush();
+
+        if(dropped != reported){
+            reported = dropped;
+            logging::logf(logging::log_level::WARNING, "logging: %u messages dropped\n", reported);
+        }
+
+        scheduler::sleep_ms(FLUSH_PERIOD);
+    }
+}
+
+std::string sysfs_dropped(){
+    return std::to_string(dropped);
+}
+
 } //end of anonymous namespace
 
 bool logging::is_early(){
@@ -87,21 +262,55 @@ void logging::finalize(){
 }
 
 void logging::to_file(){
-    thor_assert(false, "logging to file needs revision");
+    thor_assert(async, "logging to file is only done by the writer task");
 
     //Starting from there, the messages will be sent to the log file
     file = true;
 }
 
+void logging::start_writer(){
+    for(size_t cpu = 0; cpu < smp::cpus(); ++cpu){
+        rings[cpu] = new log_ring_t;
+        rings[cpu]->head = 0;
+        rings[cpu]->tail = 0;
+        std::fill_n(rings[cpu]->data, RING_SIZE, 0);
+    }
+
+    auto* user_stack = new char[scheduler::user_stack_size];
+    auto* kernel_stack = new char[scheduler::kernel_stack_size];
+
+    auto& process = scheduler::create_kernel_task("klogd", user_stack, kernel_stack, &writer_task);
+
+    process.ppid = 1;
+    process.priority = scheduler::DEFAULT_PRIORITY;
+
+    writer_pid = process.pid;
+
+    sysfs::set_dynamic_value(path("/sys"), path("/logging/dropped"), &sysfs_dropped);
+
+    scheduler::queue_system_process(process.pid);
+
+    //Starting from there, the messages are buffered
+    async = true;
+}
+
 void logging::log(log_level level, const char* s){
+    // The errors are printed directly, since the system may not survive them.
+    // The messages of the writer itself are not buffered to avoid loops.
+    if(async && level != log_level::ERROR && scheduler::get_pid() != writer_pid){
+        if(!push(*rings[smp::current_cpu()], level, s)){
+            __sync_fetch_and_add(&dropped, 1);
+        }
+
+        return;
+    }
+
     if(!is_early()){
-        // Print to the virtual debugger
-        virtual_debug(level_to_string(level));
-        virtual_debug(": ");
-        virtual_debug(s);
+        print(level, s);
     }
 
-    if(is_file()){
+    // Once buffered, only the writer task writes to the file
+    if(is_file() && !async){
         append_to_file(s, std::str_len(s));
     }
 }
@@ -28,7 +28,7 @@ void* mmap_phys(size_t phys, size_t size){
 
     // Map to the physical address
 
-    if(!paging::map_pages(virt, aligned_phys, pages)){
+    if(!paging::map_large_pages(virt, aligned_phys, pages)){
         logging::logf(logging::log_level::ERROR, "mmap: Unable to map %u pages %h->%h\n", size_t(pages), size_t(virt), size_t(aligned_phys));
         return nullptr;
     }
@@ -11,6 +11,7 @@
 #include "net/udp_layer.hpp"
 
 #include "kernel_utils.hpp"
+#include "logging.hpp"
 
 #include "tlib/errors.hpp"
 
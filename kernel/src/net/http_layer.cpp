@@ -9,6 +9,7 @@
 #include "net/tcp_layer.hpp"
 
 #include "kernel_utils.hpp"
+#include "logging.hpp"
 
 namespace {
 
@@ -21,6 +21,10 @@
 #include "scheduler.hpp"
 #include "logging.hpp"
 #include "kernel_utils.hpp"
+#include "work_queue.hpp"
+#include "trace.hpp"
+
+#include "conc/mutex.hpp"
 
 #include "fs/sysfs.hpp"
 
@@ -48,17 +52,25 @@ namespace {
 
 std::vector<network::interface_descriptor> interfaces;
 
-void rx_thread(void* data){
-    auto& interface = *reinterpret_cast<network::interface_descriptor*>(data);
-
-    auto pid = scheduler::get_pid();
+// Only one reception work is posted at a time for an interface, the
+// packets are therefore decoded in order
 
-    logging::logf(logging::log_level::TRACE, "network: RX Thread for interface %u started (pid:%u)\n", interface.id, pid);
+void rx_work(void* data){
+    auto& interface = *reinterpret_cast<network::interface_descriptor*>(data);
 
     while(true){
-        interface.rx_sem.lock();
+        interface.rx_lock.lock();
+
+        if(interface.rx_queue.empty()){
+            interface.rx_scheduled = false;
+            interface.rx_lock.unlock();
+            return;
+        }
 
         auto packet = interface.rx_queue.pop();
+
+        interface.rx_lock.unlock();
+
         network::ethernet::decode(interface, packet);
 
         // The memory of the packet was allocated by the interface itself, can be safely removed
@@ -66,18 +78,38 @@ void rx_thread(void* data){
     }
 }
 
-void tx_thread(void* data){
+void tx_work(void* data){
     auto& interface = *reinterpret_cast<network::interface_descriptor*>(data);
 
-    auto pid = scheduler::get_pid();
+    while(true){
+        interface.tx_lock.lock();
+
+        if(interface.tx_queue.empty()){
+            interface.tx_scheduled = false;
+            interface.tx_lock.unlock();
+            return;
+        }
 
-    logging::logf(logging::log_level::TRACE, "network: TX Thread for interface %u started (pid:%u)\n", interface.id, pid);
+        auto packet = interface.tx_queue.top();
 
-    while(true){
-        interface.tx_sem.lock();
+        interface.tx_resumed = false;
+        interface.tx_lock.unlock();
+
+        // The work must not block the worker, the queue stays stalled until the driver resumes it
+        if(!interface.hw_send(interface, packet)){
+            std::lock_guard<int_spinlock> l(interface.tx_lock);
+
+            if(interface.tx_resumed){
+                continue;
+            }
+
+            interface.tx_scheduled = false;
+            return;
+        }
 
-        auto packet = interface.tx_queue.pop();
-        interface.hw_send(interface, packet);
+        interface.tx_lock.lock();
+        interface.tx_queue.pop();
+        interface.tx_lock.unlock();
 
         thor_assert(!packet.user);
 
@@ -85,6 +117,13 @@ void tx_thread(void* data){
     }
 }
 
+// Must be called with the lock of the queue held
+void schedule_work(volatile bool& scheduled, void (*work)(void*), network::interface_descriptor& interface){
+    if(!scheduled){
+        scheduled = work_queue::post(work, &interface);
+    }
+}
+
 void sysfs_publish(const network::interface_descriptor& interface){
     auto p = path("/net") / interface.name;
 
@@ -156,9 +195,9 @@ void network::init(){
                 interface.ip_address = network::ip::make_address(10, 0, 2, 15);
                 interface.gateway    = network::ip::make_address(10, 0, 2, 2);
 
-                interface.tx_lock.init(1);
-                interface.tx_sem.init(0);
-                interface.rx_sem.init(0);
+                interface.tx_scheduled = false;
+                interface.rx_scheduled = false;
+                interface.tx_resumed = false;
             }
 
             sysfs_publish(interface);
@@ -179,9 +218,9 @@ void network::init(){
     interface.driver_data = nullptr;
     interface.ip_address  = network::ip::make_address(127, 0, 0, 1);
 
-    interface.tx_lock.init(1);
-    interface.tx_sem.init(0);
-    interface.rx_sem.init(0);
+    interface.tx_scheduled = false;
+    interface.rx_scheduled = false;
+    interface.tx_resumed = false;
 
     loopback::init_driver(interface);
 
@@ -203,35 +242,45 @@ void network::init(){
     network::tcp::init_layer();
 }
 
-void network::finalize(){
-    for(auto& interface : interfaces){
-        // if the interface has a driver
-        if(interface.enabled){
-            auto* rx_user_stack = new char[scheduler::user_stack_size];
-            auto* rx_kernel_stack = new char[scheduler::kernel_stack_size];
+void network::interface_descriptor::send(ethernet::packet& p){
+    trace::emit(trace::event::PACKET_TX, id, p.payload_size);
+
+    std::lock_guard<int_spinlock> l(tx_lock);
+
+    if(!tx_queue.push(p)){
+        logging::logf(logging::log_level::ERROR, "network: TX queue full on interface %u, packet dropped\n", id);
 
-            auto* tx_user_stack = new char[scheduler::user_stack_size];
-            auto* tx_kernel_stack = new char[scheduler::kernel_stack_size];
+        delete[] p.payload;
+        return;
+    }
+
+    schedule_work(tx_scheduled, &tx_work, *this);
+}
 
-            auto rx_name = "net_rx_" + interface.name;
-            auto tx_name = "net_tx_" + interface.name;
+void network::interface_descriptor::tx_ready(){
+    std::lock_guard<int_spinlock> l(tx_lock);
 
-            auto& rx_process = scheduler::create_kernel_task_args(rx_name.c_str(), rx_user_stack, rx_kernel_stack, &rx_thread, &interface);
-            auto& tx_process = scheduler::create_kernel_task_args(tx_name.c_str(), tx_user_stack, tx_kernel_stack, &tx_thread, &interface);
+    // A running work may have failed before the resources were freed
+    if(tx_scheduled){
+        tx_resumed = true;
+    } else if(!tx_queue.empty()){
+        tx_scheduled = work_queue::irq_post(&tx_work, this);
+    }
+}
 
-            rx_process.ppid = 1;
-            tx_process.ppid = 1;
+void network::interface_descriptor::receive(ethernet::packet& p){
+    trace::emit(trace::event::PACKET_RX, id, p.payload_size);
 
-            rx_process.priority = scheduler::DEFAULT_PRIORITY;
-            tx_process.priority = scheduler::DEFAULT_PRIORITY;
+    std::lock_guard<int_spinlock> l(rx_lock);
 
-            scheduler::queue_system_process(rx_process.pid);
-            scheduler::queue_system_process(tx_process.pid);
+    if(!rx_queue.push(p)){
+        logging::logf(logging::log_level::ERROR, "network: RX queue full on interface %u, packet dropped\n", id);
 
-            interface.tx_thread_pid = tx_process.pid;
-            interface.rx_thread_pid = rx_process.pid;
-        }
+        delete[] p.payload;
+        return;
     }
+
+    schedule_work(rx_scheduled, &rx_work, *this);
 }
 
 size_t network::number_of_interfaces(){
@@ -656,6 +705,8 @@ void network::propagate_packet(const ethernet::packet& packet, socket_protocol p
     for(size_t pid = 0; pid < scheduler::MAX_PROCESS; ++pid){
         auto state = scheduler::get_process_state(pid);
         if(state != scheduler::process_state::EMPTY && state != scheduler::process_state::NEW && state != scheduler::process_state::KILLED){
+            std::lock_guard<mutex> l(scheduler::resources_lock(pid));
+
             for(auto& socket : scheduler::get_sockets(pid)){
                 if(socket.listen){
                     bool propagate = false;
@@ -18,6 +18,7 @@
 #include "physical_pointer.hpp"
 #include "kernel_utils.hpp"
 #include "logging.hpp"
+#include "tlb.hpp"
 #include "early_memory.hpp"
 
 #include "fs/sysfs.hpp"
@@ -89,6 +90,77 @@ inline void flush_tlb(size_t page){
     asm volatile("invlpg [%0]" :: "r" (page) : "memory");
 }
 
+bool large_entry(pt_t entry){
+    return reinterpret_cast<uintptr_t>(entry) & paging::LARGE;
+}
+
+uintptr_t large_physical(pt_t entry){
+    return reinterpret_cast<uintptr_t>(entry) & ~(paging::LARGE_PAGE_SIZE - 1);
+}
+
+//Map a large page in kernel space, only if no page is mapped in its range
+bool map_large(size_t virt, size_t physical, uint8_t flags){
+    auto pml4e = pml4_entry(virt);
+    auto pdpte = pdpt_entry(virt);
+    auto pde = pd_entry(virt);
+
+    auto pml4t = find_pml4t();
+    thor_assert(reinterpret_cast<uintptr_t>(pml4t[pml4e]) & paging::PRESENT, "A PML4T entry is not PRESENT");
+
+    auto pdpt = find_pdpt(pml4t, pml4e);
+    thor_assert(reinterpret_cast<uintptr_t>(pdpt[pdpte]) & paging::PRESENT, "A PDPT entry is not PRESENT");
+
+    auto pd = find_pd(pdpt, pdpte);
+
+    if(large_entry(pd[pde])){
+        return reinterpret_cast<uintptr_t>(pd[pde]) == (physical | flags | paging::LARGE);
+    }
+
+    //The PT is replaced by the large page, it must be empty
+    auto pt = find_pt(pd, pde);
+    for(size_t i = 0; i < 512; ++i){
+        if(reinterpret_cast<uintptr_t>(pt[i]) & paging::PRESENT){
+            return false;
+        }
+    }
+
+    pd[pde] = reinterpret_cast<pt_t>(physical | flags | paging::LARGE);
+
+    flush_tlb(virt);
+
+    return true;
+}
+
+//Unmap a large page in kernel space and link its PT back
+bool unmap_large(size_t virt){
+    auto pml4e = pml4_entry(virt);
+    auto pdpte = pdpt_entry(virt);
+    auto pde = pd_entry(virt);
+
+    auto pml4t = find_pml4t();
+    if(!(reinterpret_cast<uintptr_t>(pml4t[pml4e]) & paging::PRESENT)){
+        return false;
+    }
+
+    auto pdpt = find_pdpt(pml4t, pml4e);
+    if(!(reinterpret_cast<uintptr_t>(pdpt[pdpte]) & paging::PRESENT)){
+        return false;
+    }
+
+    auto pd = find_pd(pdpt, pdpte);
+    if(!large_entry(pd[pde])){
+        return false;
+    }
+
+    //The kernel PTs are allocated contiguously at init
+    auto pt_index = pde + pdpte * 512 + pml4e * 512 * 512;
+    pd[pde] = reinterpret_cast<pt_t>((physical_pt_start + pt_index * paging::PAGE_SIZE) | paging::PRESENT | paging::WRITE | paging::USER);
+
+    flush_tlb(virt);
+
+    return true;
+}
+
 size_t early_map_page(size_t physical){
     thor_assert(paging::virtual_early_page < 0x100000, "Invalid early page");
 
@@ -267,6 +339,7 @@ void paging::init(){
 
 void paging::finalize(){
     sysfs::set_constant_value(path("/sys"), path("/paging/page_size"), std::to_string(paging::PAGE_SIZE));
+    sysfs::set_constant_value(path("/sys"), path("/paging/large_page_size"), std::to_string(paging::LARGE_PAGE_SIZE));
     sysfs::set_constant_value(path("/sys"), path("/paging/pdpt"), std::to_string(paging::pml4_entries));
     sysfs::set_constant_value(path("/sys"), path("/paging/pd"), std::to_string(paging::pdpt_entries));
     sysfs::set_constant_value(path("/sys"), path("/paging/pt"), std::to_string(paging::pd_entries));
@@ -284,7 +357,7 @@ size_t paging::physical_address(size_t virt){
     }
 
     // Offset inside the page
-    auto offset = virt & uint64_t((1 << 13) - 1);
+    auto offset = virt & uint64_t(PAGE_SIZE - 1);
 
     //Find the correct indexes inside the paging table for the physical address
     auto pml4e = pml4_entry(virt);
@@ -295,6 +368,11 @@ size_t paging::physical_address(size_t virt){
     auto pml4t = find_pml4t();;
     auto pdpt = find_pdpt(pml4t, pml4e);
     auto pd = find_pd(pdpt, pdpte);
+
+    if(large_entry(pd[pde])){
+        return large_physical(pd[pde]) + (virt & (LARGE_PAGE_SIZE - 1));
+    }
+
     auto pt = find_pt(pd, pde);
 
     return offset + (reinterpret_cast<uintptr_t>(pt[pte]) & ~0xFFF);
@@ -322,6 +400,10 @@ bool paging::page_present(size_t virt){
         return false;
     }
 
+    if(large_entry(pd[pde])){
+        return true;
+    }
+
     auto pt = find_pt(pd, pde);
     return reinterpret_cast<uintptr_t>(pt[pte]) & PRESENT;
 }
@@ -359,6 +441,11 @@ bool paging::map(size_t virt, size_t physical, uint8_t flags){
     auto pd = find_pd(pdpt, pdpte);
     thor_assert(reinterpret_cast<uintptr_t>(pd[pde]) & PRESENT, "A PD entry is not PRESENT");
 
+    //The page may already be covered by a large page
+    if(large_entry(pd[pde])){
+        return large_physical(pd[pde]) + (virt & (LARGE_PAGE_SIZE - 1)) == physical;
+    }
+
     auto pt = find_pt(pd, pde);
 
     //Check if the page is already present
@@ -407,39 +494,81 @@ bool paging::map_pages(size_t virt, size_t physical, size_t pages, uint8_t flags
     return true;
 }
 
-bool paging::unmap(size_t virt){
+bool paging::map_large_pages(size_t virt, size_t physical, size_t pages, uint8_t flags){
     //The address must be page-aligned
     if(!page_aligned(virt)){
         return false;
     }
 
+    //To avoid mapping only a subset of the pages
+    //check if one of the page is already mapped to another value
+    for(size_t page = 0; page < pages; ++page){
+        auto virt_addr = virt + page * PAGE_SIZE;
+        auto phys_addr = physical + page * PAGE_SIZE;
+
+        if(!page_free_or_set(virt_addr, phys_addr)){
+            return false;
+        }
+    }
+
+    size_t page = 0;
+    while(page < pages){
+        auto virt_addr = virt + page * PAGE_SIZE;
+        auto phys_addr = physical + page * PAGE_SIZE;
+
+        if(pages - page >= LARGE_PAGE_PAGES && large_page_aligned(virt_addr) && large_page_aligned(phys_addr)){
+            if(map_large(virt_addr, phys_addr, flags)){
+                page += LARGE_PAGE_PAGES;
+                continue;
+            }
+        }
+
+        if(!map(virt_addr, phys_addr, flags)){
+            return false;
+        }
+
+        ++page;
+    }
+
+    return true;
+}
+
+namespace {
+
+//Unmap a page, only invalidating the TLB of the current processor
+bool unmap_page(size_t virt){
     //Find the correct indexes inside the paging table for the virtual address
     auto pml4e = pml4_entry(virt);
     auto pdpte = pdpt_entry(virt);
     auto pde = pd_entry(virt);
     auto pte = pt_entry(virt);
 
-    auto pml4t = find_pml4t();;
+    auto pml4t = find_pml4t();
 
     //If not present, returns directly
-    if(!(reinterpret_cast<uintptr_t>(pml4t[pml4e]) & PRESENT)){
+    if(!(reinterpret_cast<uintptr_t>(pml4t[pml4e]) & paging::PRESENT)){
         return true;
     }
 
     auto pdpt = find_pdpt(pml4t, pml4e);
 
     //If not present, returns directly
-    if(!(reinterpret_cast<uintptr_t>(pdpt[pdpte]) & PRESENT)){
+    if(!(reinterpret_cast<uintptr_t>(pdpt[pdpte]) & paging::PRESENT)){
         return true;
     }
 
     auto pd = find_pd(pdpt, pdpte);
 
     //If not present, returns directly
-    if(!(reinterpret_cast<uintptr_t>(pd[pde]) & PRESENT)){
+    if(!(reinterpret_cast<uintptr_t>(pd[pde]) & paging::PRESENT)){
         return true;
     }
 
+    //Only a part of a large page cannot be unmapped
+    if(large_entry(pd[pde])){
+        return false;
+    }
+
     auto pt = find_pt(pd, pde);
 
     //Unmap the virtual address
@@ -451,21 +580,51 @@ bool paging::unmap(size_t virt){
     return true;
 }
 
+} //end of anonymous namespace
+
+bool paging::unmap(size_t virt){
+    //The address must be page-aligned
+    if(!page_aligned(virt)){
+        return false;
+    }
+
+    if(!unmap_page(virt)){
+        return false;
+    }
+
+    //The other processors may have cached the translation
+    tlb::shootdown(virt, 1);
+
+    return true;
+}
+
 bool paging::unmap_pages(size_t virt, size_t pages){
     //The address must be page-aligned
     if(!page_aligned(virt)){
         return false;
     }
 
-    //Unmap each page
-    for(size_t page = 0; page < pages; ++page){
+    //Unmap each page, releasing whole large pages at once
+    size_t page = 0;
+    while(page < pages){
         auto virt_addr = virt + page * PAGE_SIZE;
 
-        if(!unmap(virt_addr)){
+        if(pages - page >= LARGE_PAGE_PAGES && large_page_aligned(virt_addr) && unmap_large(virt_addr)){
+            page += LARGE_PAGE_PAGES;
+            continue;
+        }
+
+        if(!unmap_page(virt_addr)){
+            tlb::shootdown(virt, page);
             return false;
         }
+
+        ++page;
     }
 
+    //A single shootdown for the whole range
+    tlb::shootdown(virt, pages);
+
     return true;
 }
 
@@ -495,25 +654,26 @@ void clear_physical_page(size_t physical){
     std::fill_n(it, paging::PAGE_SIZE / sizeof(uint64_t), 0);
 }
 
+namespace {
+
+//Returns the physical address of the PD of the given user virtual address, creating the missing structures
 //TODO It is highly inefficient to remap CR3 each time
-bool paging::user_map(scheduler::process_t& process, size_t virt, size_t physical){
+size_t user_physical_pd(scheduler::process_t& process, size_t virt){
     physical_pointer cr3_ptr(process.physical_cr3, 1);
 
     if(!cr3_ptr){
-        return false;
+        return 0;
     }
 
     //Find the correct indexes inside the paging table for the virtual address
     auto pml4e = pml4_entry(virt);
     auto pdpte = pdpt_entry(virt);
-    auto pde = pd_entry(virt);
-    auto pte = pt_entry(virt);
 
     auto pml4t = cr3_ptr.as<pml4t_t>();
-    if(!(reinterpret_cast<uintptr_t>(pml4t[pml4e]) & PRESENT)){
+    if(!(reinterpret_cast<uintptr_t>(pml4t[pml4e]) & paging::PRESENT)){
         auto physical_pdpt = physical_allocator::allocate(1);
 
-        pml4t[pml4e] = reinterpret_cast<pdpt_t>(physical_pdpt | WRITE | USER | PRESENT);
+        pml4t[pml4e] = reinterpret_cast<pdpt_t>(physical_pdpt | paging::WRITE | paging::USER | paging::PRESENT);
 
         clear_physical_page(physical_pdpt);
 
@@ -525,22 +685,36 @@ bool paging::user_map(scheduler::process_t& process, size_t virt, size_t physica
     physical_pointer pdpt_ptr(physical_pdpt, 1);
 
     if(!pdpt_ptr){
-        return false;
+        return 0;
     }
 
     auto pdpt = pdpt_ptr.as<pdpt_t>();
-    if(!(reinterpret_cast<uintptr_t>(pdpt[pdpte]) & PRESENT)){
+    if(!(reinterpret_cast<uintptr_t>(pdpt[pdpte]) & paging::PRESENT)){
         auto physical_pd = physical_allocator::allocate(1);
 
-        pdpt[pdpte] = reinterpret_cast<pd_t>(physical_pd | WRITE | USER | PRESENT);
+        pdpt[pdpte] = reinterpret_cast<pd_t>(physical_pd | paging::WRITE | paging::USER | paging::PRESENT);
 
         clear_physical_page(physical_pd);
 
         process.paging_size += paging::PAGE_SIZE;
-        process.segments.emplace_back(physical_pdpt, 1UL);
+        process.segments.emplace_back(physical_pd, 1UL);
+    }
+
+    return reinterpret_cast<uintptr_t>(pdpt[pdpte]) & ~0xFFF;
+}
+
+} //end of anonymous namespace
+
+bool paging::user_map(scheduler::process_t& process, size_t virt, size_t physical, uint8_t flags){
+    auto pde = pd_entry(virt);
+    auto pte = pt_entry(virt);
+
+    auto physical_pd = user_physical_pd(process, virt);
+
+    if(!physical_pd){
+        return false;
     }
 
-    auto physical_pd = reinterpret_cast<uintptr_t>(pdpt[pdpte]) & ~0xFFF;
     physical_pointer pd_ptr(physical_pd, 1);
 
     if(!pd_ptr){
@@ -548,6 +722,12 @@ bool paging::user_map(scheduler::process_t& process, size_t virt, size_t physica
     }
 
     auto pd = pd_ptr.as<pd_t>();
+
+    //The page cannot be mapped inside a large page
+    if(large_entry(pd[pde])){
+        return false;
+    }
+
     if(!(reinterpret_cast<uintptr_t>(pd[pde]) & PRESENT)){
         auto physical_pt = physical_allocator::allocate(1);
 
@@ -556,7 +736,7 @@ bool paging::user_map(scheduler::process_t& process, size_t virt, size_t physica
         clear_physical_page(physical_pt);
 
         process.paging_size += paging::PAGE_SIZE;
-        process.segments.emplace_back(physical_pdpt, 1UL);
+        process.segments.emplace_back(physical_pt, 1UL);
     }
 
     auto physical_pt = reinterpret_cast<uintptr_t>(pd[pde]) & ~0xFFF;
@@ -569,20 +749,97 @@ bool paging::user_map(scheduler::process_t& process, size_t virt, size_t physica
     auto pt = pt_ptr.as<pt_t>();
 
     //Map to the physical address
-    pt[pte] = reinterpret_cast<page_entry>(physical | WRITE | USER | PRESENT);
+    pt[pte] = reinterpret_cast<page_entry>(physical | flags);
+
+    return true;
+}
+
+bool paging::user_map_large(scheduler::process_t& process, size_t virt, size_t physical, uint8_t flags){
+    auto pde = pd_entry(virt);
+
+    auto physical_pd = user_physical_pd(process, virt);
+
+    if(!physical_pd){
+        return false;
+    }
+
+    physical_pointer pd_ptr(physical_pd, 1);
+
+    if(!pd_ptr){
+        return false;
+    }
+
+    auto pd = pd_ptr.as<pd_t>();
+
+    //Some pages are already mapped in this range
+    if(reinterpret_cast<uintptr_t>(pd[pde]) & PRESENT){
+        return false;
+    }
+
+    pd[pde] = reinterpret_cast<pt_t>(physical | flags | LARGE);
 
     return true;
 }
 
-bool paging::user_map_pages(scheduler::process_t& process, size_t virt, size_t physical, size_t pages){
+size_t paging::user_physical_address(scheduler::process_t& process, size_t virt){
+    //Find the correct indexes inside the paging table for the virtual address
+    auto pml4e = pml4_entry(virt);
+    auto pdpte = pdpt_entry(virt);
+    auto pde = pd_entry(virt);
+    auto pte = pt_entry(virt);
+
+    constexpr const uintptr_t present = PRESENT | USER;
+
+    physical_pointer cr3_ptr(process.physical_cr3, 1);
+    auto pml4t = cr3_ptr.as<pml4t_t>();
+    if((reinterpret_cast<uintptr_t>(pml4t[pml4e]) & present) != present){
+        return 0;
+    }
+
+    physical_pointer pdpt_ptr(reinterpret_cast<uintptr_t>(pml4t[pml4e]) & ~0xFFF, 1);
+    auto pdpt = pdpt_ptr.as<pdpt_t>();
+    if((reinterpret_cast<uintptr_t>(pdpt[pdpte]) & present) != present){
+        return 0;
+    }
+
+    physical_pointer pd_ptr(reinterpret_cast<uintptr_t>(pdpt[pdpte]) & ~0xFFF, 1);
+    auto pd = pd_ptr.as<pd_t>();
+    if((reinterpret_cast<uintptr_t>(pd[pde]) & present) != present){
+        return 0;
+    }
+
+    if(large_entry(pd[pde])){
+        return large_physical(pd[pde]) + (virt & (LARGE_PAGE_SIZE - 1));
+    }
+
+    physical_pointer pt_ptr(reinterpret_cast<uintptr_t>(pd[pde]) & ~0xFFF, 1);
+    auto pt = pt_ptr.as<pt_t>();
+    if((reinterpret_cast<uintptr_t>(pt[pte]) & present) != present){
+        return 0;
+    }
+
+    return (reinterpret_cast<uintptr_t>(pt[pte]) & ~0xFFF) + (virt & (PAGE_SIZE - 1));
+}
+
+bool paging::user_map_pages(scheduler::process_t& process, size_t virt, size_t physical, size_t pages, bool large){
     //Map each page
-    for(size_t page = 0; page < pages; ++page){
+    size_t page = 0;
+    while(page < pages){
         auto virt_addr = virt + page * PAGE_SIZE;
         auto phys_addr = physical + page * PAGE_SIZE;
 
+        if(large && pages - page >= LARGE_PAGE_PAGES && large_page_aligned(virt_addr) && large_page_aligned(phys_addr)){
+            if(user_map_large(process, virt_addr, phys_addr)){
+                page += LARGE_PAGE_PAGES;
+                continue;
+            }
+        }
+
         if(!user_map(process, virt_addr, phys_addr)){
             return false;
         }
+
+        ++page;
     }
 
     return true;
@@ -5,6 +5,8 @@
 //  http://www.opensource.org/licenses/MIT)
 //=======================================================================
 
+#include <lock_guard.hpp>
+
 #include "physical_allocator.hpp"
 #include "e820.hpp"
 #include "paging.hpp"
@@ -13,6 +15,8 @@
 #include "logging.hpp"
 #include "early_memory.hpp"
 
+#include "conc/int_spinlock.hpp"
+
 #include "fs/sysfs.hpp"
 
 //For problems during boot
@@ -31,6 +35,8 @@ size_t allocated_memory = 0;
 typedef buddy_allocator<8, unit> buddy_type;
 buddy_type allocator;
 
+int_spinlock allocator_lock;
+
 size_t first_physical_address;
 size_t last_physical_address;
 
@@ -39,7 +45,8 @@ size_t array_size(size_t managed_space, size_t block){
 }
 
 uint64_t* create_array(size_t managed_space, size_t block){
-    auto size = array_size(managed_space, block) * sizeof(uint64_t);
+    // Leave room for the summaries of the bitmap
+    auto size = static_bitmap::storage_words(array_size(managed_space, block)) * sizeof(uint64_t);
     auto pages = paging::pages(size);
 
     auto physical_address = current_mmap_entry_position;
@@ -140,6 +147,13 @@ void physical_allocator::init(){
     auto data_bitmap_64 = create_array(managed_space, 64);
     auto data_bitmap_128 = create_array(managed_space, 128);
 
+    // Align the managed memory on a large page, so that large blocks can be mapped with large pages
+    if(!paging::large_page_aligned(current_mmap_entry_position)){
+        auto aligned = (current_mmap_entry_position / paging::LARGE_PAGE_SIZE + 1) * paging::LARGE_PAGE_SIZE;
+        allocated_memory += aligned - current_mmap_entry_position;
+        current_mmap_entry_position = aligned;
+    }
+
     first_physical_address = current_mmap_entry_position;
     last_physical_address = current_mmap_entry->base + current_mmap_entry->size;
 
@@ -186,9 +200,17 @@ void physical_allocator::finalize(){
 size_t physical_allocator::allocate(size_t blocks){
     thor_assert(blocks < free() / paging::PAGE_SIZE, "Not enough physical memory");
 
-    allocated_memory += buddy_type::level_size(blocks) * unit;
+    size_t phys;
 
-    auto phys = allocator.allocate(blocks);
+    {
+        std::lock_guard<int_spinlock> l(allocator_lock);
+
+        phys = allocator.allocate(blocks);
+
+        if(phys){
+            allocated_memory += buddy_type::allocated_units(blocks) * unit;
+        }
+    }
 
     if(!phys){
         logging::logf(logging::log_level::ERROR, "palloc: Unable to allocate %u blocks\n", size_t(blocks));
@@ -198,7 +220,9 @@ size_t physical_allocator::allocate(size_t blocks){
 }
 
 void physical_allocator::free(size_t address, size_t blocks){
-    allocated_memory -= buddy_type::level_size(blocks) * unit;
+    std::lock_guard<int_spinlock> l(allocator_lock);
+
+    allocated_memory -= buddy_type::allocated_units(blocks) * unit;
 
     return allocator.free(address, blocks);
 }
@@ -0,0 +1,108 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <array.hpp>
+
+#include <tlib/profiler.hpp>
+
+#include "profiler.hpp"
+#include "cpu_ring_device.hpp"
+#include "scheduler.hpp"
+#include "smp.hpp"
+#include "paging.hpp"
+#include "logging.hpp"
+
+#include "fs/sysfs.hpp"
+
+namespace {
+
+cpu_ring_device<profiler::sample, 512> device;
+
+std::array<size_t, smp::MAX_CPUS> ticks; ///< The ticks since the last sample of each processor
+
+volatile size_t period = 0; ///< The number of ticks between two samples, 0 when disabled
+
+// Follow the frame pointers of the interrupted kernel code
+void unwind(const interrupt::syscall_regs* regs, profiler::sample& sample){
+    auto bottom = regs->rsp;
+    auto top = bottom + scheduler::kernel_stack_size;
+
+    auto frame = regs->rbp;
+
+    for(size_t i = 0; i < profiler::stack_depth; ++i){
+        if(frame < bottom || frame + 16 > top || (frame & 7) || !paging::page_present(frame)){
+            break;
+        }
+
+        auto next = reinterpret_cast<const uint64_t*>(frame)[0];
+        sample.stack[i] = reinterpret_cast<const uint64_t*>(frame)[1];
+
+        // Frames must go up the stack
+        if(next <= frame){
+            break;
+        }
+
+        frame = next;
+    }
+}
+
+void stop(){
+    period = 0;
+}
+
+void start(size_t value){
+    std::fill_n(ticks.begin(), ticks.size(), 0);
+
+    period = value;
+
+    logging::logf(logging::log_level::DEBUG, "profiler: sampling period set to %u ticks\n", value);
+}
+
+std::string sysfs_period(){
+    return std::to_string(period);
+}
+
+std::string sysfs_dropped(){
+    return std::to_string(device.dropped_records());
+}
+
+} //end of anonymous namespace
+
+void profiler::init(){
+    device.init("profiler", &stop, &start);
+
+    sysfs::set_dynamic_value(path("/sys"), path("/profiler/period"), &sysfs_period);
+    sysfs::set_dynamic_value(path("/sys"), path("/profiler/dropped"), &sysfs_dropped);
+}
+
+void profiler::tick(const interrupt::syscall_regs* regs){
+    if(!period){
+        return;
+    }
+
+    auto cpu = smp::current_cpu();
+
+    if(++ticks[cpu] < period){
+        return;
+    }
+
+    ticks[cpu] = 0;
+
+    profiler::sample sample;
+    sample.pid = scheduler::get_pid();
+    sample.cpu = cpu;
+    sample.rip = regs->rip;
+    sample.user = (regs->cs & 3) == 3;
+    std::fill_n(sample.stack, profiler::stack_depth, 0);
+
+    // The user programs are not compiled with frame pointers
+    if(!sample.user){
+        unwind(regs, sample);
+    }
+
+    device.push(cpu, sample);
+}
@@ -15,9 +15,12 @@
 #include <tlib/elf.hpp>
 
 #include "conc/int_lock.hpp"
+#include "conc/int_spinlock.hpp"
+#include "conc/mutex.hpp"
 
 #include "scheduler.hpp"
 #include "paging.hpp"
+#include "arch.hpp"
 #include "assert.hpp"
 #include "gdt.hpp"
 #include "terminal.hpp"
@@ -29,9 +32,18 @@
 #include "kernel_utils.hpp"
 #include "logging.hpp"
 #include "timer.hpp"
+#include "smp.hpp"
+#include "interrupts.hpp"
+#include "futex.hpp"
+#include "trace.hpp"
+#include "syscall_stats.hpp"
+
+#include "drivers/lapic.hpp"
 
 #include "fs/procfs.hpp"
 
+#include <tlib/time_page.hpp>
+
 //Provided by task_switch.s
 extern "C" {
 extern void task_switch(size_t current, size_t next);
@@ -49,38 +61,491 @@ namespace {
 constexpr const size_t STACK_ALIGNMENT = 16;     ///< In bytes
 constexpr const size_t ROUND_ROBIN_QUANTUM = 25; ///< In milliseconds
 
+constexpr const size_t WHEEL_BITS = 6;                        ///< log2 of the number of slots per level
+constexpr const size_t WHEEL_SLOTS = 1 << WHEEL_BITS;         ///< The number of slots per level
+constexpr const size_t WHEEL_LEVELS = 4;                      ///< The number of levels of the timer wheel
+constexpr const uint64_t WHEEL_RANGE = 1UL << (WHEEL_BITS * WHEEL_LEVELS); ///< In ticks
+
 //The Process Control Block
 std::array<scheduler::process_control_t, scheduler::MAX_PROCESS> pcb;
 
-//Define one run queue for each priority level
-std::array<std::vector<scheduler::pid_t>, scheduler::PRIORITY_LEVELS> run_queues;
+// An intrusive list of READY processes, linked through the PCB
+struct ready_list_t {
+    scheduler::pid_t head = scheduler::INVALID_PID;
+    scheduler::pid_t tail = scheduler::INVALID_PID;
+};
 
-int_lock queue_lock;
+size_t highest_level(size_t mask){
+    return 63 - __builtin_clzl(mask);
+}
 
-volatile bool started = false;
+// The scheduling state of each processor
+struct cpu_scheduler_t {
+    //Define one ready list for each priority level
+    std::array<ready_list_t, scheduler::PRIORITY_LEVELS> ready_lists;
+
+    size_t ready_mask = 0; ///< Bit i is set if the ready list of level i is not empty
+
+    int_spinlock queue_lock;
+
+    volatile bool started = false;
+
+    volatile size_t rr_quantum = 0;
+
+    volatile scheduler::pid_t current_pid = 0;
+    scheduler::pid_t idle_pid = 0;
+
+    volatile bool need_resched = false; ///< Set by the reschedule IPI for the idle task
+
+    size_t processes = 0; ///< The number of processes owned by the processor
+    size_t steals = 0;    ///< The number of processes stolen from other processors
 
-volatile size_t rr_quantum = 0;
+    scheduler::pid_t fpu_owner = scheduler::INVALID_PID; ///< The process whose FPU/SSE state is in the registers
+
+    // The following functions must be called with queue_lock held
+
+    void push_back(scheduler::pid_t pid){
+        auto& process = pcb[pid];
+        auto level = process.process.priority - scheduler::MIN_PRIORITY;
+        auto& list = ready_lists[level];
+
+        process.next_ready = scheduler::INVALID_PID;
+        process.prev_ready = list.tail;
+
+        if(list.tail == scheduler::INVALID_PID){
+            list.head = pid;
+        } else {
+            pcb[list.tail].next_ready = pid;
+        }
+
+        list.tail = pid;
+
+        process.queued = true;
+        ready_mask |= size_t(1) << level;
+    }
+
+    void remove(scheduler::pid_t pid){
+        auto& process = pcb[pid];
+        auto level = process.process.priority - scheduler::MIN_PRIORITY;
+        auto& list = ready_lists[level];
+
+        if(process.prev_ready == scheduler::INVALID_PID){
+            list.head = process.next_ready;
+        } else {
+            pcb[process.prev_ready].next_ready = process.next_ready;
+        }
+
+        if(process.next_ready == scheduler::INVALID_PID){
+            list.tail = process.prev_ready;
+        } else {
+            pcb[process.next_ready].prev_ready = process.prev_ready;
+        }
+
+        process.queued = false;
+
+        if(list.head == scheduler::INVALID_PID){
+            ready_mask &= ~(size_t(1) << level);
+        }
+    }
+
+    // Change the priority of a process, moving it to the correct ready list
+    void set_priority(scheduler::pid_t pid, size_t priority){
+        auto& process = pcb[pid];
+
+        if(process.queued){
+            remove(pid);
+            process.process.priority = priority;
+            push_back(pid);
+        } else {
+            process.process.priority = priority;
+        }
+    }
+
+    // Dequeue the first READY process of the highest priority
+    scheduler::pid_t pop(){
+        while(ready_mask){
+            auto pid = ready_lists[highest_level(ready_mask)].head;
+
+            remove(pid);
+
+            // Processes blocked while queued are simply dropped
+            if(pcb[pid].state == scheduler::process_state::READY){
+                return pid;
+            }
+        }
+
+        return scheduler::INVALID_PID;
+    }
+};
+
+std::array<cpu_scheduler_t, smp::MAX_CPUS> cpus;
+
+volatile bool started = false;
 
-volatile size_t current_pid;
 size_t next_pid = 0;
+int_spinlock pid_lock;
+
+// Protect the segments and the page tables of a leader, shared by its threads
+std::array<mutex, scheduler::MAX_PROCESS> address_space_locks;
+
+// Protect the handles, the sockets and the working directory of a leader
+std::array<mutex, scheduler::MAX_PROCESS> resources_locks;
 
 size_t gc_pid = 0;
-size_t idle_pid = 0;
 
-std::vector<scheduler::pid_t>& run_queue(size_t priority){
-    return run_queues[priority - scheduler::MIN_PRIORITY];
+cpu_scheduler_t& this_cpu(){
+    return cpus[smp::current_cpu()];
+}
+
+// Must be read without preemption since the process may migrate
+size_t current_pid(){
+    direct_int_lock l;
+    return this_cpu().current_pid;
+}
+
+// The process owning the address space, the handles and the sockets
+size_t leader_pid(){
+    return pcb[current_pid()].process.leader;
+}
+
+bool is_idle(scheduler::pid_t pid){
+    return pid == cpus[pcb[pid].cpu].idle_pid;
+}
+
+void reschedule_ipi(size_t cpu){
+    lapic::send_ipi(smp::cpu(cpu).apic_id, interrupt::IRQ_VECTOR_BASE + interrupt::IRQ_RESCHEDULE);
+}
+
+void preempt(bool force);
+
+void reschedule_handler(interrupt::syscall_regs*, void*){
+    auto& cpu = this_cpu();
+
+    // The idle task restarts the tick before it looks for work
+    if(cpu.current_pid == cpu.idle_pid){
+        cpu.need_resched = true;
+    }
+}
+
+// Make sure that a process that became READY will run soon
+void wake_up(scheduler::pid_t pid){
+    if(smp::online_cpus() < 2){
+        return;
+    }
+
+    auto cpu = pcb[pid].cpu;
+    auto self = smp::current_cpu();
+
+    // The owner of the process is idle, it can run it directly
+    if(cpus[cpu].current_pid == cpus[cpu].idle_pid){
+        if(cpu != self){
+            reschedule_ipi(cpu);
+        }
+
+        return;
+    }
+
+    // Otherwise, an idle processor can steal it
+    for(size_t i = 0; i < smp::cpus(); ++i){
+        if(i != cpu && i != self && cpus[i].started && cpus[i].current_pid == cpus[i].idle_pid){
+            reschedule_ipi(i);
+            return;
+        }
+    }
+}
+
+// Mark a process READY and put it in the ready list of its processor
+void make_ready(scheduler::pid_t pid){
+    auto& process = pcb[pid];
+
+    while(true){
+        auto cpu_id = process.cpu;
+        auto& cpu = cpus[cpu_id];
+
+        {
+            std::lock_guard<int_spinlock> l(cpu.queue_lock);
+
+            // The process has been stolen in between
+            if(process.cpu != cpu_id){
+                continue;
+            }
+
+            process.state = scheduler::process_state::READY;
+            process.ready_tsc = arch::rdtsc();
+
+            trace::emit(trace::event::SCHED_WAKEUP, pid, cpu_id);
+
+            // The current process is queued back when it is switched out
+            if(!process.queued && pid != cpu.current_pid && pid != cpu.idle_pid){
+                cpu.push_back(pid);
+            }
+        }
+
+        wake_up(pid);
+
+        return;
+    }
+}
+
+// Hierarchical timer wheel of the sleeping processes. Level l has slots
+// of 64^l ticks, processes are cascaded to a lower level when the
+// current tick reaches their slot.
+std::array<scheduler::pid_t, WHEEL_SLOTS * WHEEL_LEVELS> timer_wheel;
+
+volatile uint64_t wheel_ticks = 0;
+uint64_t wheel_pending = 0; ///< The elapsed ticks not yet applied to the wheel by wheel_advance()
+
+int_spinlock timer_lock;
+
+// The following functions must be called with timer_lock held
+
+void wheel_insert(scheduler::pid_t pid){
+    auto& process = pcb[pid];
+
+    // Expired deadlines go in the slot of the current tick
+    auto deadline = std::max(process.wake_tick, uint64_t(wheel_ticks));
+    auto delta = deadline - wheel_ticks;
+
+    // Deadlines out of range will be cascaded again
+    if(delta >= WHEEL_RANGE){
+        deadline = wheel_ticks + WHEEL_RANGE - 1;
+        delta = WHEEL_RANGE - 1;
+    }
+
+    size_t level = 0;
+    while(level < WHEEL_LEVELS - 1 && delta >= (uint64_t(1) << (WHEEL_BITS * (level + 1)))){
+        ++level;
+    }
+
+    auto slot = level * WHEEL_SLOTS + ((deadline >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+    auto& head = timer_wheel[slot];
+
+    process.timer_slot = slot;
+    process.prev_timer = scheduler::INVALID_PID;
+    process.next_timer = head;
+
+    if(head != scheduler::INVALID_PID){
+        pcb[head].prev_timer = pid;
+    }
+
+    head = pid;
+
+    process.timer_queued = true;
+}
+
+void wheel_remove(scheduler::pid_t pid){
+    auto& process = pcb[pid];
+
+    if(process.prev_timer == scheduler::INVALID_PID){
+        timer_wheel[process.timer_slot] = process.next_timer;
+    } else {
+        pcb[process.prev_timer].next_timer = process.next_timer;
+    }
+
+    if(process.next_timer != scheduler::INVALID_PID){
+        pcb[process.next_timer].prev_timer = process.prev_timer;
+    }
+
+    process.timer_queued = false;
+}
+
+// Detach all the processes of a slot
+scheduler::pid_t wheel_take(size_t level, size_t slot){
+    auto pid = timer_wheel[level * WHEEL_SLOTS + slot];
+
+    timer_wheel[level * WHEEL_SLOTS + slot] = scheduler::INVALID_PID;
+
+    for(auto it = pid; it != scheduler::INVALID_PID; it = pcb[it].next_timer){
+        pcb[it].timer_queued = false;
+    }
+
+    return pid;
+}
+
+// The number of ticks until the next expiration or cascade, at most limit
+uint64_t wheel_next_event(uint64_t limit){
+    auto now = wheel_ticks;
+    auto next = limit;
+
+    for(size_t level = 0; level < WHEEL_LEVELS; ++level){
+        auto shift = WHEEL_BITS * level;
+        auto index = now >> shift;
+
+        for(size_t k = 1; k <= WHEEL_SLOTS; ++k){
+            if(timer_wheel[level * WHEEL_SLOTS + ((index + k) & (WHEEL_SLOTS - 1))] != scheduler::INVALID_PID){
+                next = std::min(next, ((index + k) << shift) - now);
+                break;
+            }
+        }
+    }
+
+    return next;
 }
 
+void wheel_tick();
+
+// Advance the wheel after the tick has been stopped
+void wheel_advance(uint64_t ticks){
+    uint64_t skip;
+
+    {
+        std::lock_guard<int_spinlock> l(timer_lock);
+
+        // Nothing happens before the next event
+        skip = std::min(ticks, wheel_next_event(ticks + 1) - 1);
+        wheel_ticks += skip;
+        wheel_pending -= skip;
+    }
+
+    for(auto i = skip; i < ticks; ++i){
+        wheel_tick();
+    }
+}
+
+volatile bool bsp_tickless = false;
+
+void arm_timer(scheduler::pid_t pid, size_t ms){
+    // Compute the amount of ticks to sleep
+    auto sleep_ticks = ms * (timer::timer_frequency() / 1000);
+    sleep_ticks = !sleep_ticks ? 1 : sleep_ticks;
+
+    std::lock_guard<int_spinlock> l(timer_lock);
+
+    if(pcb[pid].timer_queued){
+        wheel_remove(pid);
+    }
+
+    // The wheel lags behind while the bootstrap processor is tickless
+    auto now = wheel_ticks + wheel_pending + (bsp_tickless ? timer::tickless_ticks() : 0);
+
+    pcb[pid].wake_tick = now + sleep_ticks;
+
+    wheel_insert(pid);
+
+    // The bootstrap processor may sleep past the new deadline
+    if(bsp_tickless && smp::current_cpu() != 0){
+        reschedule_ipi(0);
+    }
+}
+
+void cancel_timer(scheduler::pid_t pid){
+    std::lock_guard<int_spinlock> l(timer_lock);
+
+    if(pcb[pid].timer_queued){
+        wheel_remove(pid);
+    }
+}
+
+// Advance the wheel by one tick and wake up the expired processes
+void wheel_tick(){
+    std::lock_guard<int_spinlock> l(timer_lock);
+
+    auto now = ++wheel_ticks;
+
+    if(wheel_pending){
+        --wheel_pending;
+    }
+
+    // Find the highest level whose slot changed
+    size_t level = 0;
+    while(level < WHEEL_LEVELS - 1 && !(now & ((uint64_t(1) << (WHEEL_BITS * (level + 1))) - 1))){
+        ++level;
+    }
+
+    // Cascade from the top so that a process can move down several levels
+    for(; level > 0; --level){
+        auto pid = wheel_take(level, (now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+
+        while(pid != scheduler::INVALID_PID){
+            auto next = pcb[pid].next_timer;
+            wheel_insert(pid);
+            pid = next;
+        }
+    }
+
+    auto pid = wheel_take(0, now & (WHEEL_SLOTS - 1));
+
+    while(pid != scheduler::INVALID_PID){
+        auto next = pcb[pid].next_timer;
+        auto& process = pcb[pid];
+
+        if(process.state == scheduler::process_state::SLEEPING || process.state == scheduler::process_state::BLOCKED_TIMEOUT){
+            verbose_logf(logging::log_level::TRACE, "scheduler: Process %u finished sleeping, is ready\n", pid);
+
+            make_ready(pid);
+        }
+
+        pid = next;
+    }
+}
+
+// The tick is stopped while the processor is idle. The bootstrap
+// processor keeps a one-shot timer for the next deadline of the timer
+// wheel, the application processors are only woken up by interrupts.
 void idle_task(){
     while(true){
-        asm volatile("hlt");
+        size_t rflags;
+        arch::disable_hwint(rflags);
+
+        auto self = smp::current_cpu();
+        auto& cpu = cpus[self];
+
+        // Some work arrived during the last interrupt
+        if(cpu.ready_mask || cpu.need_resched){
+            cpu.need_resched = false;
+
+            preempt(true);
+
+            arch::enable_hwint(rflags);
+            continue;
+        }
+
+        bool stopped = false;
+
+        if(self == 0){
+            std::lock_guard<int_spinlock> l(timer_lock);
+
+            stopped = timer::stop_tick(wheel_next_event(timer::timer_frequency()));
+            bsp_tickless = stopped;
+        } else if(lapic::enabled()){
+            lapic::stop_timer();
+        }
+
+        // sti only takes effect after hlt, no wake up can be missed
+        asm volatile("sti; hlt; cli" : : : "memory");
+
+        if(self == 0){
+            if(stopped){
+                uint64_t ticks;
+
+                {
+                    std::lock_guard<int_spinlock> l(timer_lock);
+
+                    ticks = timer::restart_tick();
+                    wheel_pending = ticks;
+                    bsp_tickless = false;
+                }
+
+                wheel_advance(ticks);
+            }
+        } else if(lapic::enabled()){
+            lapic::start_timer(smp::LAPIC_TIMER_FREQUENCY, interrupt::IRQ_VECTOR_BASE + interrupt::IRQ_LAPIC_TIMER);
+        }
+
+        arch::enable_hwint(rflags);
     }
 }
 
 void gc_task(){
+    bool again = false;
+
     while(true){
         //Wait until there is something to do
-        scheduler::block_process(scheduler::get_pid());
+        if(!again){
+            scheduler::block_process(scheduler::get_pid());
+        }
+
+        again = false;
 
         //2. Clean up each killed process
 
@@ -89,6 +554,19 @@ void gc_task(){
                 auto& desc = process.process;
                 auto prev_pid = desc.pid;
 
+                // The address space is released with the last thread
+                if(desc.threads){
+                    continue;
+                }
+
+                bool thread = desc.leader != desc.pid;
+                bool system = desc.system;
+
+                // The process may still be switching out on another processor
+                while(process.on_cpu){
+                    arch::pause();
+                }
+
                 logging::logf(logging::log_level::DEBUG, "scheduler: Clean process %u\n", prev_pid);
 
                 // 0. Notify parent if still waiting
@@ -99,12 +577,24 @@ void gc_task(){
                     }
                 }
 
-                // 1. Release physical memory of PML4T (if not system task)
+                // 1. Release physical memory of PML4T (if not system task nor thread)
 
-                if(!desc.system){
+                if(!desc.system && !thread){
                     physical_allocator::free(desc.physical_cr3, 1);
                 }
 
+                // The user stack of a thread remains mapped in its leader
+
+                if(thread){
+                    auto& leader = pcb[desc.leader].process;
+
+                    __sync_fetch_and_and(&leader.thread_slots_used, ~(uint64_t(1) << desc.thread_slot));
+
+                    if(__sync_sub_and_fetch(&leader.threads, 1) == 0 && pcb[desc.leader].state == scheduler::process_state::KILLED){
+                        again = true;
+                    }
+                }
+
                 // 2. Release physical stacks (if dynamically allocated)
 
                 if(desc.physical_kernel_stack){
@@ -141,23 +631,24 @@ void gc_task(){
                     paging::unmap_pages(desc.virtual_kernel_stack, scheduler::kernel_stack_size / paging::PAGE_SIZE);
                 }
 
+                syscall_stats::release(desc.pid);
+
                 // 5. Remove process from run queue
 
                 {
-                    std::lock_guard<int_lock> l(queue_lock);
+                    auto& cpu = cpus[process.cpu];
 
-                    for(size_t index = 0; index < run_queue(desc.priority).size(); ++index){
-                        if(run_queue(desc.priority)[index] == desc.pid){
-                            run_queue(desc.priority).erase(index);
-                            break;
-                        }
+                    std::lock_guard<int_spinlock> l(cpu.queue_lock);
+
+                    if(process.queued){
+                        cpu.remove(desc.pid);
                     }
+
+                    --cpu.processes;
                 }
 
                 // 6. Clean process
 
-                desc.pid = 0;
-                desc.ppid = 0;
                 desc.system = false;
                 desc.physical_cr3 = 0;
                 desc.physical_user_stack = 0;
@@ -166,13 +657,35 @@ void gc_task(){
                 desc.paging_size = 0;
                 desc.context = nullptr;
                 desc.brk_start = desc.brk_end = 0;
+                desc.io_ring = 0;
+                desc.leader = 0;
 
                 // 7. Clean file handles
                 //TODO If not empty, probably something should be done
                 process.handles.clear();
 
-                // 8. Release the PCB slot
-                process.state = scheduler::process_state::EMPTY;
+                // 8. Release the PCB slot, the pid is not reused until the
+                // parent awaits the process, unless nobody can await it
+
+                {
+                    std::lock_guard<int_spinlock> l(pid_lock);
+
+                    for(auto& child : pcb){
+                        if(child.unreaped && child.process.ppid == prev_pid){
+                            child.process.ppid = scheduler::INVALID_PID;
+
+                            if(child.state == scheduler::process_state::EMPTY){
+                                child.unreaped = false;
+                            }
+                        }
+                    }
+
+                    if(system || desc.ppid == scheduler::INVALID_PID){
+                        process.unreaped = false;
+                    }
+
+                    process.state = scheduler::process_state::EMPTY;
+                }
 
                 logging::logf(logging::log_level::DEBUG, "scheduler: Process %u cleaned\n", prev_pid);
             }
@@ -214,26 +727,113 @@ void init_task(){
     }
 }
 
-scheduler::process_t& new_process(){
-    //TODO use get_free_pid() that searchs through the PCB
-    auto pid = next_pid++;
+// Returns nullptr if all the PCB slots are used
+scheduler::process_t* new_process(){
+    scheduler::pid_t pid = scheduler::INVALID_PID;
+
+    {
+        std::lock_guard<int_spinlock> l(pid_lock);
+
+        // The slots released by the gc task are reused, after the last pid,
+        // once their process has been reaped
+        for(size_t i = 0; i < scheduler::MAX_PROCESS; ++i){
+            auto candidate = (next_pid + i) % scheduler::MAX_PROCESS;
+
+            if(pcb[candidate].state == scheduler::process_state::EMPTY && !pcb[candidate].unreaped){
+                pid = candidate;
+                break;
+            }
+        }
+
+        if(pid == scheduler::INVALID_PID){
+            return nullptr;
+        }
+
+        pcb[pid].state = scheduler::process_state::NEW;
+        pcb[pid].unreaped = true;
+        pcb[pid].process.pid = pid;
+        pcb[pid].process.ppid = current_pid();
+        next_pid = pid + 1;
+    }
 
     auto& process = pcb[pid];
 
     process.process.system = false;
-    process.process.pid = pid;
-    process.process.ppid = current_pid;
     process.process.priority = scheduler::DEFAULT_PRIORITY;
-    process.state = scheduler::process_state::NEW;
+    process.cpu = 0;
+    process.on_cpu = false;
+    process.queued = false;
+    process.timer_queued = false;
+    process.base_priority = 0;
+    process.boosts = 0;
+
+    process.last_tsc = arch::rdtsc();
+    process.ready_tsc = 0;
+    process.user_time = 0;
+    process.kernel_time = 0;
+    process.wait_time = 0;
+    process.voluntary_switches = 0;
+    process.involuntary_switches = 0;
+    process.system_calls = 0;
+
+    // Clean FPU/SSE state, loaded on first use
+    process.fpu_cpu = smp::MAX_CPUS;
+    process.fpu_traps = 0;
+    std::fill_n(process.fpu_state, scheduler::FPU_STATE_SIZE, 0);
+    *reinterpret_cast<uint16_t*>(&process.fpu_state[0]) = 0x37F;   // FCW: all exceptions masked
+    *reinterpret_cast<uint32_t*>(&process.fpu_state[24]) = 0x1F80; // MXCSR: all exceptions masked
     process.process.tty = stdio::get_active_terminal().id;
 
     process.process.brk_start = 0;
     process.process.brk_end = 0;
+    process.process.io_ring = 0;
+
+    process.process.leader = pid;
+    process.process.thread_slot = 0;
+    process.process.thread_slots_used = 0;
+    process.process.thread_slots_mapped = 0;
+    process.process.threads = 0;
+    process.exit_requested = false;
 
     // By default, a process is working in root
     process.working_directory = path("/");
 
-    return process.process;
+    return &process.process;
+}
+
+// Release the slot of a process that never ran
+void release_pid(scheduler::pid_t pid){
+    std::lock_guard<int_spinlock> l(pid_lock);
+
+    pcb[pid].unreaped = false;
+    pcb[pid].state = scheduler::process_state::EMPTY;
+}
+
+void enqueue(scheduler::pid_t pid, size_t cpu_id){
+    auto& process = pcb[pid];
+    auto& cpu = cpus[cpu_id];
+
+    std::lock_guard<int_spinlock> l(cpu.queue_lock);
+
+    process.cpu = cpu_id;
+    process.state = scheduler::process_state::READY;
+    process.ready_tsc = arch::rdtsc();
+
+    cpu.push_back(pid);
+    ++cpu.processes;
+}
+
+// Select the least loaded processor for a new process
+size_t select_cpu(){
+    size_t best = 0;
+
+    for(size_t i = 1; i < smp::cpus(); ++i){
+        if(cpus[i].started && cpus[i].processes < cpus[best].processes){
+            best = i;
+        }
+    }
+
+    return best;
 }
 
 void queue_process(scheduler::pid_t pid){
@@ -244,21 +844,22 @@ void queue_process(scheduler::pid_t pid){
     thor_assert(process.process.priority <= scheduler::MAX_PRIORITY, "Invalid priority");
     thor_assert(process.process.priority >= scheduler::MIN_PRIORITY, "Invalid priority");
 
-    process.state = scheduler::process_state::READY;
+    enqueue(pid, select_cpu());
 
-    std::lock_guard<int_lock> l(queue_lock);
-    run_queue(process.process.priority).push_back(pid);
+    wake_up(pid);
 }
 
-void create_idle_task(){
+void create_idle_task(size_t cpu){
     auto& idle_process = scheduler::create_kernel_task("idle", new char[scheduler::user_stack_size], new char[scheduler::kernel_stack_size], &idle_task);
 
     idle_process.ppid = 0;
     idle_process.priority = scheduler::MIN_PRIORITY;
 
-    scheduler::queue_system_process(idle_process.pid);
+    // The idle task is never in a ready list
+    pcb[idle_process.pid].cpu = cpu;
+    pcb[idle_process.pid].state = scheduler::process_state::READY;
 
-    idle_pid = idle_process.pid;
+    cpus[cpu].idle_pid = idle_process.pid;
 }
 
 void create_init_task(){
@@ -290,78 +891,154 @@ void create_post_init_task(){
     scheduler::queue_system_process(post_init_process.pid);
 }
 
-void switch_to_process(size_t pid){
-    if(pcb[current_pid].process.system){
-        logging::logf(logging::log_level::DEBUG, "scheduler: Switch from %u (s:%u) to %u (rip:%u)\n", current_pid, static_cast<size_t>(pcb[current_pid].state), pid, pcb[current_pid].process.context->rip);
+// Account the end of the time slice of the old process and the wait of the new one
+void account_switch(size_t old_pid, size_t pid){
+    auto now = arch::rdtsc();
+
+    // Processes are always switched from the kernel
+    auto& old_process = pcb[old_pid];
+    old_process.kernel_time += now - old_process.last_tsc;
+
+    if(old_process.state == scheduler::process_state::READY){
+        ++old_process.involuntary_switches;
+        old_process.ready_tsc = now;
     } else {
-        logging::logf(logging::log_level::DEBUG, "scheduler: Switch from %u (s:%u) to %u\n", current_pid, static_cast<size_t>(pcb[current_pid].state), pid);
+        ++old_process.voluntary_switches;
+    }
+
+    auto& process = pcb[pid];
+
+    if(process.ready_tsc){
+        process.wait_time += now - process.ready_tsc;
+        process.ready_tsc = 0;
     }
 
+    process.last_tsc = now;
+}
+
+void switch_to_process(size_t old_pid, size_t pid){
     // This should never be interrupted
     direct_int_lock l;
 
-    auto old_pid = current_pid;
-    current_pid = pid;
+    account_switch(old_pid, pid);
+
+    trace::emit(trace::event::SCHED_SWITCH, old_pid, pid, static_cast<uint16_t>(pcb[old_pid].state));
+
+    if(pcb[old_pid].process.system){
+        logging::logf(logging::log_level::DEBUG, "scheduler: Switch from %u (s:%u) to %u (rip:%u)\n", old_pid, static_cast<size_t>(pcb[old_pid].state), pid, pcb[old_pid].process.context->rip);
+    } else {
+        logging::logf(logging::log_level::DEBUG, "scheduler: Switch from %u (s:%u) to %u\n", old_pid, static_cast<size_t>(pcb[old_pid].state), pid);
+    }
 
     auto& process = pcb[pid];
     process.state = scheduler::process_state::RUNNING;
+    process.on_cpu = true;
 
-    gdt::tss().rsp0_low = process.process.kernel_rsp & 0xFFFFFFFF;
-    gdt::tss().rsp0_high = process.process.kernel_rsp >> 32;
+    auto& tss = gdt::tss();
+    tss.rsp0_low = process.process.kernel_rsp & 0xFFFFFFFF;
+    tss.rsp0_high = process.process.kernel_rsp >> 32;
 
-    task_switch(old_pid, current_pid);
-}
+    // The FPU/SSE state is restored lazily, on the first #NM after the
+    // switch. It is saved eagerly, only if it was used, so that the
+    // process can run on another processor.
 
-size_t select_next_process(){
-    auto current_priority = pcb[current_pid].process.priority;
+    auto& cpu = this_cpu();
 
-    std::lock_guard<int_lock> l(queue_lock);
+    if(!arch::task_switched() && cpu.fpu_owner == old_pid){
+        arch::fxsave(pcb[old_pid].fpu_state);
+    }
 
-    //1. Run a process of higher priority, if any
-    for(size_t p = scheduler::MAX_PRIORITY; p > current_priority; --p){
-        for(auto pid : run_queue(p)){
-            if(pcb[pid].state == scheduler::process_state::READY || pcb[pid].state == scheduler::process_state::RUNNING){
-                return pid;
-            }
-        }
+    if(cpu.fpu_owner == pid && process.fpu_cpu == smp::current_cpu()){
+        arch::clear_task_switched();
+    } else {
+        arch::set_task_switched();
     }
 
-    //2. Run the next process of the same priority
+    task_switch(old_pid, pid);
+}
 
-    {
-        auto& current_run_queue = run_queue(current_priority);
+// Try to take a READY process from the ready lists of another processor
+size_t steal_process(size_t self){
+    auto& cpu = cpus[self];
 
-        size_t next_index = 0;
-        for(size_t i = 0; i < current_run_queue.size(); ++i){
-            if(current_run_queue[i] == current_pid){
-                next_index = (i + 1) % current_run_queue.size();
-                break;
-            }
+    for(size_t i = 1; i < smp::cpus(); ++i){
+        auto victim_id = (self + i) % smp::cpus();
+        auto& victim = cpus[victim_id];
+
+        if(!victim.started || !victim.ready_mask){
+            continue;
         }
 
-        for(size_t i = 0; i < current_run_queue.size(); ++i){
-            auto index = (next_index + i) % current_run_queue.size();
-            auto pid = current_run_queue[index];
+        // Never wait for another queue, this could deadlock
+        if(!victim.queue_lock.try_lock()){
+            continue;
+        }
 
-            if(pcb[pid].state == scheduler::process_state::READY || pcb[pid].state == scheduler::process_state::RUNNING){
-                return pid;
+        auto mask = victim.ready_mask;
+
+        while(mask){
+            auto level = highest_level(mask);
+            mask &= ~(size_t(1) << level);
+
+            // Take the most recently queued process, the least likely to be cache hot
+            for(auto pid = victim.ready_lists[level].tail; pid != scheduler::INVALID_PID; pid = pcb[pid].prev_ready){
+                auto& process = pcb[pid];
+
+                if(process.state == scheduler::process_state::READY && !process.on_cpu){
+                    victim.remove(pid);
+                    --victim.processes;
+
+                    process.cpu = self;
+                    ++cpu.processes;
+                    ++cpu.steals;
+
+                    victim.queue_lock.unlock();
+
+                    verbose_logf(logging::log_level::TRACE, "scheduler: CPU %u stole %u from CPU %u\n", self, pid, victim_id);
+
+                    return pid;
+                }
             }
         }
+
+        victim.queue_lock.unlock();
     }
 
-    thor_assert(current_priority > 0, "The idle task should always be ready");
+    return scheduler::INVALID_PID;
+}
 
-    //3. Run a process of lower priority
+// Select the next process of the current processor and make it current
+size_t select_next_process(){
+    auto self = smp::current_cpu();
+    auto& cpu = cpus[self];
 
-    for(size_t p = current_priority - 1; p >= scheduler::MIN_PRIORITY; --p){
-        for(auto pid : run_queue(p)){
-            if(pcb[pid].state == scheduler::process_state::READY || pcb[pid].state == scheduler::process_state::RUNNING){
-                return pid;
-            }
-        }
+    std::lock_guard<int_spinlock> l(cpu.queue_lock);
+
+    auto current_pid = cpu.current_pid;
+
+    //1. A preempted process goes at the end of its ready list
+
+    if(current_pid != cpu.idle_pid && pcb[current_pid].state == scheduler::process_state::READY && !pcb[current_pid].queued){
+        cpu.push_back(current_pid);
+    }
+
+    //2. Run the first process of the highest priority
+
+    auto pid = cpu.pop();
+
+    //3. Nothing to do locally, try to help the other processors
+
+    if(pid == scheduler::INVALID_PID){
+        pid = steal_process(self);
     }
 
-    thor_unreachable("No process is READY");
+    if(pid == scheduler::INVALID_PID){
+        pid = cpu.idle_pid;
+    }
+
+    cpu.current_pid = pid;
+
+    return pid;
 }
 
 bool allocate_user_memory(scheduler::process_t& process, size_t address, size_t size, size_t& ref){
@@ -406,6 +1083,23 @@ void clear_physical_memory(size_t memory, size_t pages){
     std::fill_n(it, (pages * paging::PAGE_SIZE) / sizeof(uint64_t), 0);
 }
 
+bool allocate_kernel_stack(scheduler::process_t& process){
+    auto virtual_kernel_stack = virtual_allocator::allocate(scheduler::kernel_stack_size / paging::PAGE_SIZE);
+    auto physical_kernel_stack = physical_allocator::allocate(scheduler::kernel_stack_size / paging::PAGE_SIZE);
+
+    if(!paging::map_pages(virtual_kernel_stack, physical_kernel_stack, scheduler::kernel_stack_size / paging::PAGE_SIZE)){
+        return false;
+    }
+
+    process.physical_kernel_stack = physical_kernel_stack;
+    process.virtual_kernel_stack = virtual_kernel_stack;
+    process.kernel_rsp = virtual_kernel_stack + (scheduler::user_stack_size - 8);
+
+    clear_physical_memory(process.physical_kernel_stack, scheduler::kernel_stack_size / paging::PAGE_SIZE);
+
+    return true;
+}
+
 bool create_paging(char* buffer, scheduler::process_t& process){
     //1. Prepare PML4T
 
@@ -420,6 +1114,11 @@ bool create_paging(char* buffer, scheduler::process_t& process){
     //Map the kernel pages inside the user memory space
     paging::map_kernel_inside_user(process);
 
+    //Map the time page read-only (it is not owned by the process)
+    if(timer::time_page_physical()){
+        paging::user_map(process, timer::time_page_address, timer::time_page_physical(), paging::PRESENT | paging::USER);
+    }
+
     //2. Create all the other necessary structures
 
     //2.1 Allocate user stack
@@ -473,20 +1172,12 @@ bool create_paging(char* buffer, scheduler::process_t& process){
     }
 
     //2.3 Allocate kernel stack
-    auto virtual_kernel_stack = virtual_allocator::allocate(scheduler::kernel_stack_size / paging::PAGE_SIZE);
-    auto physical_kernel_stack = physical_allocator::allocate(scheduler::kernel_stack_size / paging::PAGE_SIZE);
-
-    if(!paging::map_pages(virtual_kernel_stack, physical_kernel_stack, scheduler::kernel_stack_size / paging::PAGE_SIZE)){
+    if(!allocate_kernel_stack(process)){
         return false;
     }
 
-    process.physical_kernel_stack = physical_kernel_stack;
-    process.virtual_kernel_stack = virtual_kernel_stack;
-    process.kernel_rsp = virtual_kernel_stack + (scheduler::user_stack_size - 8);
-
-    //3. Clear stacks
+    //3. Clear user stack
     clear_physical_memory(process.physical_user_stack, scheduler::user_stack_size / paging::PAGE_SIZE);
-    clear_physical_memory(process.physical_kernel_stack, scheduler::kernel_stack_size / paging::PAGE_SIZE);
 
     return true;
 }
@@ -559,16 +1250,45 @@ void init_context(scheduler::process_t& process, const char* buffer, const std::
     rsp = phys_ptr.get() + scheduler::user_stack_size - sizeof(interrupt::syscall_regs) - 8 - args_size;
     auto regs = reinterpret_cast<interrupt::syscall_regs*>(rsp);
 
-    regs->rsp = scheduler::user_rsp - sizeof(interrupt::syscall_regs) - args_size; //Not sure about that
-    regs->rip = header->e_entry;
-    regs->cs = gdt::USER_CODE_SELECTOR + 3;
-    regs->ds = gdt::USER_DATA_SELECTOR + 3;
-    regs->rflags = 0x200;
+    regs->rsp = scheduler::user_rsp - sizeof(interrupt::syscall_regs) - args_size; //Not sure about that
+    regs->rip = header->e_entry;
+    regs->cs = gdt::USER_CODE_SELECTOR + 3;
+    regs->ds = gdt::USER_DATA_SELECTOR + 3;
+    regs->rflags = 0x200;
+
+    regs->rdi = 1 + params.size(); //argc
+    regs->rsi = scheduler::user_rsp - params.size() * sizeof(size_t); //argv
+
+    process.context = reinterpret_cast<interrupt::syscall_regs*>(scheduler::user_rsp - sizeof(interrupt::syscall_regs) - args_size);
+}
+
+void preempt(bool force){
+    auto& cpu = this_cpu();
+    auto current_pid = cpu.current_pid;
+    auto& process = pcb[current_pid];
+
+    // The idle task looks for work at each tick
+    if(force || process.rounds >= cpu.rr_quantum || current_pid == cpu.idle_pid){
+        process.rounds = 0;
+
+        process.state = scheduler::process_state::READY;
+
+        auto pid = select_next_process();
+
+        //If it is the same, no need to go to the switching process
+        if(pid == current_pid){
+            process.state = scheduler::process_state::RUNNING;
+            return;
+        }
+
+        verbose_logf(logging::log_level::DEBUG, "scheduler: Preempt %u to %u\n", current_pid, pid);
 
-    regs->rdi = 1 + params.size(); //argc
-    regs->rsi = scheduler::user_rsp - params.size() * sizeof(size_t); //argv
+        switch_to_process(current_pid, pid);
+    } else {
+        ++process.rounds;
+    }
 
-    process.context = reinterpret_cast<interrupt::syscall_regs*>(scheduler::user_rsp - sizeof(interrupt::syscall_regs) - args_size);
+    //At this point we just have to return to the current process
 }
 
 } //end of anonymous namespace
@@ -585,32 +1305,130 @@ uint64_t get_process_cr3(size_t pid){
     return reinterpret_cast<uint64_t>(pcb[pid].process.physical_cr3);
 }
 
+void finish_task_switch(size_t old_pid, size_t new_pid){
+    // The context of the old process is saved, it can run elsewhere
+    if(old_pid != new_pid){
+        pcb[old_pid].on_cpu = false;
+    }
+}
+
 } //end of extern "C"
 
 void scheduler::init(){
+    std::fill_n(timer_wheel.begin(), timer_wheel.size(), scheduler::INVALID_PID);
+
+    for(auto& lock : address_space_locks){
+        lock.init();
+    }
+
+    for(auto& lock : resources_locks){
+        lock.init();
+    }
+
     //Create all the kernel tasks
-    create_idle_task();
+    create_idle_task(0);
     create_init_task();
     create_gc_task();
     create_post_init_task();
 
     procfs::set_pcb(pcb.data());
+
+    if(!interrupt::register_irq_handler(interrupt::IRQ_RESCHEDULE, reschedule_handler, nullptr)){
+        logging::logf(logging::log_level::ERROR, "scheduler: Unable to register the reschedule IPI handler\n");
+    }
 }
 
 void scheduler::start(){
+    auto& cpu = cpus[0];
+
     //Run the init task by default
-    current_pid = 1;
-    pcb[current_pid].state = scheduler::process_state::RUNNING;
+    cpu.current_pid = 1;
+    cpu.remove(cpu.current_pid);
+    pcb[cpu.current_pid].state = scheduler::process_state::RUNNING;
+    pcb[cpu.current_pid].on_cpu = true;
 
+    cpu.started = true;
     started = true;
 
-    init_task_switch(current_pid);
+    arch::set_task_switched();
+
+    init_task_switch(cpu.current_pid);
+}
+
+void scheduler::init_ap(size_t cpu){
+    cpus[cpu].rr_quantum = ROUND_ROBIN_QUANTUM * (smp::LAPIC_TIMER_FREQUENCY / 1000);
+
+    create_idle_task(cpu);
+}
+
+void scheduler::start_ap(){
+    direct_int_lock l;
+
+    auto& cpu = this_cpu();
+    auto& idle_process = pcb[cpu.idle_pid];
+
+    //Run the idle task, other processes will be stolen
+    cpu.current_pid = cpu.idle_pid;
+    idle_process.state = scheduler::process_state::RUNNING;
+    idle_process.on_cpu = true;
+
+    auto& tss = gdt::tss();
+    tss.rsp0_low = idle_process.process.kernel_rsp & 0xFFFFFFFF;
+    tss.rsp0_high = idle_process.process.kernel_rsp >> 32;
+
+    cpu.started = true;
+
+    arch::set_task_switched();
+
+    init_task_switch(cpu.idle_pid);
+}
+
+size_t scheduler::fpu_trap(){
+    auto& cpu = this_cpu();
+    auto& process = pcb[cpu.current_pid];
+
+    cpu.fpu_owner = cpu.current_pid;
+    process.fpu_cpu = smp::current_cpu();
+    ++process.fpu_traps;
+
+    return reinterpret_cast<size_t>(&process.fpu_state[0]);
+}
+
+void scheduler::kernel_fpu_begin(size_t& rflags){
+    arch::disable_hwint(rflags);
+
+    auto& cpu = this_cpu();
+
+    // The registers hold the live state of the owner only if TS is clear
+    if(!arch::task_switched() && cpu.fpu_owner != scheduler::INVALID_PID){
+        arch::fxsave(pcb[cpu.fpu_owner].fpu_state);
+    }
+
+    // The registers will not hold the state of any process anymore
+    cpu.fpu_owner = scheduler::INVALID_PID;
+
+    arch::clear_task_switched();
+    arch::reset_fpu();
+}
+
+void scheduler::kernel_fpu_end(size_t& rflags){
+    // The next FPU/SSE instruction of the process reloads its state
+    arch::set_task_switched();
+
+    arch::enable_hwint(rflags);
 }
 
 bool scheduler::is_started(){
     return started;
 }
 
+bool scheduler::is_running_remotely(pid_t pid){
+    auto& process = pcb[pid];
+    auto cpu = process.cpu;
+
+    return process.state == process_state::RUNNING && cpus[cpu].current_pid == pid && cpu != smp::current_cpu();
+}
+
 std::expected<scheduler::pid_t> scheduler::exec(const std::string& file, const std::vector<std::string>& params){
     logging::log(logging::log_level::TRACE, "scheduler:exec: read_file start\n");
 
@@ -638,13 +1456,23 @@ std::expected<scheduler::pid_t> scheduler::exec(const std::string& file, const s
         return std::make_unexpected<pid_t>(std::ERROR_NOT_EXECUTABLE);
     }
 
-    auto& process = new_process();
+    auto new_slot = new_process();
+
+    if(!new_slot){
+        logging::log(logging::log_level::DEBUG, "scheduler:exec: Too many processes\n");
+
+        return std::make_unexpected<pid_t>(std::ERROR_FAILED);
+    }
+
+    auto& process = *new_slot;
 
     process.name = file;
 
     if(!create_paging(buffer, process)){
         logging::log(logging::log_level::DEBUG, "scheduler:exec: Impossible to create paging\n");
 
+        release_pid(process.pid);
+
         return std::make_unexpected<pid_t>(std::ERROR_FAILED_EXECUTION);
     }
 
@@ -653,7 +1481,7 @@ std::expected<scheduler::pid_t> scheduler::exec(const std::string& file, const s
 
     init_context(process, buffer, file, params);
 
-    pcb[process.pid].working_directory = pcb[current_pid].working_directory;
+    pcb[process.pid].working_directory = get_working_directory();
 
     logging::logf(logging::log_level::DEBUG, "scheduler: Exec process pid=%u, ppid=%u\n", process.pid, process.ppid);
 
@@ -662,8 +1490,110 @@ std::expected<scheduler::pid_t> scheduler::exec(const std::string& file, const s
     return process.pid;
 }
 
+std::expected<scheduler::pid_t> scheduler::create_thread(size_t entry, size_t arg0, size_t arg1){
+    auto& leader = get_leader();
+
+    if(leader.system){
+        return std::make_unexpected<pid_t>(std::ERROR_FAILED);
+    }
+
+    //1. Reserve a stack slot in the address space
+
+    size_t slot;
+    while(true){
+        auto used = leader.thread_slots_used;
+
+        if(used == ~uint64_t(0)){
+            logging::logf(logging::log_level::DEBUG, "scheduler: Too many threads in process %u\n", leader.pid);
+
+            return std::make_unexpected<pid_t>(std::ERROR_FAILED);
+        }
+
+        slot = __builtin_ctzll(~used);
+
+        if(__sync_bool_compare_and_swap(&leader.thread_slots_used, used, used | (uint64_t(1) << slot))){
+            break;
+        }
+    }
+
+    auto stack_start = thread_stack_start + slot * thread_stack_slot;
+
+    // The stacks remain mapped until the leader exits, they are reused by the next threads
+    if(!(leader.thread_slots_mapped & (uint64_t(1) << slot))){
+        std::lock_guard<mutex> l(address_space_locks[leader.pid]);
+
+        segment_t segment;
+        segment.size = user_stack_size;
+
+        if(!allocate_user_memory(leader, stack_start, user_stack_size, segment.physical)){
+            __sync_fetch_and_and(&leader.thread_slots_used, ~(uint64_t(1) << slot));
+
+            return std::make_unexpected<pid_t>(std::ERROR_FAILED);
+        }
+
+        leader.segments.push_back(segment);
+
+        __sync_fetch_and_or(&leader.thread_slots_mapped, uint64_t(1) << slot);
+    }
+
+    //2. Create the thread itself
+
+    auto new_slot = new_process();
+
+    if(!new_slot){
+        logging::logf(logging::log_level::DEBUG, "scheduler: Too many processes for a thread of %u\n", leader.pid);
+
+        __sync_fetch_and_and(&leader.thread_slots_used, ~(uint64_t(1) << slot));
+
+        return std::make_unexpected<pid_t>(std::ERROR_FAILED);
+    }
+
+    auto& process = *new_slot;
+
+    process.name = leader.name;
+    process.tty = leader.tty;
+    process.leader = leader.pid;
+    process.thread_slot = slot;
+    process.physical_cr3 = leader.physical_cr3;
+    process.paging_size = leader.paging_size;
+
+    if(!allocate_kernel_stack(process)){
+        logging::log(logging::log_level::DEBUG, "scheduler: Impossible to allocate thread kernel stack\n");
+
+        __sync_fetch_and_and(&leader.thread_slots_used, ~(uint64_t(1) << slot));
+        release_pid(process.pid);
+
+        return std::make_unexpected<pid_t>(std::ERROR_FAILED);
+    }
+
+    //3. Prepare the context on the kernel stack, the other threads could modify it on the shared user stack
+
+    auto regs = reinterpret_cast<interrupt::syscall_regs*>(process.kernel_rsp - sizeof(interrupt::syscall_regs));
+
+    std::fill_n(reinterpret_cast<char*>(regs), sizeof(interrupt::syscall_regs), 0);
+
+    regs->rsp = stack_start + user_stack_size - 8;
+    regs->rip = entry;
+    regs->cs = gdt::USER_CODE_SELECTOR + 3;
+    regs->ds = gdt::USER_DATA_SELECTOR + 3;
+    regs->rflags = 0x200;
+
+    regs->rdi = arg0;
+    regs->rsi = arg1;
+
+    process.context = regs;
+
+    __sync_fetch_and_add(&leader.threads, 1);
+
+    logging::logf(logging::log_level::DEBUG, "scheduler: Create thread pid=%u, leader=%u\n", process.pid, leader.pid);
+
+    queue_process(process.pid);
+
+    return process.pid;
+}
+
 void scheduler::sbrk(size_t inc){
-    auto& process = pcb[current_pid].process;
+    auto& process = get_leader();
 
     size_t size = (inc + paging::PAGE_SIZE - 1) & ~(paging::PAGE_SIZE - 1);
     size_t pages = size / paging::PAGE_SIZE;
@@ -678,17 +1608,19 @@ void scheduler::sbrk(size_t inc){
         return;
     }
 
+    std::lock_guard<mutex> l(address_space_locks[process.pid]);
+
     auto virtual_start = process.brk_end;
 
     logging::logf(logging::log_level::DEBUG, "sbrk: Map(p%u) virtual:%h into phys: %h\n", process.pid, virtual_start, physical);
 
-    //Map the memory inside the process memory space
-    if(!paging::user_map_pages(process, virtual_start, physical, pages)){
+    //Map the memory inside the process memory space, large growths can use large pages
+    if(!paging::user_map_pages(process, virtual_start, physical, pages, pages >= paging::LARGE_PAGE_PAGES)){
         physical_allocator::free(physical, pages);
         return;
     }
 
-    process.segments.push_back({physical, pages});
+    process.segments.push_back({physical, size});
 
     process.brk_end += size;
 }
@@ -698,10 +1630,16 @@ void scheduler::await_termination(pid_t pid){
         {
             direct_int_lock lock;
 
+            std::lock_guard<int_spinlock> l(pid_lock);
+
+            auto current_pid = this_cpu().current_pid;
+
             bool found = false;
             for(auto& process : pcb){
-                if(process.process.ppid == current_pid && process.process.pid == pid){
+                if(process.unreaped && process.process.ppid == current_pid && process.process.pid == pid){
+                    // The slot can be reused once the process is cleaned
                     if(process.state == process_state::KILLED || process.state == process_state::EMPTY){
+                        process.unreaped = false;
                         return;
                     }
 
@@ -710,7 +1648,7 @@ void scheduler::await_termination(pid_t pid){
                 }
             }
 
-            // The process may have already been cleaned, we can simply return
+            // The process may have already been reaped, we can simply return
             if(!found){
                 return;
             }
@@ -726,14 +1664,28 @@ void scheduler::await_termination(pid_t pid){
 }
 
 void scheduler::kill_current_process(){
-    logging::logf(logging::log_level::DEBUG, "scheduler: Kill %u\n", current_pid);
+    logging::logf(logging::log_level::DEBUG, "scheduler: Kill %u\n", current_pid());
 
     {
         direct_int_lock lock;
 
+        auto current_pid = this_cpu().current_pid;
+
         // The process is now considered killed
         pcb[current_pid].state = scheduler::process_state::KILLED;
 
+        // The threads of the process terminate at their next return to user space
+        if(pcb[current_pid].process.threads){
+            for(auto& process : pcb){
+                if(process.process.leader == current_pid && process.process.pid != current_pid){
+                    process.exit_requested = true;
+
+                    // A thread waiting in userspace synchronization would never wake up
+                    futex::interrupt(process.process.pid);
+                }
+            }
+        }
+
         //Notify parent if waiting
         auto ppid = pcb[current_pid].process.ppid;
         for(auto& process : pcb){
@@ -752,65 +1704,142 @@ void scheduler::kill_current_process(){
     reschedule();
 }
 
-void scheduler::tick(){
-    if(!started){
-        return;
-    }
+bool scheduler::boost_priority(pid_t pid, size_t priority){
+    auto& process = pcb[pid];
+
+    while(true){
+        auto cpu_id = process.cpu;
+        auto& cpu = cpus[cpu_id];
 
-    // Update sleep timeouts
-    for(auto& process : pcb){
-        if(process.state == process_state::SLEEPING || process.state == process_state::BLOCKED_TIMEOUT){
-            --process.sleep_timeout;
+        std::lock_guard<int_spinlock> l(cpu.queue_lock);
 
-            if(process.sleep_timeout == 0){
-                verbose_logf(logging::log_level::TRACE, "scheduler: Process %u finished sleeping, is ready\n", process.process.pid);
-                process.state = process_state::READY;
-            }
+        // The process has been stolen in between
+        if(process.cpu != cpu_id){
+            continue;
+        }
+
+        // Compare with its own priority, it may already run with one inherited from another lock
+        auto own = process.base_priority ? process.base_priority : process.process.priority;
+
+        if(own >= priority){
+            return false;
+        }
+
+        if(!process.base_priority){
+            process.base_priority = process.process.priority;
+        }
+
+        ++process.boosts;
+
+        if(process.process.priority < priority){
+            logging::logf(logging::log_level::TRACE, "scheduler: Boost %u from %u to %u\n", pid, process.process.priority, priority);
+
+            cpu.set_priority(pid, priority);
         }
+
+        return true;
     }
+}
 
-    auto& process = pcb[current_pid];
+void scheduler::restore_priority(size_t boosts){
+    auto pid = current_pid();
+    auto& process = pcb[pid];
 
-    if(process.rounds == rr_quantum){
-        process.rounds = 0;
+    if(!process.base_priority){
+        return;
+    }
 
-        process.state = process_state::READY;
+    while(true){
+        auto cpu_id = process.cpu;
+        auto& cpu = cpus[cpu_id];
 
-        auto pid = select_next_process();
+        std::lock_guard<int_spinlock> l(cpu.queue_lock);
 
-        //If it is the same, no need to go to the switching process
-        if(pid == current_pid){
-            process.state = process_state::RUNNING;
+        // The process has been stolen in between
+        if(process.cpu != cpu_id){
+            continue;
+        }
+
+        process.boosts -= std::min(boosts, process.boosts);
+
+        // The waiters of the other locks still held keep the inherited priority
+        if(process.boosts){
             return;
         }
 
-        verbose_logf(logging::log_level::DEBUG, "scheduler: Preempt %u to %u\n", current_pid, pid);
+        cpu.set_priority(pid, process.base_priority);
+        process.base_priority = 0;
 
-        switch_to_process(pid);
-    } else {
-        ++process.rounds;
+        return;
     }
+}
 
-    //At this point we just have to return to the current process
+void scheduler::kernel_entry(bool system_call){
+    direct_int_lock l;
+
+    auto& process = pcb[this_cpu().current_pid];
+    auto now = arch::rdtsc();
+
+    process.user_time += now - process.last_tsc;
+    process.last_tsc = now;
+
+    if(system_call){
+        ++process.system_calls;
+    }
+}
+
+void scheduler::kernel_exit(){
+    direct_int_lock l;
+
+    auto& process = pcb[this_cpu().current_pid];
+    auto now = arch::rdtsc();
+
+    process.kernel_time += now - process.last_tsc;
+    process.last_tsc = now;
+}
+
+void scheduler::tick(){
+    if(!started){
+        return;
+    }
+
+    // Wake up the processes whose timeout expired
+    wheel_tick();
+
+    preempt(false);
+}
+
+void scheduler::local_tick(){
+    if(!this_cpu().started){
+        return;
+    }
+
+    preempt(false);
 }
 
 void scheduler::reschedule(){
     thor_assert(started, "No interest in rescheduling before start");
 
-    auto& process = pcb[current_pid];
+    direct_int_lock l;
+
+    auto current_pid = this_cpu().current_pid;
 
     //The process just got blocked or put to sleep, choose another one
-    if(process.state != process_state::RUNNING){
+    if(pcb[current_pid].state != process_state::RUNNING){
         auto index = select_next_process();
 
-        switch_to_process(index);
+        if(index == current_pid){
+            pcb[current_pid].state = process_state::RUNNING;
+        } else {
+            switch_to_process(current_pid, index);
+        }
     }
 
     //At this point we just have to return to the current process
 }
 
 scheduler::pid_t scheduler::get_pid(){
-    return current_pid;
+    return current_pid();
 }
 
 scheduler::process_t& scheduler::get_process(pid_t pid){
@@ -819,6 +1848,14 @@ scheduler::process_t& scheduler::get_process(pid_t pid){
     return pcb[pid].process;
 }
 
+scheduler::process_t& scheduler::get_leader(){
+    return pcb[leader_pid()].process;
+}
+
+bool scheduler::exit_requested(){
+    return pcb[current_pid()].exit_requested;
+}
+
 scheduler::process_state scheduler::get_process_state(pid_t pid){
     thor_assert(pid < scheduler::MAX_PROCESS, "pid out of bounds");
 
@@ -838,20 +1875,16 @@ void scheduler::block_process_timeout_light(pid_t pid, size_t ms){
 
     logging::logf(logging::log_level::DEBUG, "scheduler: Block process (light) %u with timeout %u\n", pid, ms);
 
-    // Compute the amount of ticks to sleep
-    auto sleep_ticks = ms * (timer::timer_frequency() / 1000);
-    sleep_ticks = !sleep_ticks ? 1 : sleep_ticks;
-
     // Put the process to sleep
-    pcb[pid].sleep_timeout = sleep_ticks;
-
     pcb[pid].state = process_state::BLOCKED_TIMEOUT;
+
+    arm_timer(pid, ms);
 }
 
 void scheduler::block_process(pid_t pid){
     thor_assert(is_started(), "The scheduler is not started");
     thor_assert(pid < scheduler::MAX_PROCESS, "pid out of bounds");
-    thor_assert(pid != idle_pid, "No reason to block the idle task");
+    thor_assert(!is_idle(pid), "No reason to block the idle task");
 
     logging::logf(logging::log_level::DEBUG, "scheduler: Block process %u\n", pid);
 
@@ -864,105 +1897,180 @@ void scheduler::unblock_process(pid_t pid){
     logging::logf(logging::log_level::DEBUG, "scheduler: Unblock process %u (%u)\n", pid, size_t(pcb[pid].state));
 
     thor_assert(pid < scheduler::MAX_PROCESS, "pid out of bounds");
-    thor_assert(pid != idle_pid, "No reason to unblock the idle task");
+    thor_assert(!is_idle(pid), "No reason to unblock the idle task");
     thor_assert(is_started(), "The scheduler is not started");
     thor_assert(pcb[pid].state == process_state::BLOCKED || pcb[pid].state == process_state::BLOCKED_TIMEOUT || pcb[pid].state == process_state::WAITING, "Can only unblock BLOCKED/WAITING processes");
 
-    pcb[pid].state = process_state::READY;
+    cancel_timer(pid);
+
+    make_ready(pid);
 }
 
 void scheduler::unblock_process_hint(pid_t pid){
     logging::logf(logging::log_level::DEBUG, "scheduler: Unblock process (hint) %u (%u)\n", pid, size_t(pcb[pid].state));
 
     thor_assert(pid < scheduler::MAX_PROCESS, "pid out of bounds");
-    thor_assert(pid != idle_pid, "No reason to unblock the idle task");
+    thor_assert(!is_idle(pid), "No reason to unblock the idle task");
     thor_assert(is_started(), "The scheduler is not started");
 
     auto state = pcb[pid].state;
 
     if(state != process_state::RUNNING){
-        pcb[pid].state = process_state::READY;
+        cancel_timer(pid);
+
+        make_ready(pid);
+    }
+}
+
+bool scheduler::try_unblock_process(pid_t pid){
+    thor_assert(pid < scheduler::MAX_PROCESS, "pid out of bounds");
+
+    // The timer wheel wakes up the expired processes under the same lock
+    std::lock_guard<int_spinlock> l(timer_lock);
+
+    auto state = pcb[pid].state;
+
+    if(state != process_state::BLOCKED && state != process_state::BLOCKED_TIMEOUT){
+        return false;
+    }
+
+    if(pcb[pid].timer_queued){
+        wheel_remove(pid);
     }
+
+    make_ready(pid);
+
+    return true;
 }
 
 void scheduler::sleep_ms(size_t time){
-    sleep_ms(current_pid, time);
+    sleep_ms(current_pid(), time);
 }
 
 void scheduler::sleep_ms(pid_t pid, size_t time){
     thor_assert(pid < scheduler::MAX_PROCESS, "pid out of bounds");
     thor_assert(pcb[pid].state == process_state::RUNNING, "Only RUNNING processes can sleep");
 
-    // Compute the amount of ticks to sleep
-    auto sleep_ticks = time * (timer::timer_frequency() / 1000);
-    sleep_ticks = !sleep_ticks ? 1 : sleep_ticks;
-
-    logging::logf(logging::log_level::DEBUG, "scheduler: Put %u to sleep for %u ticks\n", pid, sleep_ticks);
+    logging::logf(logging::log_level::DEBUG, "scheduler: Put %u to sleep for %ums\n", pid, time);
 
     // Put the process to sleep
-    pcb[pid].sleep_timeout = sleep_ticks;
     pcb[pid].state = process_state::SLEEPING;
 
+    arm_timer(pid, time);
+
     // Run another process
     reschedule();
 }
 
+mutex& scheduler::resources_lock(pid_t pid){
+    return resources_locks[pid];
+}
+
 size_t scheduler::register_new_handle(const path& p){
-    pcb[current_pid].handles.push_back(p);
+    auto leader = leader_pid();
+
+    std::lock_guard<mutex> l(resources_locks[leader]);
+
+    pcb[leader].handles.push_back(p);
 
-    return pcb[current_pid].handles.size();
+    return pcb[leader].handles.size();
 }
 
 void scheduler::release_handle(size_t fd){
-    pcb[current_pid].handles[fd - 1].invalidate();
+    auto leader = leader_pid();
+
+    std::lock_guard<mutex> l(resources_locks[leader]);
+
+    pcb[leader].handles[fd - 1].invalidate();
 }
 
 bool scheduler::has_handle(size_t fd){
-    return fd > 0 && fd <= pcb[current_pid].handles.size() && pcb[current_pid].handles[fd - 1].is_valid();
+    auto leader = leader_pid();
+
+    std::lock_guard<mutex> l(resources_locks[leader]);
+
+    return fd > 0 && fd <= pcb[leader].handles.size() && pcb[leader].handles[fd - 1].is_valid();
 }
 
-const path& scheduler::get_handle(size_t fd){
-    return pcb[current_pid].handles[fd - 1];
+path scheduler::get_handle(size_t fd){
+    auto leader = leader_pid();
+
+    std::lock_guard<mutex> l(resources_locks[leader]);
+
+    return pcb[leader].handles[fd - 1];
 }
 
-size_t scheduler::register_new_socket(network::socket_domain domain, network::socket_type type, network::socket_protocol protocol){
-    auto id = pcb[current_pid].sockets.size() + 1;
+std::expected<size_t> scheduler::register_new_socket(network::socket_domain domain, network::socket_type type, network::socket_protocol protocol){
+    auto leader = leader_pid();
+
+    std::lock_guard<mutex> l(resources_locks[leader]);
+
+    auto& sockets = pcb[leader].sockets;
+
+    if(sockets.size() == MAX_SOCKETS){
+        return std::make_unexpected<size_t>(std::ERROR_FAILED);
+    }
+
+    // The sockets are used without the lock by the other threads
+    sockets.reserve(MAX_SOCKETS);
+
+    auto id = sockets.size() + 1;
 
-    pcb[current_pid].sockets.emplace_back(id, domain, type, protocol, size_t(1), false);
+    sockets.emplace_back(id, domain, type, protocol, size_t(1), false);
 
     return id;
 }
 
 void scheduler::release_socket(size_t fd){
-    pcb[current_pid].sockets[fd - 1].invalidate();
+    auto leader = leader_pid();
+
+    std::lock_guard<mutex> l(resources_locks[leader]);
+
+    pcb[leader].sockets[fd - 1].invalidate();
 }
 
 bool scheduler::has_socket(size_t fd){
-    return fd > 0 && fd - 1 < pcb[current_pid].sockets.size() && pcb[current_pid].sockets[fd - 1].is_valid();
+    auto leader = leader_pid();
+
+    std::lock_guard<mutex> l(resources_locks[leader]);
+
+    return fd > 0 && fd - 1 < pcb[leader].sockets.size() && pcb[leader].sockets[fd - 1].is_valid();
 }
 
 network::socket& scheduler::get_socket(size_t fd){
-    return pcb[current_pid].sockets[fd - 1];
+    return pcb[leader_pid()].sockets[fd - 1];
 }
 
 std::vector<network::socket>& scheduler::get_sockets(){
-    return pcb[current_pid].sockets;
+    return pcb[leader_pid()].sockets;
 }
 
 std::vector<network::socket>& scheduler::get_sockets(scheduler::pid_t pid){
     return pcb[pid].sockets;
 }
 
-const path& scheduler::get_working_directory(){
-    return pcb[current_pid].working_directory;
+path scheduler::get_working_directory(){
+    auto leader = leader_pid();
+
+    std::lock_guard<mutex> l(resources_locks[leader]);
+
+    return pcb[leader].working_directory;
 }
 
 void scheduler::set_working_directory(const path& directory){
-    pcb[current_pid].working_directory = directory;
+    auto leader = leader_pid();
+
+    std::lock_guard<mutex> l(resources_locks[leader]);
+
+    pcb[leader].working_directory = directory;
 }
 
 scheduler::process_t& scheduler::create_kernel_task(const char* name, char* user_stack, char* kernel_stack, void (*fun)()){
-    auto& process = new_process();
+    auto new_slot = new_process();
+
+    thor_assert(new_slot, "No free slot for a kernel task");
+
+    auto& process = *new_slot;
 
     process.system = true;
     process.physical_cr3 = paging::get_physical_pml4t();
@@ -1014,9 +2122,19 @@ void scheduler::queue_system_process(scheduler::pid_t pid){
     thor_assert(process.process.priority <= scheduler::MAX_PRIORITY, "Invalid priority");
     thor_assert(process.process.priority >= scheduler::MIN_PRIORITY, "Invalid priority");
 
-    process.state = scheduler::process_state::READY;
+    enqueue(pid, 0);
+}
+
+void scheduler::queue_system_process(scheduler::pid_t pid, size_t cpu){
+    thor_assert(pid < scheduler::MAX_PROCESS, "pid out of bounds");
+    thor_assert(cpu < smp::cpus(), "cpu out of bounds");
+
+    auto& process = pcb[pid];
 
-    run_queue(process.process.priority).push_back(pid);
+    thor_assert(process.process.priority <= scheduler::MAX_PRIORITY, "Invalid priority");
+    thor_assert(process.process.priority >= scheduler::MIN_PRIORITY, "Invalid priority");
+
+    enqueue(pid, cpu);
 }
 
 void scheduler::queue_async_init_task(void (*fun)()){
@@ -1027,13 +2145,25 @@ void scheduler::frequency_updated(uint64_t old_frequency, uint64_t new_frequency
     // Cannot be interrupted during frequency update
     direct_int_lock lock;
 
-    rr_quantum = ROUND_ROBIN_QUANTUM * (double(new_frequency) / double(1000));
+    // The global timer only drives the bootstrap processor
+    auto& rr_quantum = cpus[0].rr_quantum;
+    rr_quantum = ROUND_ROBIN_QUANTUM * new_frequency / 1000;
+
+    if(old_frequency){
+        std::lock_guard<int_spinlock> l(timer_lock);
 
-    double ratio = old_frequency / double(new_frequency);
+        // Rescale the remaining ticks of the sleeping processes
+        for(auto& process : pcb){
+            if(process.timer_queued){
+                auto pid = process.process.pid;
+
+                wheel_remove(pid);
 
-    for(auto& process : pcb){
-        if(process.state == process_state::SLEEPING){
-            process.sleep_timeout *= ratio;
+                auto remaining = process.wake_tick > wheel_ticks ? process.wake_tick - wheel_ticks : 0;
+                process.wake_tick = wheel_ticks + std::max(uint64_t(remaining * new_frequency / old_frequency), uint64_t(1));
+
+                wheel_insert(pid);
+            }
         }
     }
 
@@ -1041,7 +2171,7 @@ void scheduler::frequency_updated(uint64_t old_frequency, uint64_t new_frequency
 }
 
 void scheduler::fault(){
-    logging::logf(logging::log_level::DEBUG, "scheduler: Fault in %u kill it\n", current_pid);
+    logging::logf(logging::log_level::DEBUG, "scheduler: Fault in %u kill it\n", current_pid());
 
     kill_current_process();
 }
@@ -0,0 +1,545 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <array.hpp>
+#include <lock_guard.hpp>
+
+#include "slab.hpp"
+#include "kalloc.hpp"
+#include "arch.hpp"
+#include "physical_allocator.hpp"
+#include "virtual_allocator.hpp"
+#include "paging.hpp"
+#include "assert.hpp"
+#include "logging.hpp"
+
+#include "fs/sysfs.hpp"
+
+/*!
+ * \brief The header of a slab, at the beginning of its memory
+ */
+struct slab::slab_t {
+    slab::cache* owner; ///< The cache of the slab
+    slab_t* next;       ///< The next slab in the list of the cache
+    slab_t* prev;       ///< The previous slab in the list of the cache
+    void* free_list;    ///< The first free object of the slab
+    size_t used;        ///< The number of objects in use
+    size_t physical;    ///< The physical memory of the slab
+};
+
+/*!
+ * \brief A stack of free objects
+ */
+struct slab::magazine_t {
+    magazine_t* next;                   ///< The next magazine in the depot
+    size_t rounds;                      ///< The number of objects in the magazine
+    void* objects[slab::MAGAZINE_SIZE]; ///< The objects
+};
+
+/*!
+ * \brief The magazines of a processor for a cache
+ */
+struct slab::cpu_cache_t {
+    magazine_t* loaded;   ///< The magazine used for allocations and frees
+    magazine_t* previous; ///< The magazine used before, full or empty
+};
+
+namespace {
+
+constexpr const size_t MAX_CACHES = 32;
+constexpr const size_t GENERAL_CACHES = 9; ///< 16, 32, ..., 4096
+constexpr const size_t ALIGNMENT = 16;
+
+constexpr size_t align(size_t size){
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+constexpr const size_t HEADER_SIZE = align(sizeof(slab::slab_t));
+
+static_assert(slab::MAX_SIZE == slab::MIN_SIZE << (GENERAL_CACHES - 1), "Invalid number of general caches");
+
+const char* general_names[GENERAL_CACHES] = {
+    "size-16", "size-32", "size-64", "size-128", "size-256",
+    "size-512", "size-1024", "size-2048", "size-4096"
+};
+
+std::array<slab::cache, MAX_CACHES> caches;
+size_t caches_count = 0;
+int_spinlock caches_lock;
+
+std::array<slab::cache*, GENERAL_CACHES> general_caches;
+
+bool _initialized = false;
+
+// One bit for each possible slab of the kernel virtual memory
+std::array<uint64_t, virtual_allocator::kernel_virtual_size / slab::SLAB_SIZE / 64> slab_bitmap;
+
+void mark_slab(size_t address, bool slab){
+    auto index = address / slab::SLAB_SIZE;
+    auto bit = uint64_t(1) << (index % 64);
+
+    if(slab){
+        __sync_fetch_and_or(&slab_bitmap[index / 64], bit);
+    } else {
+        __sync_fetch_and_and(&slab_bitmap[index / 64], ~bit);
+    }
+}
+
+// The free objects are linked through their first word, or after
+// the object when it must keep its constructed state
+void** link(const slab::cache& c, void* object){
+    return reinterpret_cast<void**>(static_cast<char*>(object) + (c.constructor ? c.object_size : 0));
+}
+
+void push(slab::slab_t*& list, slab::slab_t* s){
+    s->prev = nullptr;
+    s->next = list;
+
+    if(list){
+        list->prev = s;
+    }
+
+    list = s;
+}
+
+void unlink(slab::slab_t*& list, slab::slab_t* s){
+    if(s->prev){
+        s->prev->next = s->next;
+    } else {
+        list = s->next;
+    }
+
+    if(s->next){
+        s->next->prev = s->prev;
+    }
+
+    s->next = nullptr;
+    s->prev = nullptr;
+}
+
+// Must be called with the lock of the cache held
+slab::slab_t* new_slab(slab::cache& c){
+    auto physical = physical_allocator::allocate(slab::SLAB_PAGES);
+
+    if(!physical){
+        return nullptr;
+    }
+
+    auto virt = virtual_allocator::allocate(slab::SLAB_PAGES);
+
+    if(!virt){
+        physical_allocator::free(physical, slab::SLAB_PAGES);
+        return nullptr;
+    }
+
+    // The buddy allocator returns blocks aligned on their size
+    thor_assert(!(virt & (slab::SLAB_SIZE - 1)), "slab: unaligned slab");
+
+    if(!paging::map_pages(virt, physical, slab::SLAB_PAGES)){
+        virtual_allocator::free(virt, slab::SLAB_PAGES);
+        physical_allocator::free(physical, slab::SLAB_PAGES);
+        return nullptr;
+    }
+
+    auto* s = reinterpret_cast<slab::slab_t*>(virt);
+    s->owner = &c;
+    s->next = nullptr;
+    s->prev = nullptr;
+    s->free_list = nullptr;
+    s->used = 0;
+    s->physical = physical;
+
+    // Chain the objects, in order of their addresses
+    for(size_t i = c.objects_per_slab; i > 0; --i){
+        auto* object = reinterpret_cast<char*>(virt) + HEADER_SIZE + (i - 1) * c.slot_size;
+
+        if(c.constructor){
+            c.constructor(object);
+        }
+
+        *link(c, object) = s->free_list;
+        s->free_list = object;
+    }
+
+    mark_slab(virt, true);
+
+    ++c.slabs;
+
+    return s;
+}
+
+// Must be called with the lock of the cache held
+void release_slab(slab::cache& c, slab::slab_t* s){
+    auto virt = reinterpret_cast<size_t>(s);
+    auto physical = s->physical;
+
+    mark_slab(virt, false);
+
+    paging::unmap_pages(virt, slab::SLAB_PAGES);
+    virtual_allocator::free(virt, slab::SLAB_PAGES);
+    physical_allocator::free(physical, slab::SLAB_PAGES);
+
+    --c.slabs;
+}
+
+// Must be called with the lock of the cache held
+void* allocate_locked(slab::cache& c){
+    auto* s = c.partial;
+
+    if(!s){
+        if(c.empty){
+            s = c.empty;
+            c.empty = nullptr;
+        } else {
+            s = new_slab(c);
+
+            if(!s){
+                return nullptr;
+            }
+        }
+
+        push(c.partial, s);
+    }
+
+    auto* object = s->free_list;
+    s->free_list = *link(c, object);
+
+    ++s->used;
+    ++c.used;
+    ++c.allocations;
+
+    if(!s->free_list){
+        unlink(c.partial, s);
+        push(c.full, s);
+    }
+
+    return object;
+}
+
+// Must be called with the lock of the cache held
+void free_locked(slab::cache& c, void* address){
+    auto* s = reinterpret_cast<slab::slab_t*>(reinterpret_cast<size_t>(address) & ~(slab::SLAB_SIZE - 1));
+
+    bool was_full = !s->free_list;
+
+    *link(c, address) = s->free_list;
+    s->free_list = address;
+
+    --s->used;
+    --c.used;
+
+    if(was_full){
+        unlink(c.full, s);
+        push(c.partial, s);
+    }
+
+    if(!s->used){
+        unlink(c.partial, s);
+
+        // Keep one empty slab to avoid allocating a slab for each object
+        if(!c.empty){
+            c.empty = s;
+        } else {
+            release_slab(c, s);
+        }
+    }
+}
+
+slab::magazine_t* new_magazine(){
+    // The magazines must not come from the caches themselves
+    auto* magazine = static_cast<slab::magazine_t*>(kalloc::k_malloc(sizeof(slab::magazine_t)));
+
+    if(magazine){
+        magazine->next = nullptr;
+        magazine->rounds = 0;
+    }
+
+    return magazine;
+}
+
+// Must be called with the interrupts disabled
+slab::cpu_cache_t* cpu_cache(slab::cache& c){
+    auto cpu = smp::current_cpu();
+    auto* cpu_cache = c.cpus[cpu];
+
+    if(!cpu_cache){
+        cpu_cache = static_cast<slab::cpu_cache_t*>(kalloc::k_malloc(sizeof(slab::cpu_cache_t)));
+
+        if(!cpu_cache){
+            return nullptr;
+        }
+
+        cpu_cache->loaded = new_magazine();
+        cpu_cache->previous = new_magazine();
+
+        if(!cpu_cache->loaded || !cpu_cache->previous){
+            if(cpu_cache->loaded){
+                kalloc::k_free(cpu_cache->loaded);
+            }
+
+            if(cpu_cache->previous){
+                kalloc::k_free(cpu_cache->previous);
+            }
+
+            kalloc::k_free(cpu_cache);
+
+            return nullptr;
+        }
+
+        c.cpus[cpu] = cpu_cache;
+    }
+
+    return cpu_cache;
+}
+
+// Load a magazine with objects, from the depot or from the slabs
+void refill(slab::cache& c, slab::cpu_cache_t& cpu){
+    std::lock_guard<int_spinlock> l(c.lock);
+
+    if(c.full_magazines){
+        auto* full = c.full_magazines;
+        c.full_magazines = full->next;
+        --c.depot_full;
+
+        // The empty magazine goes back to the depot
+        cpu.previous->next = c.empty_magazines;
+        c.empty_magazines = cpu.previous;
+
+        cpu.previous = cpu.loaded;
+        cpu.loaded = full;
+
+        ++c.exchanges;
+
+        return;
+    }
+
+    // Fill half of the magazine so that the next frees do not drain it directly
+    auto* magazine = cpu.loaded;
+
+    while(magazine->rounds < slab::MAGAZINE_SIZE / 2){
+        auto* object = allocate_locked(c);
+
+        if(!object){
+            break;
+        }
+
+        magazine->objects[magazine->rounds++] = object;
+    }
+}
+
+// Unload a full magazine, to the depot or to the slabs
+void drain(slab::cache& c, slab::cpu_cache_t& cpu){
+    std::lock_guard<int_spinlock> l(c.lock);
+
+    if(c.depot_full < slab::DEPOT_SIZE){
+        auto* empty = c.empty_magazines;
+
+        if(empty){
+            c.empty_magazines = empty->next;
+        } else {
+            empty = new_magazine();
+        }
+
+        if(empty){
+            // The full magazine goes to the depot
+            cpu.previous->next = c.full_magazines;
+            c.full_magazines = cpu.previous;
+            ++c.depot_full;
+
+            cpu.previous = cpu.loaded;
+            cpu.loaded = empty;
+
+            ++c.exchanges;
+
+            return;
+        }
+    }
+
+    // Return half of the objects to their slabs
+    auto* magazine = cpu.loaded;
+
+    while(magazine->rounds > slab::MAGAZINE_SIZE / 2){
+        free_locked(c, magazine->objects[--magazine->rounds]);
+    }
+}
+
+size_t general_index(size_t size){
+    if(size <= slab::MIN_SIZE){
+        return 0;
+    }
+
+    return 64 - __builtin_clzll(size - 1) - 4;
+}
+
+std::string sysfs_caches(){
+    std::string value;
+
+    std::lock_guard<int_spinlock> l(caches_lock);
+
+    for(size_t i = 0; i < caches_count; ++i){
+        auto& c = caches[i];
+
+        value += c.name;
+        value += ' ';
+        value += std::to_string(c.object_size);
+        value += ' ';
+        value += std::to_string(c.used);
+        value += ' ';
+        value += std::to_string(c.slabs * c.objects_per_slab);
+        value += ' ';
+        value += std::to_string(c.slabs);
+        value += ' ';
+        value += std::to_string(c.allocations);
+        value += ' ';
+        value += std::to_string(c.exchanges);
+        value += '\n';
+    }
+
+    return value;
+}
+
+std::string sysfs_memory(){
+    size_t slabs = 0;
+
+    for(size_t i = 0; i < caches_count; ++i){
+        slabs += caches[i].slabs;
+    }
+
+    return std::to_string(slabs * slab::SLAB_SIZE);
+}
+
+} //end of anonymous namespace
+
+void slab::init(){
+    for(size_t i = 0; i < GENERAL_CACHES; ++i){
+        general_caches[i] = create_cache(general_names[i], MIN_SIZE << i);
+    }
+
+    _initialized = true;
+}
+
+void slab::finalize(){
+    sysfs::set_dynamic_value(path("/sys"), path("/memory/slab/caches"), &sysfs_caches);
+    sysfs::set_dynamic_value(path("/sys"), path("/memory/slab/memory"), &sysfs_memory);
+}
+
+bool slab::initialized(){
+    return _initialized;
+}
+
+slab::cache* slab::create_cache(const char* name, size_t size, void (*constructor)(void*)){
+    std::lock_guard<int_spinlock> l(caches_lock);
+
+    if(caches_count == MAX_CACHES){
+        logging::logf(logging::log_level::ERROR, "slab: Too many caches, cannot create %s\n", name);
+        return nullptr;
+    }
+
+    auto& c = caches[caches_count++];
+
+    c.name = name;
+    c.object_size = size;
+    c.constructor = constructor;
+    c.slot_size = align(constructor ? size + sizeof(void*) : std::max(size, sizeof(void*)));
+    c.objects_per_slab = (SLAB_SIZE - HEADER_SIZE) / c.slot_size;
+    c.partial = nullptr;
+    c.full = nullptr;
+    c.empty = nullptr;
+    c.slabs = 0;
+    c.used = 0;
+    c.allocations = 0;
+    c.exchanges = 0;
+    c.full_magazines = nullptr;
+    c.empty_magazines = nullptr;
+    c.depot_full = 0;
+
+    for(auto& cpu : c.cpus){
+        cpu = nullptr;
+    }
+
+    return &c;
+}
+
+void* slab::allocate(cache& c){
+    size_t rflags;
+    arch::disable_hwint(rflags);
+
+    auto* cpu = cpu_cache(c);
+
+    if(!cpu){
+        arch::enable_hwint(rflags);
+
+        std::lock_guard<int_spinlock> l(c.lock);
+        return allocate_locked(c);
+    }
+
+    if(!cpu->loaded->rounds){
+        if(cpu->previous->rounds){
+            std::swap(cpu->loaded, cpu->previous);
+        } else {
+            refill(c, *cpu);
+        }
+    }
+
+    void* object = nullptr;
+
+    if(cpu->loaded->rounds){
+        object = cpu->loaded->objects[--cpu->loaded->rounds];
+    }
+
+    arch::enable_hwint(rflags);
+
+    return object;
+}
+
+void* slab::allocate(size_t size){
+    thor_assert(size <= MAX_SIZE, "slab: too large allocation");
+
+    return allocate(*general_caches[general_index(size)]);
+}
+
+bool slab::is_slab(const void* address){
+    auto value = reinterpret_cast<size_t>(address);
+
+    if(value >= virtual_allocator::kernel_virtual_size){
+        return false;
+    }
+
+    auto index = value / SLAB_SIZE;
+
+    return slab_bitmap[index / 64] & (uint64_t(1) << (index % 64));
+}
+
+void slab::free(void* address){
+    auto* s = reinterpret_cast<slab_t*>(reinterpret_cast<size_t>(address) & ~(SLAB_SIZE - 1));
+    auto& c = *s->owner;
+
+    size_t rflags;
+    arch::disable_hwint(rflags);
+
+    auto* cpu = cpu_cache(c);
+
+    if(!cpu){
+        arch::enable_hwint(rflags);
+
+        std::lock_guard<int_spinlock> l(c.lock);
+        free_locked(c, address);
+        return;
+    }
+
+    if(cpu->loaded->rounds == MAGAZINE_SIZE){
+        if(cpu->previous->rounds < MAGAZINE_SIZE){
+            std::swap(cpu->loaded, cpu->previous);
+        } else {
+            drain(c, *cpu);
+        }
+    }
+
+    cpu->loaded->objects[cpu->loaded->rounds++] = address;
+
+    arch::enable_hwint(rflags);
+}
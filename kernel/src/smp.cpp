@@ -0,0 +1,366 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <array.hpp>
+#include <algorithms.hpp>
+
+#include "smp.hpp"
+#include "acpica.hpp"
+#include "arch.hpp"
+#include "gdt.hpp"
+#include "interrupts.hpp"
+#include "logging.hpp"
+#include "paging.hpp"
+#include "scheduler.hpp"
+#include "timer.hpp"
+#include "work_queue.hpp"
+#include "profiler.hpp"
+
+#include "drivers/lapic.hpp"
+#include "drivers/ioapic.hpp"
+
+#include "fs/sysfs.hpp"
+
+extern "C" {
+
+// Defined in ap_trampoline.s
+extern char ap_trampoline_start[];
+extern char ap_trampoline_end[];
+extern char ap_trampoline_cr3[];
+extern char ap_trampoline_stack[];
+extern char ap_trampoline_entry[];
+
+void _ap_main();
+
+} //end of extern "C"
+
+namespace {
+
+// The trampoline is copied at this address and the APs start there
+constexpr const size_t TRAMPOLINE_ADDRESS = 0x8000;
+
+constexpr const size_t AP_STACK_SIZE = 4 * paging::PAGE_SIZE;
+
+// Maximum time to wait for an AP to come online
+constexpr const uint64_t AP_STARTUP_TIMEOUT_MS = 100;
+
+std::array<smp::cpu_t, smp::MAX_CPUS> cpu_table;
+size_t cpus_count = 1;
+
+// Logical processor id for each local APIC id
+std::array<uint8_t, 256> apic_to_cpu;
+
+uint64_t lapic_address = 0;
+
+constexpr const uint32_t MSR_TSC_AUX = 0xC0000103;
+
+// When RDTSCP is supported, the logical id of each processor is cached in
+// its IA32_TSC_AUX, rather than looked up from the local APIC id
+bool tsc_aux_cpu = false;
+
+bool rdtscp_supported(){
+    uint32_t eax, ebx, ecx, edx;
+
+    arch::cpuid(0x80000000, eax, ebx, ecx, edx);
+
+    if(eax < 0x80000001){
+        return false;
+    }
+
+    arch::cpuid(0x80000001, eax, ebx, ecx, edx);
+
+    return edx & (1 << 27);
+}
+
+volatile size_t online_count = 1;
+volatile size_t booting_cpu = 0;
+
+template<typename T>
+T* trampoline_variable(char* symbol){
+    return reinterpret_cast<T*>(TRAMPOLINE_ADDRESS + (symbol - ap_trampoline_start));
+}
+
+void busy_wait_us(uint64_t us){
+    auto ticks = std::max(uint64_t(1), (timer::counter_frequency() * us) / 1000000);
+    auto start = timer::counter();
+
+    while(timer::counter() - start < ticks){
+        arch::pause();
+    }
+}
+
+uint32_t bsp_apic_id(){
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+    return ebx >> 24;
+}
+
+void add_cpu(uint32_t apic_id){
+    // The BSP is already registered
+    if(apic_id == cpu_table[0].apic_id){
+        return;
+    }
+
+    if(cpus_count == smp::MAX_CPUS){
+        logging::logf(logging::log_level::WARNING, "smp: Too many processors, ignoring APIC %u\n", size_t(apic_id));
+        return;
+    }
+
+    auto& cpu = cpu_table[cpus_count];
+
+    cpu.id = cpus_count;
+    cpu.apic_id = apic_id;
+    cpu.online = false;
+    cpu.ticks = 0;
+    cpu.stack = nullptr;
+
+    apic_to_cpu[apic_id] = cpus_count;
+
+    ++cpus_count;
+}
+
+bool parse_madt(){
+    ACPI_TABLE_MADT* madt;
+    auto status = AcpiGetTable(ACPI_SIG_MADT, 0, reinterpret_cast<ACPI_TABLE_HEADER **>(&madt));
+    if (ACPI_FAILURE(status)){
+        return false;
+    }
+
+    logging::logf(logging::log_level::TRACE, "smp: Found ACPI MADT table\n");
+
+    lapic_address = madt->Address;
+
+    auto it = reinterpret_cast<uint8_t*>(madt) + sizeof(ACPI_TABLE_MADT);
+    auto end = reinterpret_cast<uint8_t*>(madt) + madt->Header.Length;
+
+    while(it < end){
+        auto* header = reinterpret_cast<ACPI_SUBTABLE_HEADER*>(it);
+
+        if(!header->Length){
+            break;
+        }
+
+        switch(header->Type){
+            case ACPI_MADT_TYPE_LOCAL_APIC: {
+                auto* entry = reinterpret_cast<ACPI_MADT_LOCAL_APIC*>(header);
+
+                if(entry->LapicFlags & ACPI_MADT_ENABLED){
+                    add_cpu(entry->Id);
+                }
+
+                break;
+            }
+
+            case ACPI_MADT_TYPE_IO_APIC: {
+                auto* entry = reinterpret_cast<ACPI_MADT_IO_APIC*>(header);
+                ioapic::add(entry->Id, entry->Address, entry->GlobalIrqBase);
+                break;
+            }
+
+            case ACPI_MADT_TYPE_INTERRUPT_OVERRIDE: {
+                auto* entry = reinterpret_cast<ACPI_MADT_INTERRUPT_OVERRIDE*>(header);
+                ioapic::add_override(entry->SourceIrq, entry->GlobalIrq, entry->IntiFlags);
+                break;
+            }
+
+            case ACPI_MADT_TYPE_LOCAL_APIC_OVERRIDE: {
+                auto* entry = reinterpret_cast<ACPI_MADT_LOCAL_APIC_OVERRIDE*>(header);
+                lapic_address = entry->Address;
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        it += header->Length;
+    }
+
+    return true;
+}
+
+// Let the ACPI firmware know that the interrupts are routed through the APIC
+void acpi_apic_mode(){
+    ACPI_OBJECT arg;
+    arg.Type = ACPI_TYPE_INTEGER;
+    arg.Integer.Value = 1;
+
+    ACPI_OBJECT_LIST args;
+    args.Count = 1;
+    args.Pointer = &arg;
+
+    auto status = AcpiEvaluateObject(nullptr, const_cast<char*>("\\_PIC"), &args, nullptr);
+    if(ACPI_FAILURE(status) && status != AE_NOT_FOUND){
+        logging::logf(logging::log_level::ERROR, "smp: Unable to switch ACPI to APIC mode\n");
+    }
+}
+
+void local_timer_handler(interrupt::syscall_regs* regs, void*){
+    ++cpu_table[smp::current_cpu()].ticks;
+
+    profiler::tick(regs);
+
+    scheduler::local_tick();
+}
+
+bool start_ap(smp::cpu_t& cpu){
+    cpu.stack = new char[AP_STACK_SIZE];
+
+    *trampoline_variable<uint64_t>(ap_trampoline_cr3) = arch::get_cr3();
+    *trampoline_variable<uint64_t>(ap_trampoline_stack) = reinterpret_cast<uint64_t>(cpu.stack + AP_STACK_SIZE) & ~uint64_t(0xF);
+    *trampoline_variable<uint64_t>(ap_trampoline_entry) = reinterpret_cast<uint64_t>(&_ap_main);
+
+    booting_cpu = cpu.id;
+
+    scheduler::init_ap(cpu.id);
+
+    // INIT-SIPI-SIPI sequence
+
+    lapic::send_init(cpu.apic_id);
+    busy_wait_us(10000);
+
+    for(size_t i = 0; i < 2 && !cpu.online; ++i){
+        lapic::send_startup(cpu.apic_id, TRAMPOLINE_ADDRESS / paging::PAGE_SIZE);
+        busy_wait_us(200);
+    }
+
+    for(size_t i = 0; i < AP_STARTUP_TIMEOUT_MS && !cpu.online; ++i){
+        busy_wait_us(1000);
+    }
+
+    if(!cpu.online){
+        logging::logf(logging::log_level::ERROR, "smp: Processor %u (APIC %u) did not start\n", cpu.id, size_t(cpu.apic_id));
+
+        delete[] cpu.stack;
+        cpu.stack = nullptr;
+
+        return false;
+    }
+
+    logging::logf(logging::log_level::TRACE, "smp: Processor %u (APIC %u) online\n", cpu.id, size_t(cpu.apic_id));
+
+    return true;
+}
+
+std::string sysfs_online(){
+    return std::to_string(online_count);
+}
+
+} //End of anonymous namespace
+
+extern "C" {
+
+void _ap_main(){
+    auto id = booting_cpu;
+
+    // Before anything needs the current processor
+    if(tsc_aux_cpu){
+        arch::write_msr(MSR_TSC_AUX, id);
+    }
+
+    arch::enable_sse();
+
+    gdt::init_ap(id);
+    interrupt::setup_ap(id);
+    lapic::init_ap();
+
+    auto& cpu = cpu_table[id];
+
+    lapic::start_timer(smp::LAPIC_TIMER_FREQUENCY, interrupt::IRQ_VECTOR_BASE + interrupt::IRQ_LAPIC_TIMER);
+
+    __sync_fetch_and_add(&online_count, 1);
+    cpu.online = true;
+
+    scheduler::start_ap();
+}
+
+} //end of extern "C"
+
+void smp::init(){
+    cpu_table[0].id = 0;
+    cpu_table[0].online = true;
+
+    if(rdtscp_supported()){
+        arch::write_msr(MSR_TSC_AUX, 0);
+        tsc_aux_cpu = true;
+    }
+
+    // The MADT needs ACPI
+    scheduler::queue_async_init_task(smp::late_install);
+}
+
+void smp::late_install(){
+    // The BSP must be known before the MADT is parsed
+    cpu_table[0].apic_id = bsp_apic_id();
+    apic_to_cpu[cpu_table[0].apic_id] = 0;
+
+    if(!parse_madt()){
+        logging::logf(logging::log_level::DEBUG, "smp: No MADT, running with a single processor\n");
+        return;
+    }
+
+    if(!lapic::install(lapic_address)){
+        return;
+    }
+
+    if(ioapic::install(cpu_table[0].apic_id)){
+        acpi_apic_mode();
+    }
+
+    lapic::calibrate_timer();
+
+    if(!interrupt::register_irq_handler(interrupt::IRQ_LAPIC_TIMER, local_timer_handler, nullptr)){
+        logging::logf(logging::log_level::ERROR, "smp: Unable to register local timer handler\n");
+        return;
+    }
+
+    std::copy(ap_trampoline_start, ap_trampoline_end, reinterpret_cast<char*>(TRAMPOLINE_ADDRESS));
+
+    for(size_t i = 1; i < cpus_count; ++i){
+        start_ap(cpu_table[i]);
+    }
+
+    for(size_t i = 1; i < cpus_count; ++i){
+        if(cpu_table[i].online){
+            work_queue::start_worker(i);
+        }
+    }
+
+    logging::logf(logging::log_level::TRACE, "smp: %u/%u processors online\n", size_t(online_count), cpus_count);
+
+    sysfs::set_constant_value(path("/sys"), path("/smp/cpus"), std::to_string(cpus_count));
+    sysfs::set_dynamic_value(path("/sys"), path("/smp/online"), &sysfs_online);
+
+    for(size_t i = 0; i < cpus_count; ++i){
+        auto p = path("/smp") / std::to_string(i);
+        sysfs::set_constant_value(path("/sys"), p / "apic_id", std::to_string(cpu_table[i].apic_id));
+    }
+}
+
+size_t smp::current_cpu(){
+    if(tsc_aux_cpu){
+        return arch::tsc_aux();
+    }
+
+    if(!lapic::enabled()){
+        return 0;
+    }
+
+    return apic_to_cpu[lapic::id()];
+}
+
+size_t smp::cpus(){
+    return cpus_count;
+}
+
+size_t smp::online_cpus(){
+    return online_count;
+}
+
+smp::cpu_t& smp::cpu(size_t id){
+    return ::cpu_table[id];
+}
@@ -0,0 +1,163 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <array.hpp>
+
+#include "syscall_stats.hpp"
+#include "scheduler.hpp"
+
+#include "fs/sysfs.hpp"
+
+namespace {
+
+constexpr const uint64_t EMPTY = ~uint64_t(0);
+
+struct entry_t {
+    volatile uint64_t code;
+    volatile uint64_t count;
+    volatile uint64_t cycles;
+    volatile uint32_t histogram[syscall_stats::BUCKETS];
+};
+
+/*!
+ * \brief Statistics indexed by system call number in an open-addressing
+ * table. The slots are claimed with a CAS the first time a number is seen.
+ */
+template<size_t Slots>
+struct table_t {
+    entry_t entries[Slots];
+
+    void clear(){
+        for(auto& entry : entries){
+            entry.code = EMPTY;
+            entry.count = 0;
+            entry.cycles = 0;
+
+            for(auto& bucket : entry.histogram){
+                bucket = 0;
+            }
+        }
+    }
+
+    entry_t* find(uint64_t code){
+        auto slot = (code * 2654435761UL) % Slots;
+
+        for(size_t i = 0; i < Slots; ++i){
+            auto& entry = entries[(slot + i) % Slots];
+
+            if(entry.code == code){
+                return &entry;
+            }
+
+            if(entry.code == EMPTY){
+                if(__sync_bool_compare_and_swap(&entry.code, EMPTY, code) || entry.code == code){
+                    return &entry;
+                }
+            }
+        }
+
+        // The table is full
+        return nullptr;
+    }
+
+    void record(uint64_t code, uint64_t cycles){
+        auto* entry = find(code);
+
+        if(!entry){
+            return;
+        }
+
+        size_t bucket = 63 - __builtin_clzll(cycles | 1);
+
+        if(bucket >= syscall_stats::BUCKETS){
+            bucket = syscall_stats::BUCKETS - 1;
+        }
+
+        __sync_fetch_and_add(&entry->count, 1);
+        __sync_fetch_and_add(&entry->cycles, cycles);
+        __sync_fetch_and_add(&entry->histogram[bucket], 1);
+    }
+
+    std::string to_string() const {
+        std::string value;
+
+        for(auto& entry : entries){
+            if(entry.code == EMPTY || !entry.count){
+                continue;
+            }
+
+            value += std::to_string(entry.code);
+            value += ' ';
+            value += std::to_string(entry.count);
+            value += ' ';
+            value += std::to_string(entry.cycles);
+
+            for(auto bucket : entry.histogram){
+                value += ' ';
+                value += std::to_string(bucket);
+            }
+
+            value += '\n';
+        }
+
+        return value;
+    }
+};
+
+// There are less than 128 system calls, a process uses much less of them
+typedef table_t<128> global_table_t;
+typedef table_t<32> process_table_t;
+
+global_table_t global_table;
+std::array<process_table_t*, scheduler::MAX_PROCESS> process_tables;
+
+std::string sysfs_statistics(){
+    return global_table.to_string();
+}
+
+} //end of anonymous namespace
+
+void syscall_stats::init(){
+    global_table.clear();
+
+    sysfs::set_dynamic_value(path("/sys"), path("/syscalls/stats"), &sysfs_statistics);
+}
+
+void syscall_stats::record(size_t pid, uint64_t code, uint64_t cycles){
+    global_table.record(code, cycles);
+
+    if(pid >= scheduler::MAX_PROCESS){
+        return;
+    }
+
+    // The table is only allocated by the process itself
+    if(!process_tables[pid]){
+        auto table = new process_table_t;
+        table->clear();
+        process_tables[pid] = table;
+    }
+
+    process_tables[pid]->record(code, cycles);
+}
+
+void syscall_stats::release(size_t pid){
+    auto table = process_tables[pid];
+
+    process_tables[pid] = nullptr;
+
+    delete table;
+}
+
+std::string syscall_stats::process_statistics(size_t pid){
+    auto table = process_tables[pid];
+
+    if(!table){
+        return "";
+    }
+
+    return table->to_string();
+}
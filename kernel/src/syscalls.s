@@ -49,3 +49,78 @@ syscall_common_handler:
     add rsp, 16
 
     iretq // iret will clean the other automatically pushed stuff
+
+// Entry point of the SYSCALL instruction. The user rip is in rcx and
+// the user rflags in r11, the second argument is passed in r10.
+// Interrupts are disabled by SFMASK until the kernel stack is set.
+// The frame has the same layout as the one of the int 50 path
+
+.global _syscall_fast
+_syscall_fast:
+    swapgs
+
+    // Switch to the kernel stack of the current process (TSS rsp0)
+    mov gs:[8], rsp
+    mov rsp, gs:[0]
+    mov rsp, [rsp + 4]
+
+    // Build an interrupt frame
+    push qword ptr gs:[16]
+    push qword ptr gs:[8]
+    push r11
+    push qword ptr gs:[24]
+
+    swapgs
+
+    push rcx
+    push rax
+    push 0
+
+    sti
+
+    push rbp
+    push r15
+    push r14
+    push r13
+    push r12
+    push r11
+    push r10
+    push r9
+    push r8
+    push rdi
+    push rsi
+    push rdx
+    push r10
+    push rbx
+    push rax
+
+    mov rdi, rsp
+    call _syscall_handler
+
+    cli
+
+    pop rax
+    pop rbx
+    add rsp, 8 // rcx holds the return address
+    pop rdx
+    pop rsi
+    pop rdi
+    pop r8
+    pop r9
+    pop r10
+    add rsp, 8 // r11 holds the flags
+    pop r12
+    pop r13
+    pop r14
+    pop r15
+    pop rbp
+
+    // Skip the code and the saved rax
+    add rsp, 16
+
+    pop rcx
+    add rsp, 8
+    pop r11
+    pop rsp
+
+    sysretq
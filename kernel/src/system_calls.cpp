@@ -20,6 +20,12 @@
 #include "ioctl.hpp"
 #include "net/network.hpp"
 #include "net/alpha.hpp"
+#include "io_ring.hpp"
+#include "futex.hpp"
+#include "logging.hpp"
+#include "arch.hpp"
+#include "trace.hpp"
+#include "syscall_stats.hpp"
 
 //TODO Split this file
 
@@ -124,14 +130,22 @@ void sc_await_termination(interrupt::syscall_regs* regs){
     scheduler::await_termination(pid);
 }
 
+void sc_create_thread(interrupt::syscall_regs* regs){
+    auto entry = regs->rbx;
+    auto arg0 = regs->rcx;
+    auto arg1 = regs->rdx;
+
+    regs->rax = expected_to_i64(scheduler::create_thread(entry, arg0, arg1));
+}
+
 void sc_brk_start(interrupt::syscall_regs* regs){
-    auto& process = scheduler::get_process(scheduler::get_pid());
+    auto& process = scheduler::get_leader();
 
     regs->rax = process.brk_start;
 }
 
 void sc_brk_end(interrupt::syscall_regs* regs){
-    auto& process = scheduler::get_process(scheduler::get_pid());
+    auto& process = scheduler::get_leader();
 
     regs->rax = process.brk_end;
 }
@@ -139,7 +153,7 @@ void sc_brk_end(interrupt::syscall_regs* regs){
 void sc_sbrk(interrupt::syscall_regs* regs){
     scheduler::sbrk(regs->rbx);
 
-    auto& process = scheduler::get_process(scheduler::get_pid());
+    auto& process = scheduler::get_leader();
     regs->rax = process.brk_end;
 }
 
@@ -267,7 +281,7 @@ void sc_mount(interrupt::syscall_regs* regs){
 }
 
 void sc_pwd(interrupt::syscall_regs* regs){
-    auto& wd = scheduler::get_working_directory();
+    auto wd = scheduler::get_working_directory();
     auto p = wd.string();
 
     auto buffer = reinterpret_cast<char*>(regs->rbx);
@@ -496,11 +510,34 @@ void sc_wait_for_packet_ms(interrupt::syscall_regs* regs){
     regs->rbx = reinterpret_cast<size_t>(user_buffer);
 }
 
-} //End of anonymous namespace
+void sc_io_ring_setup(interrupt::syscall_regs* regs){
+    auto address = regs->rbx;
 
-void system_call_entry(interrupt::syscall_regs* regs){
-    auto code = regs->rax;
+    regs->rax = expected_to_i64(io_ring::setup(address));
+}
+
+void sc_io_ring_enter(interrupt::syscall_regs* regs){
+    auto count = regs->rbx;
+
+    regs->rax = expected_to_i64(io_ring::enter(count));
+}
 
+void sc_futex_wait(interrupt::syscall_regs* regs){
+    auto address = regs->rbx;
+    auto expected = regs->rcx;
+    auto ms = regs->rdx;
+
+    regs->rax = expected_to_i64(futex::wait(address, expected, ms));
+}
+
+void sc_futex_wake(interrupt::syscall_regs* regs){
+    auto address = regs->rbx;
+    auto n = regs->rcx;
+
+    regs->rax = expected_to_i64(futex::wake(address, n));
+}
+
+void dispatch_system_call(interrupt::syscall_regs* regs, uint64_t code){
     switch(code){
         case 0:
             sc_print_char(regs);
@@ -538,6 +575,10 @@ void system_call_entry(interrupt::syscall_regs* regs){
             sc_sbrk(regs);
             break;
 
+        case 0xA:
+            sc_create_thread(regs);
+            break;
+
         case 0x10:
             sc_get_input(regs);
             break;
@@ -703,6 +744,14 @@ void system_call_entry(interrupt::syscall_regs* regs){
             sc_mouse_y(regs);
             break;
 
+        case 0x1200:
+            sc_futex_wait(regs);
+            break;
+
+        case 0x1201:
+            sc_futex_wake(regs);
+            break;
+
         // I/O system calls
 
         case 0x2000:
@@ -767,6 +816,16 @@ void system_call_entry(interrupt::syscall_regs* regs){
             sc_client_bind_port(regs);
             break;
 
+        // Submission ring system calls
+
+        case 0x4000:
+            sc_io_ring_setup(regs);
+            break;
+
+        case 0x4001:
+            sc_io_ring_enter(regs);
+            break;
+
         // Special system calls
 
         case 0x6666:
@@ -779,6 +838,22 @@ void system_call_entry(interrupt::syscall_regs* regs){
     }
 }
 
+} //End of anonymous namespace
+
+void system_call_entry(interrupt::syscall_regs* regs){
+    auto code = regs->rax;
+
+    trace::emit(trace::event::SYSCALL_ENTER, code, regs->rbx);
+
+    auto start = arch::rdtsc();
+
+    dispatch_system_call(regs, code);
+
+    syscall_stats::record(scheduler::get_pid(), code, arch::rdtsc() - start);
+
+    trace::emit(trace::event::SYSCALL_EXIT, code, regs->rax);
+}
+
 void install_system_calls(){
     if(!interrupt::register_syscall_handler(0, &system_call_entry)){
         logging::logf(logging::log_level::ERROR, "Unable to register syscall handler 0\n");
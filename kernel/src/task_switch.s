@@ -83,6 +83,9 @@ task_switch:
     pop rdi
     mov rsp, [rax]
 
+// The old context is saved, it can be run by another processor
+    call finish_task_switch
+
     restore_context
 
     //Was pushed by the base handler code
@@ -7,24 +7,50 @@
 
 #include "thor.hpp"
 #include "kalloc.hpp"
+#include "slab.hpp"
 #include "scheduler.hpp"
 #include "logging.hpp"
 #include "console.hpp"
 
-void* operator new(uint64_t size){
+namespace {
+
+// The small allocations are served by the object caches
+void* allocate(uint64_t size){
+    if(size <= slab::MAX_SIZE && slab::initialized()){
+        auto block = slab::allocate(size);
+
+        if(block){
+            return block;
+        }
+    }
+
     return kalloc::k_malloc(size);
 }
 
+void release(void* p){
+    if(slab::is_slab(p)){
+        slab::free(p);
+    } else {
+        kalloc::k_free(p);
+    }
+}
+
+} //end of anonymous namespace
+
+void* operator new(uint64_t size){
+    return allocate(size);
+}
+
 void operator delete(void* p){
-    kalloc::k_free(p);
+    release(p);
 }
 
 void* operator new[](uint64_t size){
-    return kalloc::k_malloc(size);
+    return allocate(size);
 }
 
 void operator delete[](void* p){
-    return kalloc::k_free(p);
+    release(p);
 }
 
 extern "C" {
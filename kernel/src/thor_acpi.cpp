@@ -167,7 +167,7 @@ void AcpiOsSleep(UINT64 ms){
  */
 void AcpiOsStall(UINT32 us){
     uint64_t c = timer::counter();
-    uint64_t wait = us * (timer::counter_frequency() / double(1000000));
+    uint64_t wait = us * timer::counter_frequency() / 1000000;
     wait = !wait ? 1 : wait;
 
     while(timer::counter() != c + wait){
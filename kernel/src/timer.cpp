@@ -5,10 +5,16 @@
 //  http://www.opensource.org/licenses/MIT)
 //=======================================================================
 
+#include <tlib/time_page.hpp>
+
 #include "timer.hpp"
 #include "scheduler.hpp"
 #include "logging.hpp"
 #include "kernel.hpp"   //suspend_boot
+#include "arch.hpp"
+#include "mmap.hpp"
+#include "physical_allocator.hpp"
+#include "paging.hpp"
 
 #include "drivers/pit.hpp"
 #include "drivers/hpet.hpp"
@@ -25,6 +31,178 @@ uint64_t _timer_frequency = 0;
 uint64_t (*_counter_fun)() = nullptr;
 uint64_t _counter_frequency = 0;
 
+void (*_oneshot_fun)(uint64_t) = nullptr;
+volatile bool _tickless = false;
+uint64_t _tickless_start = 0;
+uint64_t _tickless_carry = 0; ///< The part of a tick not accounted by the last restart_tick()
+
+// The page shared with the processes
+size_t _time_page_physical = 0;
+timer::time_page* _time_page = nullptr;
+
+constexpr const uint64_t CALIBRATION_MS = 20; ///< The duration of the TSC calibration at boot
+
+// The first sample of the TSC calibration
+uint64_t _calibration_counter = 0;
+uint64_t _calibration_tsc = 0;
+
+// The TSC clocksource, only used with an invariant TSC
+bool _invariant_tsc = false;
+volatile bool _tsc_clocksource = false;
+uint64_t _tsc_mult = 0;
+uint64_t _tsc_base = 0;
+uint64_t _ns_base = 0;
+
+bool invariant_tsc(){
+    uint32_t eax, ebx, ecx, edx;
+
+    arch::cpuid(0x80000000, eax, ebx, ecx, edx);
+
+    if(eax < 0x80000007){
+        return false;
+    }
+
+    arch::cpuid(0x80000007, eax, ebx, ecx, edx);
+
+    return edx & (1 << 8);
+}
+
+uint64_t tsc_nanoseconds(uint64_t tsc){
+    return _ns_base + ((__extension__ static_cast<unsigned __int128>(tsc - _tsc_base) * _tsc_mult) >> 32);
+}
+
+uint64_t counter_nanoseconds(){
+    auto counter = timer::counter();
+
+    // Split to avoid the overflow of counter * 10^9
+    auto seconds = counter / _counter_frequency;
+    auto remainder = counter % _counter_frequency;
+
+    return seconds * 1000000000 + (remainder * 1000000000) / _counter_frequency;
+}
+
+// Only an invariant TSC runs at a constant rate in all power states
+void enable_tsc_clocksource(uint64_t tsc_frequency){
+    if(!_invariant_tsc || _tsc_clocksource){
+        return;
+    }
+
+    // Continue from the time of the counter
+    _ns_base = counter_nanoseconds();
+    _tsc_base = arch::rdtsc();
+    _tsc_mult = (uint64_t(1000000000) << 32) / tsc_frequency;
+
+    asm volatile("" : : : "memory");
+
+    _tsc_clocksource = true;
+
+    logging::logf(logging::log_level::TRACE, "timer: TSC clocksource enabled\n");
+}
+
+// Only the bootstrap processor updates the time page
+void update_time_page(){
+    if(!_time_page || !_counter_fun || !_counter_frequency){
+        return;
+    }
+
+    auto counter = timer::counter();
+    auto tsc = arch::rdtsc();
+
+    uint64_t tsc_frequency = _time_page->tsc_frequency;
+
+    // Calibrate the TSC against the counter over at least 100ms
+    if(!tsc_frequency){
+        if(!_calibration_tsc){
+            _calibration_counter = counter;
+            _calibration_tsc = tsc;
+        } else if(counter - _calibration_counter >= _counter_frequency / 10){
+            tsc_frequency = ((tsc - _calibration_tsc) * _counter_frequency) / (counter - _calibration_counter);
+
+            logging::logf(logging::log_level::TRACE, "timer: TSC frequency %uHz\n", tsc_frequency);
+
+            enable_tsc_clocksource(tsc_frequency);
+        }
+    }
+
+    ++_time_page->sequence;
+    asm volatile("" : : : "memory");
+
+    _time_page->ticks = _timer_ticks;
+    _time_page->timer_frequency = _timer_frequency;
+    _time_page->counter_frequency = _counter_frequency;
+    _time_page->milliseconds = counter / (_counter_frequency / 1000);
+    _time_page->tsc = tsc;
+    _time_page->tsc_frequency = tsc_frequency;
+    _time_page->tsc_mult = _tsc_clocksource ? _tsc_mult : 0;
+    _time_page->tsc_base = _tsc_base;
+    _time_page->ns_base = _ns_base;
+
+    asm volatile("" : : : "memory");
+    ++_time_page->sequence;
+}
+
+void install_time_page(){
+    _time_page_physical = physical_allocator::allocate(1);
+
+    if(!_time_page_physical){
+        logging::logf(logging::log_level::ERROR, "timer: Unable to allocate the time page\n");
+        return;
+    }
+
+    _time_page = static_cast<timer::time_page*>(mmap_phys(_time_page_physical, paging::PAGE_SIZE));
+
+    std::fill_n(reinterpret_cast<char*>(_time_page), paging::PAGE_SIZE, 0);
+}
+
+// Calibrate the TSC against a high resolution counter (HPET), by busy waiting
+void calibrate_tsc(){
+    _invariant_tsc = invariant_tsc();
+
+    if(!_invariant_tsc){
+        logging::logf(logging::log_level::DEBUG, "timer: The TSC is not invariant\n");
+        return;
+    }
+
+    // The PIT counter only advances with the ticks, the TSC is calibrated on the ticks later
+    if(!_time_page || _counter_frequency < 1000000){
+        return;
+    }
+
+    auto wait = (_counter_frequency * CALIBRATION_MS) / 1000;
+
+    // Wait for the beginning of a new counter period
+    auto start = timer::counter();
+    while(timer::counter() == start){
+        arch::pause();
+    }
+
+    start = timer::counter();
+    auto tsc_start = arch::rdtsc();
+
+    while(timer::counter() - start < wait){
+        arch::pause();
+    }
+
+    auto elapsed = timer::counter() - start;
+    auto tsc_elapsed = arch::rdtsc() - tsc_start;
+
+    auto tsc_frequency = (tsc_elapsed * _counter_frequency) / elapsed;
+
+    logging::logf(logging::log_level::TRACE, "timer: TSC frequency %uHz (calibrated at boot)\n", tsc_frequency);
+
+    enable_tsc_clocksource(tsc_frequency);
+
+    ++_time_page->sequence;
+    asm volatile("" : : : "memory");
+
+    _time_page->tsc_frequency = tsc_frequency;
+
+    asm volatile("" : : : "memory");
+    ++_time_page->sequence;
+
+    update_time_page();
+}
+
 //TODO The uptime in seconds with HPET is not correct
 std::string sysfs_uptime(){
     return std::to_string(timer::seconds());
@@ -55,9 +233,22 @@ void timer::install(){
     }
 
     sysfs::set_dynamic_value(path("/sys"), path("/uptime"), &sysfs_uptime);
+
+    install_time_page();
+
+    calibrate_tsc();
 }
 
 void timer::tick(){
+    // The skipped ticks are accounted when the tick is restarted
+    if(_tickless){
+        return;
+    }
+
+    ++_timer_ticks;
+
+    update_time_page();
+
     // Simply let the scheduler know about the tick
     scheduler::tick();
 }
@@ -70,6 +261,14 @@ uint64_t timer::milliseconds(){
     return counter() / (counter_frequency() / 1000);
 }
 
+uint64_t timer::nanoseconds(){
+    if(_tsc_clocksource){
+        return tsc_nanoseconds(arch::rdtsc());
+    }
+
+    return counter_nanoseconds();
+}
+
 uint64_t timer::timer_frequency(){
     return _timer_frequency;
 }
@@ -92,10 +291,80 @@ uint64_t timer::counter_frequency(){
     return _counter_frequency;
 }
 
+uint64_t timer::tsc_frequency(){
+    return _time_page ? _time_page->tsc_frequency : 0;
+}
+
 void timer::counter_frequency(uint64_t freq){
     _counter_frequency = freq;
 }
 
 void timer::counter_fun(uint64_t (*fun)()){
     _counter_fun = fun;
+
+    // Once used as clocksource, the TSC does not depend on the counter anymore
+    if(_tsc_clocksource){
+        return;
+    }
+
+    // The TSC must be calibrated against the new counter
+    _calibration_tsc = 0;
+
+    if(_time_page){
+        ++_time_page->sequence;
+        _time_page->tsc_frequency = 0;
+        ++_time_page->sequence;
+    }
+}
+
+void timer::oneshot_fun(void (*fun)(uint64_t ticks)){
+    _oneshot_fun = fun;
+}
+
+bool timer::stop_tick(uint64_t ticks){
+    if(!_oneshot_fun || !_timer_frequency){
+        return false;
+    }
+
+    _tickless_start = counter();
+    _tickless = true;
+
+    _oneshot_fun(ticks);
+
+    return true;
+}
+
+uint64_t timer::tickless_ticks(){
+    if(!_tickless){
+        return 0;
+    }
+
+    return (counter() - _tickless_start + _tickless_carry) / (_counter_frequency / _timer_frequency);
+}
+
+uint64_t timer::restart_tick(){
+    // Catch up from the counter, the remainder is accounted with the next stop
+    auto period = _counter_frequency / _timer_frequency;
+    auto elapsed = counter() - _tickless_start + _tickless_carry;
+    auto ticks = elapsed / period;
+
+    _tickless_carry = elapsed % period;
+
+    _tickless = false;
+
+    _oneshot_fun(1);
+
+    _timer_ticks += ticks;
+
+    update_time_page();
+
+    return ticks;
+}
+
+bool timer::tickless(){
+    return _tickless;
+}
+
+size_t timer::time_page_physical(){
+    return _time_page_physical;
 }
@@ -0,0 +1,109 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <array.hpp>
+
+#include "tlb.hpp"
+#include "arch.hpp"
+#include "smp.hpp"
+#include "paging.hpp"
+#include "interrupts.hpp"
+#include "logging.hpp"
+#include "drivers/lapic.hpp"
+
+namespace {
+
+// Above this number of pages, the whole TLB is flushed
+constexpr const size_t FULL_FLUSH_PAGES = 32;
+
+volatile size_t shootdown_lock = 0;
+
+// The range of the current shootdown
+volatile size_t shootdown_start;
+volatile size_t shootdown_pages;
+
+std::array<volatile bool, smp::MAX_CPUS> requested;
+
+void invalidate(size_t virt, size_t pages){
+    if(pages > FULL_FLUSH_PAGES){
+        asm volatile("mov rax, cr3; mov cr3, rax" : : : "rax", "memory");
+    } else {
+        for(size_t i = 0; i < pages; ++i){
+            asm volatile("invlpg [%0]" :: "r" (virt + i * paging::PAGE_SIZE) : "memory");
+        }
+    }
+}
+
+void shootdown_handler(interrupt::syscall_regs*, void*){
+    tlb::serve();
+}
+
+} //end of anonymous namespace
+
+volatile size_t tlb::pending = 0;
+
+void tlb::init(){
+    if(!interrupt::register_irq_handler(interrupt::IRQ_TLB_SHOOTDOWN, shootdown_handler, nullptr)){
+        logging::logf(logging::log_level::ERROR, "tlb: Unable to register the shootdown IPI handler\n");
+    }
+}
+
+void tlb::serve(){
+    auto cpu = smp::current_cpu();
+
+    if(__sync_bool_compare_and_swap(&requested[cpu], true, false)){
+        invalidate(shootdown_start, shootdown_pages);
+
+        __sync_fetch_and_sub(&pending, 1);
+    }
+}
+
+void tlb::shootdown(size_t virt, size_t pages){
+    if(smp::online_cpus() < 2 || !pages){
+        return;
+    }
+
+    // Stay on this processor until all the others are done
+    size_t rflags;
+    arch::disable_hwint(rflags);
+
+    // Another processor may wait for this one while holding the lock
+    while(!__sync_bool_compare_and_swap(&shootdown_lock, 0, 1)){
+        serve();
+        arch::pause();
+    }
+
+    shootdown_start = virt;
+    shootdown_pages = pages;
+
+    auto self = smp::current_cpu();
+
+    size_t targets = 0;
+    for(size_t cpu = 0; cpu < smp::cpus(); ++cpu){
+        if(cpu != self && smp::cpu(cpu).online){
+            requested[cpu] = true;
+            ++targets;
+        }
+    }
+
+    __sync_fetch_and_add(&pending, targets);
+
+    for(size_t cpu = 0; cpu < smp::cpus(); ++cpu){
+        if(requested[cpu]){
+            lapic::send_ipi(smp::cpu(cpu).apic_id, interrupt::TLB_SHOOTDOWN_VECTOR);
+        }
+    }
+
+    while(pending){
+        arch::pause();
+    }
+
+    __sync_synchronize();
+    shootdown_lock = 0;
+
+    arch::enable_hwint(rflags);
+}
@@ -0,0 +1,65 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include "trace.hpp"
+#include "cpu_ring_device.hpp"
+#include "scheduler.hpp"
+#include "smp.hpp"
+#include "arch.hpp"
+#include "logging.hpp"
+
+#include "fs/sysfs.hpp"
+
+volatile uint64_t trace::enabled_events = 0;
+
+namespace {
+
+cpu_ring_device<trace::record, 2048> device;
+
+// Disable the tracepoints before emptying the rings
+void stop(){
+    trace::enabled_events = 0;
+}
+
+void start(size_t mask){
+    trace::enabled_events = mask & trace::all_events;
+
+    logging::logf(logging::log_level::DEBUG, "trace: enabled events %h\n", trace::enabled_events);
+}
+
+std::string sysfs_events(){
+    return std::to_string(trace::enabled_events);
+}
+
+std::string sysfs_dropped(){
+    return std::to_string(device.dropped_records());
+}
+
+} //end of anonymous namespace
+
+void trace::init(){
+    device.init("trace", &stop, &start);
+
+    sysfs::set_dynamic_value(path("/sys"), path("/trace/events"), &sysfs_events);
+    sysfs::set_dynamic_value(path("/sys"), path("/trace/dropped"), &sysfs_dropped);
+}
+
+void trace::record_event(event e, uint16_t flags, uint64_t arg0, uint64_t arg1){
+    auto cpu = smp::current_cpu();
+
+    trace::record r;
+    r.tsc = arch::rdtsc();
+    r.event = static_cast<uint16_t>(e);
+    r.cpu = cpu;
+    r.pid = scheduler::is_started() ? scheduler::get_pid() : 0;
+    r.flags = flags;
+    r.arg0 = arg0;
+    r.arg1 = arg1;
+
+    // Events emitted before the initialization are lost
+    device.push(cpu, r);
+}
@@ -67,7 +67,7 @@ bool vesa::init(){
         return false;
     }
 
-    if(!paging::map_pages(virt, physical, pages)){
+    if(!paging::map_large_pages(virt, physical, pages)){
         return false;
     }
 
@@ -177,8 +177,8 @@ std::expected<void> vfs::mount(partition_type type, fd_t mp_fd, fd_t dev_fd) {
         return std::make_unexpected<void>(std::ERROR_INVALID_FILE_DESCRIPTOR);
     }
 
-    auto& mp_path  = scheduler::get_handle(mp_fd);
-    auto& dev_path = scheduler::get_handle(dev_fd);
+    auto mp_path  = scheduler::get_handle(mp_fd);
+    auto dev_path = scheduler::get_handle(dev_fd);
 
     for (auto& m : mount_point_list) {
         if (m.mount_point == mp_path) {
@@ -314,7 +314,7 @@ std::expected<void> vfs::stat(fd_t fd, vfs::stat_info& info) {
         return std::make_unexpected<void>(std::ERROR_INVALID_FILE_DESCRIPTOR);
     }
 
-    auto& base_path = scheduler::get_handle(fd);
+    auto base_path = scheduler::get_handle(fd);
     auto& fs        = get_fs(base_path);
     auto fs_path    = get_fs_path(base_path, fs);
 
@@ -366,7 +366,7 @@ std::expected<size_t> vfs::read(fd_t fd, char* buffer, size_t count, size_t offs
         return std::make_unexpected<size_t>(std::ERROR_INVALID_FILE_DESCRIPTOR);
     }
 
-    auto& base_path = scheduler::get_handle(fd);
+    auto base_path = scheduler::get_handle(fd);
 
     if (base_path.is_root()) {
         return std::make_unexpected<size_t>(std::ERROR_INVALID_FILE_PATH);
@@ -404,7 +404,7 @@ std::expected<size_t> vfs::write(fd_t fd, const char* buffer, size_t count, size
         return std::make_unexpected<size_t>(std::ERROR_INVALID_FILE_DESCRIPTOR);
     }
 
-    auto& base_path = scheduler::get_handle(fd);
+    auto base_path = scheduler::get_handle(fd);
 
     if (base_path.is_root()) {
         return std::make_unexpected<size_t>(std::ERROR_INVALID_FILE_PATH);
@@ -428,7 +428,7 @@ std::expected<size_t> vfs::clear(fd_t fd, size_t count, size_t offset) {
         return std::make_unexpected<size_t>(std::ERROR_INVALID_FILE_DESCRIPTOR);
     }
 
-    auto& base_path = scheduler::get_handle(fd);
+    auto base_path = scheduler::get_handle(fd);
 
     if (base_path.is_root()) {
         return std::make_unexpected<size_t>(std::ERROR_INVALID_FILE_PATH);
@@ -466,7 +466,7 @@ std::expected<void> vfs::truncate(fd_t fd, size_t size) {
         return std::make_unexpected<void>(std::ERROR_INVALID_FILE_DESCRIPTOR);
     }
 
-    auto& base_path = scheduler::get_handle(fd);
+    auto base_path = scheduler::get_handle(fd);
 
     if (base_path.is_root()) {
         return std::make_unexpected<void>(std::ERROR_INVALID_FILE_PATH);
@@ -514,7 +514,7 @@ std::expected<size_t> vfs::entries(fd_t fd, char* buffer, size_t size) {
         return std::make_unexpected<size_t>(std::ERROR_INVALID_FILE_DESCRIPTOR);
     }
 
-    auto& base_path = scheduler::get_handle(fd);
+    auto base_path = scheduler::get_handle(fd);
     auto& fs        = get_fs(base_path);
     auto fs_path    = get_fs_path(base_path, fs);
 
@@ -6,6 +6,7 @@
 //=======================================================================
 
 #include <array.hpp>
+#include <lock_guard.hpp>
 
 #include "virtual_allocator.hpp"
 #include "paging.hpp"
@@ -13,6 +14,8 @@
 #include "assert.hpp"
 #include "logging.hpp"
 
+#include "conc/int_spinlock.hpp"
+
 #include "fs/sysfs.hpp"
 
 //For problems during boot
@@ -34,18 +37,20 @@ constexpr size_t array_size(int block){
     return (virtual_allocator::kernel_virtual_size / (block * unit) + 1) / (sizeof(uint64_t) * 8) + 1;
 }
 
-std::array<uint64_t, array_size(1)> data_bitmap_1;
-std::array<uint64_t, array_size(2)> data_bitmap_2;
-std::array<uint64_t, array_size(4)> data_bitmap_4;
-std::array<uint64_t, array_size(8)> data_bitmap_8;
-std::array<uint64_t, array_size(16)> data_bitmap_16;
-std::array<uint64_t, array_size(32)> data_bitmap_32;
-std::array<uint64_t, array_size(64)> data_bitmap_64;
-std::array<uint64_t, array_size(128)> data_bitmap_128;
+std::array<uint64_t, static_bitmap::storage_words(array_size(1))> data_bitmap_1;
+std::array<uint64_t, static_bitmap::storage_words(array_size(2))> data_bitmap_2;
+std::array<uint64_t, static_bitmap::storage_words(array_size(4))> data_bitmap_4;
+std::array<uint64_t, static_bitmap::storage_words(array_size(8))> data_bitmap_8;
+std::array<uint64_t, static_bitmap::storage_words(array_size(16))> data_bitmap_16;
+std::array<uint64_t, static_bitmap::storage_words(array_size(32))> data_bitmap_32;
+std::array<uint64_t, static_bitmap::storage_words(array_size(64))> data_bitmap_64;
+std::array<uint64_t, static_bitmap::storage_words(array_size(128))> data_bitmap_128;
 
 typedef buddy_allocator<8, unit> buddy_type;
 buddy_type allocator;
 
+int_spinlock allocator_lock;
+
 std::string sysfs_free(){
     return std::to_string(virtual_allocator::free());
 }
@@ -64,8 +69,8 @@ void virtual_allocator::init(){
     // The first addressable virtual address is just after the paging structures
     virtual_start = paging::virtual_paging_start + (paging::physical_memory_pages * paging::PAGE_SIZE);
 
-    // Take the next first aligned 1MiB virtual address
-    first_virtual_address = virtual_start % 0x100000 == 0 ? virtual_start : (virtual_start / 0x100000 + 1) * 0x100000;
+    // Take the next first aligned large page virtual address, so that large blocks can be mapped with large pages
+    first_virtual_address = paging::large_page_aligned(virtual_start) ? virtual_start : (virtual_start / paging::LARGE_PAGE_SIZE + 1) * paging::LARGE_PAGE_SIZE;
     last_virtual_address = virtual_allocator::kernel_virtual_size;
     managed_space = last_virtual_address - first_virtual_address;
 
@@ -93,9 +98,17 @@ void virtual_allocator::finalize(){
 size_t virtual_allocator::allocate(size_t pages){
     thor_assert(pages < free() / paging::PAGE_SIZE, "Not enough virtual memory");
 
-    allocated_pages += buddy_type::level_size(pages);
+    size_t virt;
+
+    {
+        std::lock_guard<int_spinlock> l(allocator_lock);
 
-    auto virt = allocator.allocate(pages);
+        virt = allocator.allocate(pages);
+
+        if(virt){
+            allocated_pages += buddy_type::allocated_units(pages);
+        }
+    }
 
     if(!virt){
         logging::logf(logging::log_level::ERROR, "valloc: Unable to allocate %u pages\n", size_t(pages));
@@ -105,7 +118,9 @@ size_t virtual_allocator::allocate(size_t pages){
 }
 
 void virtual_allocator::free(size_t address, size_t pages){
-    allocated_pages -= buddy_type::level_size(pages);
+    std::lock_guard<int_spinlock> l(allocator_lock);
+
+    allocated_pages -= buddy_type::allocated_units(pages);
 
     allocator.free(address, pages);
 }
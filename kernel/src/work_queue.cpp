@@ -0,0 +1,141 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <array.hpp>
+#include <string.hpp>
+#include <circular_buffer.hpp>
+
+#include "conc/int_spinlock.hpp"
+
+#include "work_queue.hpp"
+#include "scheduler.hpp"
+#include "logging.hpp"
+#include "smp.hpp"
+
+namespace {
+
+struct work_t {
+    work_queue::work_function fun;
+    void* data;
+
+    work_t(){}
+    work_t(work_queue::work_function fun, void* data) : fun(fun), data(data) {}
+};
+
+struct worker_t {
+    int_spinlock lock;                   ///< Lock protecting the queue
+    circular_buffer<work_t, 128> queue;  ///< The pending work
+    scheduler::pid_t pid;                ///< The pid of the worker task
+    volatile bool waiting;               ///< Indicates if the worker task is blocked on an empty queue
+};
+
+std::array<worker_t, smp::MAX_CPUS> workers;
+
+void worker_task(void* data){
+    auto& worker = *reinterpret_cast<worker_t*>(data);
+
+    logging::logf(logging::log_level::TRACE, "work_queue: Worker started (pid:%u)\n", worker.pid);
+
+    while(true){
+        worker.lock.lock();
+
+        if(worker.queue.empty()){
+            worker.waiting = true;
+
+            scheduler::block_process_light(worker.pid);
+            worker.lock.unlock();
+            scheduler::reschedule();
+
+            continue;
+        }
+
+        auto work = worker.queue.pop();
+
+        worker.lock.unlock();
+
+        work.fun(work.data);
+    }
+}
+
+bool post_work(work_queue::work_function fun, void* data, bool irq){
+    auto cpu = smp::current_cpu();
+
+    if(workers[cpu].pid == scheduler::INVALID_PID){
+        cpu = 0;
+    }
+
+    auto& worker = workers[cpu];
+
+    bool wake = false;
+
+    worker.lock.lock();
+
+    if(!worker.queue.emplace_push(fun, data)){
+        worker.lock.unlock();
+
+        logging::logf(logging::log_level::ERROR, "work_queue: Queue full, work dropped\n");
+
+        return false;
+    }
+
+    if(worker.waiting){
+        worker.waiting = false;
+        wake = true;
+    }
+
+    worker.lock.unlock();
+
+    if(wake){
+        if(irq){
+            scheduler::unblock_process_hint(worker.pid);
+        } else {
+            scheduler::unblock_process(worker.pid);
+        }
+    }
+
+    return true;
+}
+
+} //end of anonymous namespace
+
+void work_queue::init(){
+    for(auto& worker : workers){
+        worker.pid = scheduler::INVALID_PID;
+        worker.waiting = false;
+    }
+}
+
+void work_queue::finalize(){
+    start_worker(0);
+}
+
+void work_queue::start_worker(size_t cpu){
+    auto& worker = workers[cpu];
+
+    auto* user_stack = new char[scheduler::user_stack_size];
+    auto* kernel_stack = new char[scheduler::kernel_stack_size];
+
+    auto name = "kworker_" + std::to_string(cpu);
+
+    auto& process = scheduler::create_kernel_task_args(name.c_str(), user_stack, kernel_stack, &worker_task, &worker);
+
+    process.ppid = 1;
+    process.priority = scheduler::MAX_PRIORITY;
+
+    // From now on, the work posted on this processor goes to its own worker
+    worker.pid = process.pid;
+
+    scheduler::queue_system_process(process.pid, cpu);
+}
+
+bool work_queue::post(work_function fun, void* data){
+    return post_work(fun, data, false);
+}
+
+bool work_queue::irq_post(work_function fun, void* data){
+    return post_work(fun, data, true);
+}
@@ -7,88 +7,101 @@
 
 #include <tlib/print.hpp>
 #include <tlib/system.hpp>
+#include <tlib/syscall.hpp>
 
 constexpr const size_t PAGES = 512;
+constexpr const size_t SYSCALLS = 100000;
 
 namespace {
 
-size_t repeat = 1;
+// Print a duration given in nanoseconds in the most readable unit
+void print_duration(uint64_t duration){
+    if(duration < 10000){
+        tlib::printf("%uns", duration);
+    } else if(duration < 10000000){
+        tlib::printf("%uus", duration / 1000);
+    } else {
+        tlib::printf("%ums", duration / 1000000);
+    }
+}
 
-bool display_result(const char* name, uint64_t duration){
+void display_result(const char* name, uint64_t duration){
+    // Without a TSC clocksource, the resolution is only a millisecond
     if(!duration){
-        repeat *= 2;
-        tlib::printf("%s was too fast (duration=0) increasing repeat to %u\n", name, repeat);
-        return false;
+        tlib::printf("%s was too fast to be measured\n", name);
+        return;
     }
 
-    uint64_t throughput = 1000 * ((repeat * PAGES * 4096) / duration);
+    uint64_t throughput = (1000000000 / 1024) * (PAGES * 4096) / duration;
+
+    tlib::printf("%s: ", name);
+    print_duration(duration);
 
     if(throughput > (1024 * 1024)){
-        tlib::printf("%s: %ums bandwith: %uMiB/s\n", name, duration, throughput / (1024 * 1024));
+        tlib::printf(" bandwith: %uGiB/s\n", throughput / (1024 * 1024));
     } else if(throughput > 1024){
-        tlib::printf("%s: %ums bandwith: %uKiB/s\n", name, duration, throughput / 1024);
+        tlib::printf(" bandwith: %uMiB/s\n", throughput / 1024);
     } else {
-        tlib::printf("%s: %ums bandwith: %uB/s\n", name, duration, throughput);
+        tlib::printf(" bandwith: %uKiB/s\n", throughput);
     }
-
-    return true;
 }
 
-} // end of anonymous namespace
-
-int main(){
-    char* buffer_one = new char[PAGES * 4096];
-    char* buffer_two = new char[PAGES * 4096];
-
-    tlib::printf("Start benchmark...\n");
-
-    uint64_t start = 0, end = 0;
-
-    while(repeat < 100){
-        start = tlib::ms_time();
+// brk_start is one of the cheapest system calls
+uint64_t syscall_fast(){
+    uint64_t value;
+    asm volatile("mov rax, 7; " TLIB_SYSCALL "; mov %[value], rax"
+        : [value] "=m" (value)
+        : //No inputs
+        : "rax", TLIB_SYSCALL_CLOBBERS);
+    return value;
+}
 
-        for(size_t i = 0; i < repeat; ++i){
-            std::copy_n(buffer_two, PAGES * 4096, buffer_one);
-        }
+uint64_t syscall_int(){
+    uint64_t value;
+    asm volatile("mov rax, 7; int 50; mov %[value], rax"
+        : [value] "=m" (value)
+        : //No inputs
+        : "rax");
+    return value;
+}
 
-        end = tlib::ms_time();
+template<typename F>
+void bench_syscall(const char* name, F fun){
+    auto start = tlib::ns_time();
 
-        if(display_result("copy", end - start)){
-            break;
-        }
+    for(size_t i = 0; i < SYSCALLS; ++i){
+        fun();
     }
 
-    repeat = 1;
+    auto duration = tlib::ns_time() - start;
 
-    while(repeat < 100){
-        start = tlib::ms_time();
-
-        for(size_t i = 0; i < repeat; ++i){
-            std::fill_n(buffer_two, PAGES * 4096, 'Z');
-        }
+    tlib::printf("%s: ", name);
+    print_duration(duration);
+    tlib::printf(" %uns/call\n", duration / SYSCALLS);
+}
 
-        end = tlib::ms_time();
+} // end of anonymous namespace
 
-        if(display_result("fill", end - start)){
-            break;
-        }
-    }
+int main(){
+    char* buffer_one = new char[PAGES * 4096];
+    char* buffer_two = new char[PAGES * 4096];
 
-    repeat = 1;
+    tlib::printf("Start benchmark...\n");
 
-    while(repeat < 100){
-        start = tlib::ms_time();
+    auto start = tlib::ns_time();
+    std::copy_n(buffer_two, PAGES * 4096, buffer_one);
+    display_result("copy", tlib::ns_time() - start);
 
-        for(size_t i = 0; i < repeat; ++i){
-            std::fill_n(buffer_two, PAGES * 4096, 0);
-        }
+    start = tlib::ns_time();
+    std::fill_n(buffer_two, PAGES * 4096, 'Z');
+    display_result("fill", tlib::ns_time() - start);
 
-        end = tlib::ms_time();
+    start = tlib::ns_time();
+    std::fill_n(buffer_two, PAGES * 4096, 0);
+    display_result("clear", tlib::ns_time() - start);
 
-        if(display_result("clear", end - start)){
-            break;
-        }
-    }
+    bench_syscall("syscall (int 50)", &syscall_int);
+    bench_syscall("syscall (SYSCALL)", &syscall_fast);
 
     return 0;
 }
@@ -9,6 +9,7 @@
 #include <tlib/system.hpp>
 #include <tlib/errors.hpp>
 #include <tlib/print.hpp>
+#include <tlib/io_ring.hpp>
 
 int main(int argc, char* argv[]){
     if(argc == 1){
@@ -35,10 +36,20 @@ int main(int argc, char* argv[]){
                     if(*content_result != size){
                         //TODO Read more
                     } else {
+                        // Batch the characters to enter the kernel once per ring
+                        tlib::io_ring ring;
+
                         for(size_t i = 0; i < size; ++i){
-                            tlib::print(buffer[i]);
+                            if(!ring.valid()){
+                                tlib::print(buffer[i]);
+                            } else if(!ring.print(buffer[i])){
+                                ring.flush();
+                                ring.print(buffer[i]);
+                            }
                         }
 
+                        ring.flush();
+
                         tlib::print_line();
                     }
                 } else {
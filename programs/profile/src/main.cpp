@@ -0,0 +1,305 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <vector.hpp>
+#include <string.hpp>
+
+#include <tlib/file.hpp>
+#include <tlib/system.hpp>
+#include <tlib/errors.hpp>
+#include <tlib/print.hpp>
+#include <tlib/elf.hpp>
+#include <tlib/profiler.hpp>
+
+namespace {
+
+static constexpr const char* KERNEL_PATH = "/kernel.elf";
+static constexpr const size_t DEFAULT_DURATION = 5;
+static constexpr const size_t POLL_INTERVAL = 100;
+static constexpr const size_t MAX_FUNCTIONS = 25;
+static constexpr const size_t BATCH = 64;
+
+struct function {
+    uint64_t address;
+    uint64_t size;
+    const char* name;
+};
+
+struct counter {
+    std::string name;
+    size_t count;
+};
+
+std::vector<tlib::sample> samples;
+std::vector<function> functions;
+
+template<typename T, typename Less>
+void shell_sort(std::vector<T>& values, Less less){
+    for(size_t gap = values.size() / 2; gap > 0; gap /= 2){
+        for(size_t i = gap; i < values.size(); ++i){
+            for(size_t j = i; j >= gap && less(values[j], values[j - gap]); j -= gap){
+                std::swap(values[j], values[j - gap]);
+            }
+        }
+    }
+}
+
+bool set_period(size_t fd, size_t period){
+    auto value = std::to_string(period);
+    auto result = tlib::write(fd, value.c_str(), value.size());
+
+    if(!result.valid()){
+        tlib::printf("profile: error: %s\n", std::error_message(result.error()));
+        return false;
+    }
+
+    return true;
+}
+
+bool drain(size_t fd){
+    tlib::sample buffer[BATCH];
+
+    while(true){
+        auto result = tlib::read(fd, reinterpret_cast<char*>(buffer), sizeof(buffer));
+
+        if(!result.valid()){
+            tlib::printf("profile: error: %s\n", std::error_message(result.error()));
+            return false;
+        }
+
+        auto n = *result / sizeof(tlib::sample);
+
+        for(size_t i = 0; i < n; ++i){
+            samples.push_back(buffer[i]);
+        }
+
+        if(n < BATCH){
+            return true;
+        }
+    }
+}
+
+bool record(size_t duration, size_t period){
+    auto fd = tlib::open("/dev/profiler");
+
+    if(!fd.valid()){
+        tlib::printf("profile: error: %s\n", std::error_message(fd.error()));
+        return false;
+    }
+
+    bool success = set_period(*fd, period);
+
+    // Consume the samples regularly so that the kernel buffers do not overflow
+    for(size_t elapsed = 0; success && elapsed < duration * 1000; elapsed += POLL_INTERVAL){
+        tlib::sleep_ms(POLL_INTERVAL);
+
+        success = drain(*fd);
+    }
+
+    set_period(*fd, 0);
+
+    tlib::close(*fd);
+
+    return success;
+}
+
+char* load_kernel(){
+    auto fd = tlib::open(KERNEL_PATH);
+
+    if(!fd.valid()){
+        tlib::printf("profile: error: %s: %s\n", KERNEL_PATH, std::error_message(fd.error()));
+        return nullptr;
+    }
+
+    char* buffer = nullptr;
+
+    auto info = tlib::stat(*fd);
+
+    if(info.valid()){
+        buffer = new char[info->size];
+
+        auto content_result = tlib::read(*fd, buffer, info->size);
+
+        if(!content_result.valid() || *content_result != info->size || !elf::is_valid(buffer)){
+            tlib::printf("profile: error: %s is not a valid ELF file\n", KERNEL_PATH);
+
+            delete[] buffer;
+            buffer = nullptr;
+        }
+    } else {
+        tlib::printf("profile: error: %s\n", std::error_message(info.error()));
+    }
+
+    tlib::close(*fd);
+
+    return buffer;
+}
+
+void load_symbols(char* buffer){
+    auto header = reinterpret_cast<elf::elf_header*>(buffer);
+    auto section_header_table = reinterpret_cast<elf::section_header*>(buffer + header->e_shoff);
+
+    for(size_t s = 0; s < header->e_shnum; ++s){
+        auto& s_header = section_header_table[s];
+
+        if(s_header.sh_type != elf::SHT_SYMTAB){
+            continue;
+        }
+
+        auto string_table = buffer + section_header_table[s_header.sh_link].sh_offset;
+        auto symbols = reinterpret_cast<elf::symbol*>(buffer + s_header.sh_offset);
+
+        for(size_t i = 0; i < s_header.sh_size / sizeof(elf::symbol); ++i){
+            auto& symbol = symbols[i];
+
+            if((symbol.st_info & 0xF) == elf::STT_FUNC && symbol.st_value){
+                functions.push_back({symbol.st_value, symbol.st_size, string_table + symbol.st_name});
+            }
+        }
+    }
+
+    shell_sort(functions, [](const function& lhs, const function& rhs){ return lhs.address < rhs.address; });
+}
+
+const char* symbolize(uint64_t address){
+    size_t first = 0;
+    size_t last = functions.size();
+
+    // Find the last function starting before the address
+    while(first < last){
+        auto middle = (first + last) / 2;
+
+        if(functions[middle].address <= address){
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+
+    if(first == 0){
+        return "??";
+    }
+
+    auto& f = functions[first - 1];
+
+    if(f.size && address >= f.address + f.size){
+        return "??";
+    }
+
+    return f.name;
+}
+
+void count(std::vector<counter>& counters, const std::string& name){
+    for(auto& c : counters){
+        if(c.name == name){
+            ++c.count;
+            return;
+        }
+    }
+
+    counters.push_back({name, 1});
+}
+
+void sort_counters(std::vector<counter>& counters){
+    shell_sort(counters, [](const counter& lhs, const counter& rhs){ return lhs.count > rhs.count; });
+}
+
+void flat_profile(){
+    std::vector<counter> counters;
+
+    for(auto& sample : samples){
+        count(counters, sample.user ? "[user]" : symbolize(sample.rip));
+    }
+
+    sort_counters(counters);
+
+    tlib::printf("Flat profile (%u samples)\n", samples.size());
+    tlib::print_line("Samples  Permille Function");
+
+    for(size_t i = 0; i < counters.size() && i < MAX_FUNCTIONS; ++i){
+        auto& c = counters[i];
+        tlib::printf("%7u %9u %s\n", c.count, (c.count * 1000) / samples.size(), c.name.c_str());
+    }
+}
+
+void folded_stacks(){
+    std::vector<counter> counters;
+
+    for(auto& sample : samples){
+        if(sample.user){
+            count(counters, "[user]");
+            continue;
+        }
+
+        // Outermost caller first
+        std::string stack;
+
+        for(size_t i = tlib::stack_depth; i > 0; --i){
+            if(sample.stack[i - 1]){
+                stack += symbolize(sample.stack[i - 1]);
+                stack += ';';
+            }
+        }
+
+        stack += symbolize(sample.rip);
+
+        count(counters, stack);
+    }
+
+    sort_counters(counters);
+
+    tlib::print_line("Folded stacks");
+
+    for(auto& c : counters){
+        tlib::printf("%s %u\n", c.name.c_str(), c.count);
+    }
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* argv[]){
+    size_t duration = DEFAULT_DURATION;
+    size_t period = 1;
+
+    if(argc > 1){
+        duration = std::parse(argv[1]);
+    }
+
+    if(argc > 2){
+        period = std::parse(argv[2]);
+    }
+
+    if(!duration || !period){
+        tlib::print_line("Usage: profile [seconds] [period_ticks]");
+        return 1;
+    }
+
+    auto buffer = load_kernel();
+
+    if(!buffer){
+        return 1;
+    }
+
+    load_symbols(buffer);
+
+    if(!record(duration, period)){
+        delete[] buffer;
+        return 1;
+    }
+
+    if(samples.empty()){
+        tlib::print_line("profile: no samples");
+    } else {
+        flat_profile();
+        tlib::print_line();
+        folded_stacks();
+    }
+
+    delete[] buffer;
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <vector.hpp>
+#include <string.hpp>
+
+#include <tlib/file.hpp>
+#include <tlib/system.hpp>
+#include <tlib/errors.hpp>
+#include <tlib/print.hpp>
+#include <tlib/time_page.hpp>
+
+namespace {
+
+static constexpr const size_t BUCKETS = 32;
+
+struct statistics {
+    uint64_t code;
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t histogram[BUCKETS];
+};
+
+struct syscall_name {
+    uint64_t code;
+    const char* name;
+};
+
+const syscall_name names[] = {
+    {0, "print_char"}, {1, "print_string"}, {2, "log_string"}, {4, "sleep_ms"},
+    {5, "exec"}, {6, "await_termination"}, {7, "brk_start"}, {8, "brk_end"},
+    {9, "sbrk"}, {0xA, "create_thread"},
+    {0x10, "get_input"}, {0x11, "get_input_timeout"}, {0x12, "get_input_raw"},
+    {0x13, "get_input_raw_timeout"}, {0x20, "set_canonical"}, {0x21, "set_mouse"},
+    {100, "clear_screen"}, {101, "get_columns"}, {102, "get_rows"},
+    {201, "reboot"}, {202, "shutdown"},
+    {300, "open"}, {301, "stat"}, {302, "close"}, {303, "read"}, {304, "pwd"},
+    {305, "cwd"}, {306, "mkdir"}, {307, "rm"}, {308, "entries"}, {309, "mounts"},
+    {310, "statfs"}, {311, "write"}, {312, "truncate"}, {313, "clear"}, {314, "mount"},
+    {0x400, "datetime"}, {0x401, "time_seconds"}, {0x402, "time_milliseconds"},
+    {0x666, "exit"},
+    {0x1000, "vesa_width"}, {0x1001, "vesa_height"}, {0x1002, "vesa_shift_x"},
+    {0x1003, "vesa_shift_y"}, {0x1004, "vesa_bpsl"}, {0x1005, "vesa_red_shift"},
+    {0x1006, "vesa_green_shift"}, {0x1007, "vesa_blue_shift"}, {0x1008, "vesa_redraw"},
+    {0x1100, "mouse_x"}, {0x1101, "mouse_y"},
+    {0x1200, "futex_wait"}, {0x1201, "futex_wake"},
+    {0x2000, "ioctl"},
+    {0x3000, "socket_open"}, {0x3001, "socket_close"}, {0x3002, "prepare_packet"},
+    {0x3003, "finalize_packet"}, {0x3004, "listen"}, {0x3005, "wait_for_packet"},
+    {0x3006, "wait_for_packet_ms"}, {0x3007, "client_bind"}, {0x3008, "connect"},
+    {0x3009, "disconnect"}, {0x300A, "client_unbind"}, {0x300B, "send"},
+    {0x300C, "receive"}, {0x300D, "client_bind_port"},
+    {0x4000, "io_ring_setup"}, {0x4001, "io_ring_enter"},
+    {0x6666, "alpha"}
+};
+
+const char* name_of(uint64_t code){
+    for(auto& n : names){
+        if(n.code == code){
+            return n.name;
+        }
+    }
+
+    return "unknown";
+}
+
+std::expected<std::string> read_file(const std::string& path){
+    auto fd = tlib::open(path.c_str());
+
+    if(!fd.valid()){
+        return std::make_unexpected<std::string>(fd.error());
+    }
+
+    std::string value;
+
+    auto info = tlib::stat(*fd);
+
+    if(info.valid()){
+        auto size = info->size;
+
+        auto buffer = new char[size + 1];
+
+        auto content_result = tlib::read(*fd, buffer, size);
+
+        if(content_result.valid()){
+            buffer[*content_result] = '\0';
+            value = buffer;
+        }
+
+        delete[] buffer;
+    }
+
+    tlib::close(*fd);
+
+    return std::make_expected<std::string>(value);
+}
+
+std::vector<statistics> parse_statistics(const std::string& value){
+    std::vector<statistics> stats;
+
+    for(auto& line : std::split(value, '\n')){
+        auto fields = std::split(line, ' ');
+
+        if(fields.size() < 3 + BUCKETS){
+            continue;
+        }
+
+        statistics s;
+        s.code = std::parse(fields[0]);
+        s.count = std::parse(fields[1]);
+        s.cycles = std::parse(fields[2]);
+
+        for(size_t i = 0; i < BUCKETS; ++i){
+            s.histogram[i] = std::parse(fields[3 + i]);
+        }
+
+        stats.push_back(s);
+    }
+
+    // Most expensive system calls first
+    for(size_t i = 1; i < stats.size(); ++i){
+        for(size_t j = i; j > 0 && stats[j - 1].cycles < stats[j].cycles; --j){
+            std::swap(stats[j - 1], stats[j]);
+        }
+    }
+
+    return stats;
+}
+
+// Print a duration given in cycles in the most readable unit
+void print_duration(uint64_t cycles, uint64_t cycles_per_us){
+    if(!cycles_per_us){
+        tlib::printf("%uc", cycles);
+    } else if(cycles / cycles_per_us < 10000){
+        tlib::printf("%uus", cycles / cycles_per_us);
+    } else {
+        tlib::printf("%ums", cycles / cycles_per_us / 1000);
+    }
+}
+
+void print_histogram(const statistics& s, uint64_t cycles_per_us){
+    uint64_t max = 0;
+
+    for(auto bucket : s.histogram){
+        max = std::max(max, bucket);
+    }
+
+    for(size_t i = 0; i < BUCKETS; ++i){
+        if(!s.histogram[i]){
+            continue;
+        }
+
+        tlib::print("    >= ");
+        print_duration(uint64_t(1) << i, cycles_per_us);
+        tlib::printf("\t%u\t", s.histogram[i]);
+
+        for(size_t j = 0; j < (s.histogram[i] * 40 + max - 1) / max; ++j){
+            tlib::print('#');
+        }
+
+        tlib::print_line();
+    }
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* argv[]){
+    if(argc > 2){
+        tlib::print_line("Usage: syscallstat [pid]");
+        return 1;
+    }
+
+    std::string path = "/sys/syscalls/stats";
+
+    if(argc == 2){
+        path = "/proc/";
+        path += argv[1];
+        path += "/syscalls";
+    }
+
+    auto value = read_file(path);
+
+    if(!value){
+        tlib::printf("syscallstat: error: %s\n", std::error_message(value.error()));
+        return 1;
+    }
+
+    auto* page = reinterpret_cast<const tlib::time_page*>(tlib::time_page_address);
+
+    // Without a calibrated TSC, the durations are displayed in cycles
+    uint64_t cycles_per_us = page->tsc_frequency / 1000000;
+
+    auto stats = parse_statistics(*value);
+
+    tlib::print_line("             Syscall  Number      Calls Total Average");
+
+    for(auto& s : stats){
+        tlib::printf("%20s %7h %10u ", name_of(s.code), s.code, s.count);
+        print_duration(s.cycles, cycles_per_us);
+        tlib::print(' ');
+        print_duration(s.cycles / s.count, cycles_per_us);
+        tlib::print_line();
+    }
+
+    for(auto& s : stats){
+        tlib::printf("\n%s (%u calls)\n", name_of(s.code), s.count);
+        print_histogram(s, cycles_per_us);
+    }
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <vector.hpp>
+
+#include <tlib/file.hpp>
+#include <tlib/system.hpp>
+#include <tlib/errors.hpp>
+#include <tlib/print.hpp>
+#include <tlib/directory_entry.hpp>
+
+namespace {
+
+static constexpr const size_t BUFFER_SIZE = 4096;
+static constexpr const size_t DEFAULT_INTERVAL = 1000;
+
+struct sample {
+    uint64_t pid;
+    std::string name;
+    uint64_t user_time;   // us
+    uint64_t kernel_time; // us
+    uint64_t wait_time;   // us
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+    uint64_t system_calls;
+
+    uint64_t cpu_time() const {
+        return user_time + kernel_time;
+    }
+};
+
+std::string read_file(const std::string& path){
+    auto fd = tlib::open(path.c_str());
+
+    // The process may have exited in between
+    if(!fd.valid()){
+        return "";
+    }
+
+    std::string value;
+
+    auto info = tlib::stat(*fd);
+
+    if(info.valid()){
+        auto size = info->size;
+
+        auto buffer = new char[size + 1];
+
+        auto content_result = tlib::read(*fd, buffer, size);
+
+        if(content_result.valid() && *content_result == size){
+            buffer[size] = '\0';
+            value = buffer;
+        }
+
+        delete[] buffer;
+    }
+
+    tlib::close(*fd);
+
+    return value;
+}
+
+std::expected<std::vector<sample>> snapshot(){
+    std::vector<sample> samples;
+
+    auto fd = tlib::open("/proc/");
+
+    if(!fd.valid()){
+        return std::make_unexpected<std::vector<sample>>(fd.error());
+    }
+
+    auto entries_buffer = new char[BUFFER_SIZE];
+
+    auto entries_result = tlib::entries(*fd, entries_buffer, BUFFER_SIZE);
+
+    if(entries_result.valid()){
+        size_t position = 0;
+
+        while(true){
+            auto entry = reinterpret_cast<tlib::directory_entry*>(entries_buffer + position);
+
+            std::string base_path = "/proc/";
+            base_path += &entry->name;
+
+            sample s;
+            s.pid = std::parse(read_file(base_path + "/pid"));
+            s.name = read_file(base_path + "/name");
+            s.user_time = std::parse(read_file(base_path + "/user_time"));
+            s.kernel_time = std::parse(read_file(base_path + "/kernel_time"));
+            s.wait_time = std::parse(read_file(base_path + "/wait_time"));
+            s.voluntary_switches = std::parse(read_file(base_path + "/voluntary_switches"));
+            s.involuntary_switches = std::parse(read_file(base_path + "/involuntary_switches"));
+            s.system_calls = std::parse(read_file(base_path + "/system_calls"));
+
+            samples.push_back(s);
+
+            if(!entry->offset_next){
+                break;
+            }
+
+            position += entry->offset_next;
+        }
+    }
+
+    delete[] entries_buffer;
+
+    tlib::close(*fd);
+
+    if(!entries_result.valid()){
+        return std::make_unexpected<std::vector<sample>>(entries_result.error());
+    }
+
+    return std::make_expected<std::vector<sample>>(std::move(samples));
+}
+
+// Returns the activity of each process during the interval
+std::vector<sample> difference(const std::vector<sample>& before, const std::vector<sample>& after){
+    std::vector<sample> samples;
+
+    for(auto& s : after){
+        sample d = s;
+
+        for(auto& b : before){
+            if(b.pid == s.pid){
+                d.user_time -= b.user_time;
+                d.kernel_time -= b.kernel_time;
+                d.wait_time -= b.wait_time;
+                d.voluntary_switches -= b.voluntary_switches;
+                d.involuntary_switches -= b.involuntary_switches;
+                d.system_calls -= b.system_calls;
+                break;
+            }
+        }
+
+        samples.push_back(d);
+    }
+
+    // Most active processes first
+    for(size_t i = 1; i < samples.size(); ++i){
+        for(size_t j = i; j > 0 && samples[j - 1].cpu_time() < samples[j].cpu_time(); --j){
+            std::swap(samples[j - 1], samples[j]);
+        }
+    }
+
+    return samples;
+}
+
+} // end of anonymous space
+
+int main(int argc, char* argv[]){
+    auto interval = DEFAULT_INTERVAL;
+
+    if(argc > 1){
+        interval = std::parse(argv[1]);
+
+        if(!interval){
+            tlib::print_line("Usage: top [interval_ms]");
+            return 1;
+        }
+    }
+
+    auto before = snapshot();
+
+    if(!before){
+        tlib::printf("top: error: %s\n", std::error_message(before.error()));
+        return 1;
+    }
+
+    auto start = tlib::ms_time();
+
+    tlib::sleep_ms(interval);
+
+    auto after = snapshot();
+
+    if(!after){
+        tlib::printf("top: error: %s\n", std::error_message(after.error()));
+        return 1;
+    }
+
+    auto elapsed = (tlib::ms_time() - start) * 1000;
+
+    if(!elapsed){
+        elapsed = interval * 1000;
+    }
+
+    tlib::print_line("PID  CPU%  User(ms) Kernel(ms) Wait(ms)  Vol  Invol Syscalls Name");
+
+    for(auto& s : difference(*before, *after)){
+        auto permille = (s.cpu_time() * 1000) / elapsed;
+
+        tlib::printf("%3u %3u.%u %9u %10u %8u %4u %6u %8u %s\n",
+            s.pid, permille / 10, permille % 10,
+            s.user_time / 1000, s.kernel_time / 1000, s.wait_time / 1000,
+            s.voluntary_switches, s.involuntary_switches, s.system_calls, s.name.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include <vector.hpp>
+#include <string.hpp>
+
+#include <tlib/file.hpp>
+#include <tlib/system.hpp>
+#include <tlib/errors.hpp>
+#include <tlib/print.hpp>
+#include <tlib/trace.hpp>
+#include <tlib/time_page.hpp>
+
+namespace {
+
+static constexpr const size_t DEFAULT_DURATION = 1;
+static constexpr const size_t POLL_INTERVAL = 50;
+static constexpr const size_t BATCH = 128;
+
+std::vector<tlib::record> records;
+
+bool set_events(size_t fd, uint64_t mask){
+    auto value = std::to_string(mask);
+    auto result = tlib::write(fd, value.c_str(), value.size());
+
+    if(!result.valid()){
+        tlib::printf("trace: error: %s\n", std::error_message(result.error()));
+        return false;
+    }
+
+    return true;
+}
+
+bool drain(size_t fd){
+    tlib::record buffer[BATCH];
+
+    while(true){
+        auto result = tlib::read(fd, reinterpret_cast<char*>(buffer), sizeof(buffer));
+
+        if(!result.valid()){
+            tlib::printf("trace: error: %s\n", std::error_message(result.error()));
+            return false;
+        }
+
+        auto n = *result / sizeof(tlib::record);
+
+        for(size_t i = 0; i < n; ++i){
+            records.push_back(buffer[i]);
+        }
+
+        if(n < BATCH){
+            return true;
+        }
+    }
+}
+
+bool record(size_t duration, uint64_t mask){
+    auto fd = tlib::open("/dev/trace");
+
+    if(!fd.valid()){
+        tlib::printf("trace: error: %s\n", std::error_message(fd.error()));
+        return false;
+    }
+
+    bool success = set_events(*fd, mask);
+
+    // Consume the records regularly so that the kernel rings do not overflow
+    for(size_t elapsed = 0; success && elapsed < duration * 1000; elapsed += POLL_INTERVAL){
+        tlib::sleep_ms(POLL_INTERVAL);
+
+        success = drain(*fd);
+    }
+
+    set_events(*fd, 0);
+
+    // Get the records of the last interval
+    if(success){
+        success = drain(*fd);
+    }
+
+    tlib::close(*fd);
+
+    return success;
+}
+
+// The rings of the different processors are merged in time order
+void sort_records(){
+    for(size_t gap = records.size() / 2; gap > 0; gap /= 2){
+        for(size_t i = gap; i < records.size(); ++i){
+            for(size_t j = i; j >= gap && records[j].tsc < records[j - gap].tsc; j -= gap){
+                std::swap(records[j], records[j - gap]);
+            }
+        }
+    }
+}
+
+const char* event_name(uint16_t event){
+    switch(static_cast<tlib::event>(event)){
+        case tlib::event::SCHED_SWITCH:
+            return "sched_switch";
+        case tlib::event::SCHED_WAKEUP:
+            return "sched_wakeup";
+        case tlib::event::SYSCALL_ENTER:
+            return "syscall_enter";
+        case tlib::event::SYSCALL_EXIT:
+            return "syscall_exit";
+        case tlib::event::IRQ_ENTRY:
+            return "irq_entry";
+        case tlib::event::BLOCK_SUBMIT:
+            return "block_submit";
+        case tlib::event::BLOCK_COMPLETE:
+            return "block_complete";
+        case tlib::event::PACKET_RX:
+            return "packet_rx";
+        case tlib::event::PACKET_TX:
+            return "packet_tx";
+        default:
+            return "unknown";
+    }
+}
+
+void print_arguments(const tlib::record& r){
+    switch(static_cast<tlib::event>(r.event)){
+        case tlib::event::SCHED_SWITCH:
+            tlib::printf("prev=%u prev_state=%u next=%u", r.arg0, size_t(r.flags), r.arg1);
+            break;
+        case tlib::event::SCHED_WAKEUP:
+            tlib::printf("pid=%u target_cpu=%u", r.arg0, r.arg1);
+            break;
+        case tlib::event::SYSCALL_ENTER:
+            tlib::printf("nr=%h arg=%h", r.arg0, r.arg1);
+            break;
+        case tlib::event::SYSCALL_EXIT:
+            tlib::printf("nr=%h ret=%h", r.arg0, r.arg1);
+            break;
+        case tlib::event::IRQ_ENTRY:
+            tlib::printf("irq=%u rip=%h", r.arg0, r.arg1);
+            break;
+        case tlib::event::BLOCK_SUBMIT:
+        case tlib::event::BLOCK_COMPLETE:
+            tlib::printf("dev=%h sector=%u %s%s", r.arg0, r.arg1, (r.flags & 1) ? "write" : "read", (r.flags & 2) ? " error" : "");
+            break;
+        case tlib::event::PACKET_RX:
+        case tlib::event::PACKET_TX:
+            tlib::printf("if=%u len=%u", r.arg0, r.arg1);
+            break;
+        default:
+            tlib::printf("flags=%h arg0=%h arg1=%h", size_t(r.flags), r.arg0, r.arg1);
+            break;
+    }
+}
+
+void print_records(){
+    auto* page = reinterpret_cast<const tlib::time_page*>(tlib::time_page_address);
+
+    // Without a calibrated TSC, the raw cycles are displayed
+    uint64_t cycles_per_us = page->tsc_frequency / 1000000;
+
+    auto base = records.front().tsc;
+
+    tlib::printf("%u records (timestamps in %s)\n", records.size(), cycles_per_us ? "us" : "cycles");
+
+    for(auto& r : records){
+        auto delta = r.tsc - base;
+        auto timestamp = cycles_per_us ? delta / cycles_per_us : delta;
+
+        tlib::printf("%10u cpu%u pid%u %s: ", timestamp, size_t(r.cpu), size_t(r.pid), event_name(r.event));
+        print_arguments(r);
+        tlib::print_line();
+    }
+}
+
+} // end of anonymous namespace
+
+int main(int argc, char* argv[]){
+    size_t duration = DEFAULT_DURATION;
+    uint64_t mask = tlib::all_events;
+
+    if(argc > 1){
+        duration = std::parse(argv[1]);
+    }
+
+    if(argc > 2){
+        mask = std::parse(argv[2]);
+    }
+
+    if(!duration || !mask){
+        tlib::print_line("Usage: trace [seconds] [event_mask]");
+        return 1;
+    }
+
+    if(!record(duration, mask)){
+        return 1;
+    }
+
+    if(records.empty()){
+        tlib::print_line("trace: no records");
+        return 0;
+    }
+
+    sort_records();
+    print_records();
+
+    return 0;
+}
@@ -54,6 +54,18 @@ struct section_header {
     uint64_t sh_entsize;
 }__attribute__((packed));
 
+struct symbol {
+    uint32_t st_name;
+    uint8_t st_info;
+    uint8_t st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+}__attribute__((packed));
+
+constexpr const uint32_t SHT_SYMTAB = 2; ///< Section holding the symbol table
+constexpr const uint8_t STT_FUNC = 2;    ///< Symbol of a function
+
 inline bool is_valid(const char* buffer){
     auto header = reinterpret_cast<const elf::elf_header*>(buffer);
 
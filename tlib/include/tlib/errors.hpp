@@ -45,6 +45,8 @@ constexpr const size_t ERROR_SOCKET_INVALID_TYPE_PROTOCOL     = 30;
 constexpr const size_t ERROR_SOCKET_NOT_CONNECTED             = 31;
 constexpr const size_t ERROR_SOCKET_INVALID_CONNECTION        = 32;
 constexpr const size_t ERROR_SOCKET_TCP_ERROR        = 33;
+constexpr const size_t ERROR_WOULD_BLOCK                      = 34;
+constexpr const size_t ERROR_TIMEOUT                          = 35;
 
 inline const char* error_message(size_t error){
     switch(error){
@@ -114,6 +116,10 @@ inline const char* error_message(size_t error){
             return "Issue with the internal connection";
         case ERROR_SOCKET_TCP_ERROR:
             return "TCP packet was not acknowledged";
+        case ERROR_WOULD_BLOCK:
+            return "The value changed before waiting";
+        case ERROR_TIMEOUT:
+            return "Timeout";
         default:
             return "Unknonwn error";
     }
@@ -0,0 +1,35 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TLIB_FUTEX_HPP
+#define TLIB_FUTEX_HPP
+
+#include <types.hpp>
+#include <expected.hpp>
+
+#include "tlib/config.hpp"
+
+ASSERT_ONLY_THOR_PROGRAM
+
+namespace tlib {
+
+/*!
+ * \brief Sleep as long as the given word contains the expected value.
+ *
+ * \param ms The timeout in milliseconds, 0 to wait indefinitely
+ */
+std::expected<void> futex_wait(volatile uint32_t* address, uint32_t expected, size_t ms = 0);
+
+/*!
+ * \brief Wake up at most n threads sleeping on the given word
+ * \return The number of threads that were woken up
+ */
+std::expected<size_t> futex_wake(volatile uint32_t* address, size_t n);
+
+} // end of tlib namespace
+
+#endif
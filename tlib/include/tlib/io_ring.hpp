@@ -0,0 +1,93 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef USER_IO_RING_HPP
+#define USER_IO_RING_HPP
+
+#include <types.hpp>
+#include <expected.hpp>
+
+#include "tlib/io_ring_layout.hpp"
+#include "tlib/config.hpp"
+
+ASSERT_ONLY_THOR_PROGRAM
+
+namespace tlib {
+
+/*!
+ * \brief A submission ring to execute several operations with a single
+ * entry in the kernel.
+ *
+ * Only one ring can be registered at a time by a process.
+ */
+struct io_ring {
+    /*!
+     * \brief Allocate the ring and register it to the kernel
+     */
+    io_ring();
+
+    /*!
+     * \brief Unregister the ring and release it
+     */
+    ~io_ring();
+
+    io_ring(const io_ring& rhs) = delete;
+    io_ring& operator=(const io_ring& rhs) = delete;
+
+    /*!
+     * \brief Indicates if the ring has been registered
+     */
+    bool valid() const;
+
+    /*!
+     * \brief Indicates if no submission can be queued anymore
+     */
+    bool full() const;
+
+    /*!
+     * \brief Returns the number of queued submissions
+     */
+    size_t pending() const;
+
+    /*!
+     * \brief Queue a system call
+     * \return false if the ring is full, true otherwise
+     */
+    bool push(size_t code, size_t a = 0, size_t b = 0, size_t c = 0, size_t d = 0, uint64_t user_data = 0);
+
+    bool print(char c, uint64_t user_data = 0);
+    bool print(const char* s, uint64_t user_data = 0);
+    bool read(size_t fd, char* buffer, size_t max, size_t offset = 0, uint64_t user_data = 0);
+    bool write(size_t fd, const char* buffer, size_t max, size_t offset = 0, uint64_t user_data = 0);
+    bool send(size_t socket_fd, const char* buffer, size_t n, char* target_buffer, uint64_t user_data = 0);
+    bool receive(size_t socket_fd, char* buffer, size_t n, size_t ms, uint64_t user_data = 0);
+
+    /*!
+     * \brief Enter the kernel to execute all the queued submissions
+     * \return the number of executed submissions
+     */
+    std::expected<size_t> submit();
+
+    /*!
+     * \brief Take the next completion, if any
+     * \return true if a completion has been taken, false otherwise
+     */
+    bool complete(io_ring_completion& completion);
+
+    /*!
+     * \brief Execute all the queued submissions, discarding their completions
+     */
+    void flush();
+
+private:
+    io_ring_layout* ring;
+    bool registered;
+};
+
+} // end of tlib namespace
+
+#endif
@@ -0,0 +1,63 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TLIB_IO_RING_LAYOUT_HPP
+#define TLIB_IO_RING_LAYOUT_HPP
+
+#include <types.hpp>
+
+#include "tlib/config.hpp"
+
+THOR_NAMESPACE(tlib, io) {
+
+/*!
+ * \brief The number of entries of each queue of the ring
+ */
+constexpr const size_t io_ring_entries = 64;
+
+/*!
+ * \brief An operation submitted to the kernel.
+ *
+ * The code and the arguments are the same as the ones of the
+ * corresponding system call (rax, then rbx, rcx, rdx and rsi).
+ */
+struct io_ring_submission {
+    uint64_t code;      ///< The system call code
+    uint64_t args[4];   ///< The arguments of the system call
+    uint64_t user_data; ///< Value copied as is in the completion
+};
+
+/*!
+ * \brief The completion of a submitted operation
+ */
+struct io_ring_completion {
+    int64_t result;     ///< The result of the system call (rax)
+    uint64_t user_data; ///< The value given at submission
+};
+
+/*!
+ * \brief A submission and a completion queue shared between a process
+ * and the kernel.
+ *
+ * The counters are free running, the index of an entry is the counter
+ * modulo io_ring_entries. The process produces submissions (sq_tail)
+ * and consumes completions (cq_head), the kernel consumes submissions
+ * (sq_head) and produces completions (cq_tail).
+ */
+struct io_ring_layout {
+    volatile uint64_t sq_head; ///< The next submission to be consumed by the kernel
+    volatile uint64_t sq_tail; ///< The next free submission slot
+    volatile uint64_t cq_head; ///< The next completion to be consumed by the process
+    volatile uint64_t cq_tail; ///< The next free completion slot
+
+    io_ring_submission sq[io_ring_entries]; ///< The submission queue
+    io_ring_completion cq[io_ring_entries]; ///< The completion queue
+};
+
+} // end of namespace
+
+#endif
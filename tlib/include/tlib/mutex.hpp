@@ -0,0 +1,81 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TLIB_MUTEX_HPP
+#define TLIB_MUTEX_HPP
+
+#include <types.hpp>
+
+#include "tlib/config.hpp"
+
+ASSERT_ONLY_THOR_PROGRAM
+
+namespace tlib {
+
+/*!
+ * \brief A mutex for the threads of a process.
+ *
+ * The mutex spins briefly and only calls the kernel when it is contended.
+ */
+struct mutex {
+    /*!
+     * \brief Acquire the lock
+     */
+    void lock();
+
+    /*!
+     * \brief Try to acquire the lock without waiting
+     * \return true if the lock was acquired, false otherwise.
+     */
+    bool try_lock();
+
+    /*!
+     * \brief Release the lock
+     */
+    void unlock();
+
+private:
+    volatile uint32_t state = 0; ///< 0: unlocked, 1: locked, 2: locked with waiters
+
+    friend struct condition_variable;
+};
+
+/*!
+ * \brief A condition variable to use with tlib::mutex
+ */
+struct condition_variable {
+    /*!
+     * \brief Release the mutex and wait until notified. The mutex is
+     * acquired again before returning.
+     */
+    void wait(mutex& m);
+
+    /*!
+     * \brief Release the mutex and wait until notified or until the
+     * timeout is passed. The mutex is acquired again before returning.
+     *
+     * \return true if the thread was notified, false if the timeout is passed
+     */
+    bool wait_for(mutex& m, size_t ms);
+
+    /*!
+     * \brief Wake up one waiting thread
+     */
+    void notify_one();
+
+    /*!
+     * \brief Wake up all the waiting threads
+     */
+    void notify_all();
+
+private:
+    volatile uint32_t sequence = 0; ///< Incremented by each notification
+};
+
+} // end of tlib namespace
+
+#endif
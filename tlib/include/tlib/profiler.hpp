@@ -0,0 +1,32 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TLIB_PROFILER_H
+#define TLIB_PROFILER_H
+
+#include <types.hpp>
+
+#include "tlib/config.hpp"
+
+THOR_NAMESPACE(tlib, profiler) {
+
+constexpr const size_t stack_depth = 6; ///< The maximum number of return addresses of a sample
+
+/*!
+ * \brief A sample of the profiler, as read from /dev/profiler
+ */
+struct sample {
+    uint64_t pid;                 ///< The process that was running
+    uint64_t cpu;                 ///< The processor that was sampled
+    uint64_t rip;                 ///< The interrupted instruction
+    uint64_t user;                ///< 1 if the processor was in user mode
+    uint64_t stack[stack_depth];  ///< The return addresses, innermost first, 0 terminated
+};
+
+} // end of profiler namespace
+
+#endif
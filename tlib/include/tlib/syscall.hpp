@@ -0,0 +1,23 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TLIB_SYSCALL_HPP
+#define TLIB_SYSCALL_HPP
+
+#include "tlib/config.hpp"
+
+ASSERT_ONLY_THOR_PROGRAM
+
+// System calls are made with the SYSCALL instruction. The processor
+// overwrites rcx and r11, so the argument in rcx is passed in r10.
+// int 50 is still supported by the kernel.
+
+#define TLIB_SYSCALL "mov r10, rcx; syscall"
+
+#define TLIB_SYSCALL_CLOBBERS "rcx", "r10", "r11"
+
+#endif
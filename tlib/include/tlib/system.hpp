@@ -37,6 +37,14 @@ void shutdown();
 uint64_t s_time();
 uint64_t ms_time();
 
+/*!
+ * \brief Returns the up-time in nanoseconds.
+ *
+ * The resolution is a few nanoseconds when the kernel uses the TSC as
+ * clocksource, a millisecond otherwise.
+ */
+uint64_t ns_time();
+
 void alpha();
 
 } // end of tlib namespace
@@ -0,0 +1,42 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TLIB_THREAD_HPP
+#define TLIB_THREAD_HPP
+
+#include <types.hpp>
+#include <expected.hpp>
+
+#include "tlib/config.hpp"
+
+ASSERT_ONLY_THOR_PROGRAM
+
+namespace tlib {
+
+using thread_function = void (*)(void*);
+
+/*!
+ * \brief Create a new thread in the current process.
+ *
+ * The thread shares the memory, the file handles and the sockets of the
+ * process. It runs fun(data) and terminates when fun returns. All the
+ * threads are terminated when the process exits.
+ *
+ * \return The id of the thread
+ */
+std::expected<size_t> create_thread(thread_function fun, void* data);
+
+/*!
+ * \brief Wait for the termination of the given thread.
+ *
+ * Only the thread that created the thread can wait for it.
+ */
+void join_thread(size_t tid);
+
+} // end of tlib namespace
+
+#endif
@@ -0,0 +1,45 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TLIB_TIME_PAGE_HPP
+#define TLIB_TIME_PAGE_HPP
+
+#include <types.hpp>
+
+#include "tlib/config.hpp"
+
+THOR_NAMESPACE(tlib, timer) {
+
+/*!
+ * \brief The virtual address of the time page in each process
+ */
+constexpr const size_t time_page_address = 0x8000100000;
+
+/*!
+ * \brief The time information shared read-only by the kernel with all
+ * the processes.
+ *
+ * The fields are protected by a sequence lock: the sequence is odd
+ * while the kernel updates the page and readers must retry if the
+ * sequence changed during their read.
+ */
+struct time_page {
+    volatile uint64_t sequence;          ///< The sequence lock
+    volatile uint64_t ticks;             ///< The number of timer ticks
+    volatile uint64_t timer_frequency;   ///< The frequency of the timer ticks (Hz)
+    volatile uint64_t counter_frequency; ///< The frequency of the counter (Hz)
+    volatile uint64_t milliseconds;      ///< The up-time in milliseconds at the last update
+    volatile uint64_t tsc;               ///< The TSC value at the last update
+    volatile uint64_t tsc_frequency;     ///< The frequency of the TSC (Hz), 0 if not calibrated
+    volatile uint64_t tsc_mult;          ///< ns = ns_base + ((tsc - tsc_base) * tsc_mult) >> 32, 0 if the TSC is not a clocksource
+    volatile uint64_t tsc_base;          ///< The TSC when the clocksource was enabled
+    volatile uint64_t ns_base;           ///< The up-time in nanoseconds when the clocksource was enabled
+};
+
+} // end of namespace tlib
+
+#endif
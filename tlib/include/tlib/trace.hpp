@@ -0,0 +1,59 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#ifndef TLIB_TRACE_H
+#define TLIB_TRACE_H
+
+#include <types.hpp>
+
+#include "tlib/config.hpp"
+
+THOR_NAMESPACE(tlib, trace) {
+
+/*!
+ * \brief The events that can be recorded in the trace
+ */
+enum class event : uint16_t {
+    SCHED_SWITCH = 0,   ///< arg0: previous pid, arg1: next pid, flags: state of the previous process
+    SCHED_WAKEUP = 1,   ///< arg0: woken pid, arg1: processor of the woken process
+    SYSCALL_ENTER = 2,  ///< arg0: system call number, arg1: first argument
+    SYSCALL_EXIT = 3,   ///< arg0: system call number, arg1: result
+    IRQ_ENTRY = 4,      ///< arg0: irq number, arg1: interrupted instruction
+    BLOCK_SUBMIT = 5,   ///< arg0: device, arg1: sector, flags: 1 for a write
+    BLOCK_COMPLETE = 6, ///< arg0: device, arg1: sector, flags: 1 for a write, 2 on error
+    PACKET_RX = 7,      ///< arg0: interface, arg1: size
+    PACKET_TX = 8,      ///< arg0: interface, arg1: size
+    MAX = 9
+};
+
+/*!
+ * \brief Returns the bit of the given event in the mask of enabled events
+ */
+constexpr uint64_t event_bit(event e){
+    return uint64_t(1) << static_cast<uint16_t>(e);
+}
+
+constexpr const uint64_t all_events = (uint64_t(1) << static_cast<uint16_t>(event::MAX)) - 1; ///< The mask enabling every event
+
+/*!
+ * \brief A record of the trace, as read from /dev/trace
+ */
+struct record {
+    uint64_t tsc;   ///< The TSC when the event happened
+    uint16_t event; ///< The event (trace::event)
+    uint16_t cpu;   ///< The processor on which the event happened
+    uint16_t pid;   ///< The process running on the processor
+    uint16_t flags; ///< Event-specific flags
+    uint64_t arg0;  ///< First event-specific argument
+    uint64_t arg1;  ///< Second event-specific argument
+};
+
+static_assert(sizeof(record) == 32, "Trace records are packed in 32 bytes");
+
+} // end of trace namespace
+
+#endif
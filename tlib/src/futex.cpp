@@ -0,0 +1,37 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include "tlib/futex.hpp"
+#include "tlib/syscall.hpp"
+
+std::expected<void> tlib::futex_wait(volatile uint32_t* address, uint32_t expected, size_t ms){
+    int64_t code;
+    asm volatile("mov rax, 0x1200; mov rbx, %[address]; mov rcx, %[expected]; mov rdx, %[ms]; " TLIB_SYSCALL "; mov %[code], rax"
+        : [code] "=m" (code)
+        : [address] "g" (reinterpret_cast<size_t>(address)), [expected] "g" (size_t(expected)), [ms] "g" (ms)
+        : "rax", "rbx", "rdx", "memory", TLIB_SYSCALL_CLOBBERS);
+
+    if(code < 0){
+        return std::make_unexpected<void, size_t>(-code);
+    } else {
+        return std::make_expected();
+    }
+}
+
+std::expected<size_t> tlib::futex_wake(volatile uint32_t* address, size_t n){
+    int64_t code;
+    asm volatile("mov rax, 0x1201; mov rbx, %[address]; mov rcx, %[n]; " TLIB_SYSCALL "; mov %[code], rax"
+        : [code] "=m" (code)
+        : [address] "g" (reinterpret_cast<size_t>(address)), [n] "g" (n)
+        : "rax", "rbx", "memory", TLIB_SYSCALL_CLOBBERS);
+
+    if(code < 0){
+        return std::make_expected_from_error<size_t, size_t>(-code);
+    } else {
+        return std::make_expected<size_t>(code);
+    }
+}
@@ -6,15 +6,16 @@
 //=======================================================================
 
 #include "tlib/graphics.hpp"
+#include "tlib/syscall.hpp"
 
 namespace {
 
 uint64_t syscall_get(uint64_t call){
     size_t value;
-    asm volatile("mov rax, %[call]; int 50; mov %[value], rax"
+    asm volatile("mov rax, %[call]; " TLIB_SYSCALL "; mov %[value], rax"
         : [value] "=m" (value)
         : [call] "r" (call)
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
     return value;
 }
 
@@ -53,10 +54,10 @@ uint64_t tlib::graphics::get_blue_shift(){
 }
 
 void tlib::graphics::redraw(char* buffer){
-    asm volatile("mov rax, 0x1008; mov rbx, %[buffer]; int 50;"
+    asm volatile("mov rax, 0x1008; mov rbx, %[buffer]; " TLIB_SYSCALL
         :
         : [buffer] "g" (buffer)
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 }
 
 uint64_t tlib::graphics::mouse_x(){
@@ -0,0 +1,137 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include "tlib/io_ring.hpp"
+#include "tlib/syscall.hpp"
+
+namespace {
+
+int64_t io_ring_setup(size_t address){
+    int64_t code;
+    asm volatile("mov rax, 0x4000; mov rbx, %[address]; " TLIB_SYSCALL "; mov %[code], rax"
+        : [code] "=m" (code)
+        : [address] "g" (address)
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
+    return code;
+}
+
+int64_t io_ring_enter(size_t count){
+    int64_t code;
+    asm volatile("mov rax, 0x4001; mov rbx, %[count]; " TLIB_SYSCALL "; mov %[code], rax"
+        : [code] "=m" (code)
+        : [count] "g" (count)
+        : "rax", "rbx", "memory", TLIB_SYSCALL_CLOBBERS);
+    return code;
+}
+
+} // end of anonymous namespace
+
+tlib::io_ring::io_ring(){
+    ring = new io_ring_layout();
+
+    ring->sq_head = ring->sq_tail = 0;
+    ring->cq_head = ring->cq_tail = 0;
+
+    registered = io_ring_setup(reinterpret_cast<size_t>(ring)) == 0;
+}
+
+tlib::io_ring::~io_ring(){
+    if(registered){
+        io_ring_setup(0);
+    }
+
+    delete ring;
+}
+
+bool tlib::io_ring::valid() const {
+    return registered;
+}
+
+bool tlib::io_ring::full() const {
+    return pending() >= io_ring_entries;
+}
+
+size_t tlib::io_ring::pending() const {
+    return ring->sq_tail - ring->sq_head;
+}
+
+bool tlib::io_ring::push(size_t code, size_t a, size_t b, size_t c, size_t d, uint64_t user_data){
+    if(full()){
+        return false;
+    }
+
+    auto& submission = ring->sq[ring->sq_tail % io_ring_entries];
+
+    submission.code      = code;
+    submission.args[0]   = a;
+    submission.args[1]   = b;
+    submission.args[2]   = c;
+    submission.args[3]   = d;
+    submission.user_data = user_data;
+
+    ++ring->sq_tail;
+
+    return true;
+}
+
+bool tlib::io_ring::print(char c, uint64_t user_data){
+    return push(0, c, 0, 0, 0, user_data);
+}
+
+bool tlib::io_ring::print(const char* s, uint64_t user_data){
+    return push(1, reinterpret_cast<size_t>(s), 0, 0, 0, user_data);
+}
+
+bool tlib::io_ring::read(size_t fd, char* buffer, size_t max, size_t offset, uint64_t user_data){
+    return push(303, fd, reinterpret_cast<size_t>(buffer), max, offset, user_data);
+}
+
+bool tlib::io_ring::write(size_t fd, const char* buffer, size_t max, size_t offset, uint64_t user_data){
+    return push(311, fd, reinterpret_cast<size_t>(buffer), max, offset, user_data);
+}
+
+bool tlib::io_ring::send(size_t socket_fd, const char* buffer, size_t n, char* target_buffer, uint64_t user_data){
+    return push(0x300B, socket_fd, reinterpret_cast<size_t>(buffer), n, reinterpret_cast<size_t>(target_buffer), user_data);
+}
+
+bool tlib::io_ring::receive(size_t socket_fd, char* buffer, size_t n, size_t ms, uint64_t user_data){
+    return push(0x300C, socket_fd, reinterpret_cast<size_t>(buffer), n, ms, user_data);
+}
+
+std::expected<size_t> tlib::io_ring::submit(){
+    auto code = io_ring_enter(pending());
+
+    if(code < 0){
+        return std::make_expected_from_error<size_t, size_t>(-code);
+    } else {
+        return std::make_expected<size_t>(code);
+    }
+}
+
+bool tlib::io_ring::complete(io_ring_completion& completion){
+    if(ring->cq_head == ring->cq_tail){
+        return false;
+    }
+
+    completion = ring->cq[ring->cq_head % io_ring_entries];
+
+    ++ring->cq_head;
+
+    return true;
+}
+
+void tlib::io_ring::flush(){
+    while(pending()){
+        auto result = submit();
+
+        ring->cq_head = ring->cq_tail;
+
+        if(!result || !*result){
+            break;
+        }
+    }
+}
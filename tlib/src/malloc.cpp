@@ -6,6 +6,7 @@
 //=======================================================================
 
 #include "tlib/malloc.hpp"
+#include "tlib/syscall.hpp"
 
 #define likely(x)    __builtin_expect (!!(x), 1)
 #define unlikely(x)  __builtin_expect (!!(x), 0)
@@ -48,6 +49,21 @@ static_assert(aligned(MIN_SPLIT), "The size of minimum split must guarantee alig
 fake_head head;
 malloc_header_chunk* malloc_head = 0;
 
+// The heap is shared by all the threads of the process
+volatile size_t heap_lock = 0;
+
+void lock_heap(){
+    while(!__sync_bool_compare_and_swap(&heap_lock, 0, 1)){
+        while(heap_lock){
+            asm volatile("pause");
+        }
+    }
+}
+
+void unlock_heap(){
+    __sync_lock_release(&heap_lock);
+}
+
 //Insert new_block after current in the free list and update
 //all the necessary links
 void insert_after(malloc_header_chunk* current, malloc_header_chunk* new_block){
@@ -124,6 +140,8 @@ void init_head(){
 } //end of anonymous namespace
 
 void* tlib::malloc(size_t bytes){
+    lock_heap();
+
     if(unlikely(!init)){
         init_head();
     }
@@ -188,6 +206,8 @@ void* tlib::malloc(size_t bytes){
     //Address of the start of the block
     auto block_start = reinterpret_cast<uintptr_t>(current) + sizeof(malloc_header_chunk);
 
+    unlock_heap();
+
     return reinterpret_cast<void*>(block_start);
 }
 
@@ -195,37 +215,41 @@ void tlib::free(void* block){
     auto free_header = reinterpret_cast<malloc_header_chunk*>(
         reinterpret_cast<uintptr_t>(block) - sizeof(malloc_header_chunk));
 
+    lock_heap();
+
     //Less memory is used
     _used -= free_header->size + META_SIZE;
 
     //Add the freed block in the free list
     insert_after(malloc_head, free_header);
+
+    unlock_heap();
 }
 
 size_t tlib::brk_start(){
     size_t value;
-    asm volatile("mov rax, 7; int 50; mov %[brk_start], rax"
+    asm volatile("mov rax, 7; " TLIB_SYSCALL "; mov %[brk_start], rax"
         : [brk_start] "=m" (value)
         : //No inputs
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
     return value;
 }
 
 size_t tlib::brk_end(){
     size_t value;
-    asm volatile("mov rax, 8; int 50; mov %[brk_end], rax"
+    asm volatile("mov rax, 8; " TLIB_SYSCALL "; mov %[brk_end], rax"
         : [brk_end] "=m" (value)
         : //No inputs
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
     return value;
 }
 
 size_t tlib::sbrk(size_t inc){
     size_t value;
-    asm volatile("mov rax, 9; mov rbx, %[brk_inc]; int 50; mov %[brk_end], rax"
+    asm volatile("mov rax, 9; mov rbx, %[brk_inc]; " TLIB_SYSCALL "; mov %[brk_end], rax"
         : [brk_end] "=m" (value)
         : [brk_inc] "g" (inc)
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
     return value;
 }
 
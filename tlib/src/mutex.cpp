@@ -0,0 +1,85 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include "tlib/mutex.hpp"
+#include "tlib/futex.hpp"
+#include "tlib/errors.hpp"
+
+namespace {
+
+// Number of times to check the lock before sleeping in the kernel
+constexpr const size_t spin_count = 128;
+
+} //end of anonymous namespace
+
+void tlib::mutex::lock(){
+    // Fast path: the mutex is free
+    if(__sync_bool_compare_and_swap(&state, 0, 1)){
+        return;
+    }
+
+    // The owner may release it soon
+    for(size_t i = 0; i < spin_count; ++i){
+        asm volatile("pause");
+
+        if(state == 0 && __sync_bool_compare_and_swap(&state, 0, 1)){
+            return;
+        }
+    }
+
+    // Mark the mutex contended and sleep until it is released
+    while(__sync_lock_test_and_set(&state, 2) != 0){
+        futex_wait(&state, 2);
+    }
+}
+
+bool tlib::mutex::try_lock(){
+    return __sync_bool_compare_and_swap(&state, 0, 1);
+}
+
+void tlib::mutex::unlock(){
+    // Only call the kernel if there may be waiters
+    if(__sync_fetch_and_sub(&state, 1) != 1){
+        __sync_lock_release(&state);
+
+        futex_wake(&state, 1);
+    }
+}
+
+void tlib::condition_variable::wait(mutex& m){
+    auto value = sequence;
+
+    m.unlock();
+
+    futex_wait(&sequence, value);
+
+    m.lock();
+}
+
+bool tlib::condition_variable::wait_for(mutex& m, size_t ms){
+    auto value = sequence;
+
+    m.unlock();
+
+    auto result = futex_wait(&sequence, value, ms);
+
+    m.lock();
+
+    return result.valid() || result.error() != std::ERROR_TIMEOUT;
+}
+
+void tlib::condition_variable::notify_one(){
+    __sync_fetch_and_add(&sequence, 1);
+
+    futex_wake(&sequence, 1);
+}
+
+void tlib::condition_variable::notify_all(){
+    __sync_fetch_and_add(&sequence, 1);
+
+    futex_wake(&sequence, size_t(-1));
+}
@@ -6,6 +6,7 @@
 
 #include "tlib/net.hpp"
 #include "tlib/malloc.hpp"
+#include "tlib/syscall.hpp"
 
 tlib::packet::packet()
         : fd(0), payload(nullptr), index(0) {
@@ -37,10 +38,10 @@ tlib::packet::~packet() {
 
 std::expected<size_t> tlib::socket_open(socket_domain domain, socket_type type, socket_protocol protocol) {
     int64_t fd;
-    asm volatile("mov rax, 0x3000; mov rbx, %[domain]; mov rcx, %[type]; mov rdx, %[protocol]; int 50; mov %[fd], rax"
+    asm volatile("mov rax, 0x3000; mov rbx, %[domain]; mov rcx, %[type]; mov rdx, %[protocol]; " TLIB_SYSCALL "; mov %[fd], rax"
                  : [fd] "=m"(fd)
                  : [domain] "g"(static_cast<size_t>(domain)), [type] "g"(static_cast<size_t>(type)), [protocol] "g"(static_cast<size_t>(protocol))
-                 : "rax", "rbx", "rcx", "rdx");
+                 : "rax", "rbx", "rdx", TLIB_SYSCALL_CLOBBERS);
 
     if (fd < 0) {
         return std::make_expected_from_error<size_t, size_t>(-fd);
@@ -50,10 +51,10 @@ std::expected<size_t> tlib::socket_open(socket_domain domain, socket_type type,
 }
 
 void tlib::socket_close(size_t fd) {
-    asm volatile("mov rax, 0x3001; mov rbx, %[fd]; int 50;"
+    asm volatile("mov rax, 0x3001; mov rbx, %[fd]; " TLIB_SYSCALL
                  : /* No outputs */
                  : [fd] "g"(fd)
-                 : "rax", "rbx");
+                 : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 }
 
 std::expected<tlib::packet> tlib::prepare_packet(size_t socket_fd, void* desc) {
@@ -61,10 +62,10 @@ std::expected<tlib::packet> tlib::prepare_packet(size_t socket_fd, void* desc) {
 
     int64_t fd;
     uint64_t index;
-    asm volatile("mov rax, 0x3002; mov rbx, %[socket]; mov rcx, %[desc]; mov rdx, %[buffer]; int 50; mov %[fd], rax; mov %[index], rbx;"
+    asm volatile("mov rax, 0x3002; mov rbx, %[socket]; mov rcx, %[desc]; mov rdx, %[buffer]; " TLIB_SYSCALL "; mov %[fd], rax; mov %[index], rbx;"
                  : [fd] "=m"(fd), [index] "=m"(index)
                  : [socket] "g"(socket_fd), [desc] "g"(reinterpret_cast<size_t>(desc)), [buffer] "g"(reinterpret_cast<size_t>(buffer))
-                 : "rax", "rbx", "rcx", "rdx");
+                 : "rax", "rbx", "rdx", TLIB_SYSCALL_CLOBBERS);
 
     if (fd < 0) {
         free(buffer);
@@ -82,10 +83,10 @@ std::expected<void> tlib::finalize_packet(size_t socket_fd, const tlib::packet&
     auto packet_fd = p.fd;
 
     int64_t code;
-    asm volatile("mov rax, 0x3003; mov rbx, %[socket]; mov rcx, %[packet]; int 50; mov %[code], rax"
+    asm volatile("mov rax, 0x3003; mov rbx, %[socket]; mov rcx, %[packet]; " TLIB_SYSCALL "; mov %[code], rax"
                  : [code] "=m"(code)
                  : [socket] "g"(socket_fd), [packet] "g"(packet_fd)
-                 : "rax", "rbx", "rcx");
+                 : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         return std::make_expected_from_error<void, size_t>(-code);
@@ -98,10 +99,10 @@ std::expected<void> tlib::send(size_t socket_fd, const char* buffer, size_t n) {
     auto* target_buffer = new char[2048];
 
     int64_t code;
-    asm volatile("mov rax, 0x300B; mov rbx, %[socket]; mov rcx, %[buffer]; mov rdx, %[n]; mov rsi, %[target_buffer]; int 50; mov %[code], rax;"
+    asm volatile("mov rax, 0x300B; mov rbx, %[socket]; mov rcx, %[buffer]; mov rdx, %[n]; mov rsi, %[target_buffer]; " TLIB_SYSCALL "; mov %[code], rax;"
                  : [code] "=m"(code)
                  : [socket] "g"(socket_fd), [buffer] "g"(reinterpret_cast<size_t>(buffer)), [n] "g" (n), [target_buffer] "g"(reinterpret_cast<size_t>(target_buffer))
-                 : "rax", "rbx", "rcx", "rdx", "rsi");
+                 : "rax", "rbx", "rdx", "rsi", TLIB_SYSCALL_CLOBBERS);
 
     delete[] target_buffer;
 
@@ -114,10 +115,10 @@ std::expected<void> tlib::send(size_t socket_fd, const char* buffer, size_t n) {
 
 std::expected<size_t> tlib::receive(size_t socket_fd, char* buffer, size_t n, size_t ms) {
     int64_t code;
-    asm volatile("mov rax, 0x300C; mov rbx, %[socket]; mov rcx, %[buffer]; mov rdx, %[n]; mov rsi, %[ms]; int 50; mov %[code], rax;"
+    asm volatile("mov rax, 0x300C; mov rbx, %[socket]; mov rcx, %[buffer]; mov rdx, %[n]; mov rsi, %[ms]; " TLIB_SYSCALL "; mov %[code], rax;"
                  : [code] "=m"(code)
                  : [socket] "g"(socket_fd), [buffer] "g"(reinterpret_cast<size_t>(buffer)), [n] "g" (n), [ms] "g" (ms)
-                 : "rax", "rbx", "rcx", "rdx", "rsi");
+                 : "rax", "rbx", "rdx", "rsi", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         return std::make_unexpected<size_t, size_t>(-code);
@@ -128,10 +129,10 @@ std::expected<size_t> tlib::receive(size_t socket_fd, char* buffer, size_t n, si
 
 std::expected<void> tlib::listen(size_t socket_fd, bool l) {
     int64_t code;
-    asm volatile("mov rax, 0x3004; mov rbx, %[socket]; mov rcx, %[listen]; int 50; mov %[code], rax"
+    asm volatile("mov rax, 0x3004; mov rbx, %[socket]; mov rcx, %[listen]; " TLIB_SYSCALL "; mov %[code], rax"
                  : [code] "=m"(code)
                  : [socket] "g"(socket_fd), [listen] "g"(size_t(l))
-                 : "rax", "rbx", "rcx");
+                 : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         return std::make_expected_from_error<void, size_t>(-code);
@@ -142,10 +143,10 @@ std::expected<void> tlib::listen(size_t socket_fd, bool l) {
 
 std::expected<size_t> tlib::client_bind(size_t socket_fd, tlib::ip::address server) {
     int64_t code;
-    asm volatile("mov rax, 0x3007; mov rbx, %[socket]; mov rcx, %[ip]; int 50; mov %[code], rax"
+    asm volatile("mov rax, 0x3007; mov rbx, %[socket]; mov rcx, %[ip]; " TLIB_SYSCALL "; mov %[code], rax"
                  : [code] "=m"(code)
                  : [socket] "g"(socket_fd), [ip] "g" (size_t(server.raw_address))
-                 : "rax", "rbx", "rcx");
+                 : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         return std::make_unexpected<size_t, size_t>(-code);
@@ -156,10 +157,10 @@ std::expected<size_t> tlib::client_bind(size_t socket_fd, tlib::ip::address serv
 
 std::expected<size_t> tlib::client_bind(size_t socket_fd, tlib::ip::address server, size_t port) {
     int64_t code;
-    asm volatile("mov rax, 0x300D; mov rbx, %[socket]; mov rcx, %[ip]; mov rdx, %[port]; int 50; mov %[code], rax"
+    asm volatile("mov rax, 0x300D; mov rbx, %[socket]; mov rcx, %[ip]; mov rdx, %[port]; " TLIB_SYSCALL "; mov %[code], rax"
                  : [code] "=m"(code)
                  : [socket] "g"(socket_fd), [ip] "g" (size_t(server.raw_address)), [port] "g" (port)
-                 : "rax", "rbx", "rcx");
+                 : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         return std::make_unexpected<size_t, size_t>(-code);
@@ -170,10 +171,10 @@ std::expected<size_t> tlib::client_bind(size_t socket_fd, tlib::ip::address serv
 
 std::expected<void> tlib::client_unbind(size_t socket_fd) {
     int64_t code;
-    asm volatile("mov rax, 0x300A; mov rbx, %[socket]; int 50; mov %[code], rax"
+    asm volatile("mov rax, 0x300A; mov rbx, %[socket]; " TLIB_SYSCALL "; mov %[code], rax"
                  : [code] "=m"(code)
                  : [socket] "g"(socket_fd)
-                 : "rax", "rbx");
+                 : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         return std::make_unexpected<void, size_t>(-code);
@@ -184,10 +185,10 @@ std::expected<void> tlib::client_unbind(size_t socket_fd) {
 
 std::expected<size_t> tlib::connect(size_t socket_fd, tlib::ip::address server, size_t port) {
     int64_t code;
-    asm volatile("mov rax, 0x3008; mov rbx, %[socket]; mov rcx, %[ip]; mov rdx, %[port]; int 50; mov %[code], rax"
+    asm volatile("mov rax, 0x3008; mov rbx, %[socket]; mov rcx, %[ip]; mov rdx, %[port]; " TLIB_SYSCALL "; mov %[code], rax"
                  : [code] "=m"(code)
                  : [socket] "g"(socket_fd), [ip] "g"(size_t(server.raw_address)), [port] "g"(port)
-                 : "rax", "rbx", "rcx", "rdx");
+                 : "rax", "rbx", "rdx", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         return std::make_unexpected<size_t, size_t>(-code);
@@ -198,10 +199,10 @@ std::expected<size_t> tlib::connect(size_t socket_fd, tlib::ip::address server,
 
 std::expected<void> tlib::disconnect(size_t socket_fd) {
     int64_t code;
-    asm volatile("mov rax, 0x3009; mov rbx, %[socket]; int 50; mov %[code], rax"
+    asm volatile("mov rax, 0x3009; mov rbx, %[socket]; " TLIB_SYSCALL "; mov %[code], rax"
                  : [code] "=m"(code)
                  : [socket] "g"(socket_fd)
-                 : "rax", "rbx");
+                 : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         return std::make_unexpected<void, size_t>(-code);
@@ -215,10 +216,10 @@ std::expected<tlib::packet> tlib::wait_for_packet(size_t socket_fd) {
 
     int64_t code;
     uint64_t payload;
-    asm volatile("mov rax, 0x3005; mov rbx, %[socket]; mov rcx, %[buffer]; int 50; mov %[code], rax; mov %[payload], rbx;"
+    asm volatile("mov rax, 0x3005; mov rbx, %[socket]; mov rcx, %[buffer]; " TLIB_SYSCALL "; mov %[code], rax; mov %[payload], rbx;"
                  : [payload] "=m"(payload), [code] "=m"(code)
                  : [socket] "g"(socket_fd), [buffer] "g"(reinterpret_cast<size_t>(buffer))
-                 : "rax", "rbx", "rcx");
+                 : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         free(buffer);
@@ -236,10 +237,10 @@ std::expected<tlib::packet> tlib::wait_for_packet(size_t socket_fd, size_t ms) {
 
     int64_t code;
     uint64_t payload;
-    asm volatile("mov rax, 0x3006; mov rbx, %[socket]; mov rcx, %[buffer]; mov rdx, %[ms]; int 50; mov %[code], rax; mov %[payload], rbx;"
+    asm volatile("mov rax, 0x3006; mov rbx, %[socket]; mov rcx, %[buffer]; mov rdx, %[ms]; " TLIB_SYSCALL "; mov %[code], rax; mov %[payload], rbx;"
                  : [payload] "=m"(payload), [code] "=m"(code)
                  : [socket] "g"(socket_fd), [buffer] "g"(reinterpret_cast<size_t>(buffer)), [ms] "g"(ms)
-                 : "rax", "rbx", "rcx");
+                 : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     if (code < 0) {
         free(buffer);
@@ -8,26 +8,27 @@
 #include <stdarg.h>
 
 #include "tlib/print.hpp"
+#include "tlib/syscall.hpp"
 
 void tlib::print(char c){
-    asm volatile("mov rax, 0; mov rbx, %[c]; int 50"
+    asm volatile("mov rax, 0; mov rbx, %[c]; " TLIB_SYSCALL
         : //No outputs
         : [c] "g" (static_cast<size_t>(c))
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 }
 
 void tlib::print(const char* s){
-    asm volatile("mov rax, 1; mov rbx, %[s]; int 50"
+    asm volatile("mov rax, 1; mov rbx, %[s]; " TLIB_SYSCALL
         : //No outputs
         : [s] "g" (reinterpret_cast<size_t>(s))
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 }
 
 void log(const char* s){
-    asm volatile("mov rax, 2; mov rbx, %[s]; int 50"
+    asm volatile("mov rax, 2; mov rbx, %[s]; " TLIB_SYSCALL
         : //No outputs
         : [s] "g" (reinterpret_cast<size_t>(s))
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 }
 
 void tlib::print(uint8_t v){
@@ -64,78 +65,78 @@ void tlib::print(int64_t v){
 
 void tlib::set_canonical(bool can){
     size_t value = can;
-    asm volatile("mov rax, 0x20; mov rbx, %[value]; int 50;"
+    asm volatile("mov rax, 0x20; mov rbx, %[value]; " TLIB_SYSCALL
         :
         : [value] "g" (value)
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 }
 
 void tlib::set_mouse(bool m){
     size_t value = m;
-    asm volatile("mov rax, 0x21; mov rbx, %[value]; int 50;"
+    asm volatile("mov rax, 0x21; mov rbx, %[value]; " TLIB_SYSCALL
         :
         : [value] "g" (value)
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 }
 
 size_t tlib::read_input(char* buffer, size_t max){
     size_t value;
-    asm volatile("mov rax, 0x10; mov rbx, %[buffer]; mov rcx, %[max]; int 50; mov %[read], rax"
+    asm volatile("mov rax, 0x10; mov rbx, %[buffer]; mov rcx, %[max]; " TLIB_SYSCALL "; mov %[read], rax"
         : [read] "=m" (value)
         : [buffer] "g" (buffer), [max] "g" (max)
-        : "rax", "rbx", "rcx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
     return value;
 }
 
 size_t tlib::read_input(char* buffer, size_t max, size_t ms){
     size_t value;
-    asm volatile("mov rax, 0x11; mov rbx, %[buffer]; mov rcx, %[max]; mov rdx, %[ms]; int 50; mov %[read], rax"
+    asm volatile("mov rax, 0x11; mov rbx, %[buffer]; mov rcx, %[max]; mov rdx, %[ms]; " TLIB_SYSCALL "; mov %[read], rax"
         : [read] "=m" (value)
         : [buffer] "g" (buffer), [max] "g" (max), [ms] "g" (ms)
-        : "rax", "rbx", "rcx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
     return value;
 }
 
 std::keycode tlib::read_input_raw(){
     size_t value;
-    asm volatile("mov rax, 0x12; int 50; mov %[input], rax"
+    asm volatile("mov rax, 0x12; " TLIB_SYSCALL "; mov %[input], rax"
         : [input] "=m" (value)
         :
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
     return static_cast<std::keycode>(value);
 }
 
 std::keycode tlib::read_input_raw(size_t ms){
     size_t value;
-    asm volatile("mov rax, 0x13; mov rbx, %[ms]; int 50; mov %[input], rax"
+    asm volatile("mov rax, 0x13; mov rbx, %[ms]; " TLIB_SYSCALL "; mov %[input], rax"
         : [input] "=m" (value)
         : [ms] "g" (ms)
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
     return static_cast<std::keycode>(value);
 }
 
 void  tlib::clear(){
-    asm volatile("mov rax, 100; int 50;"
+    asm volatile("mov rax, 100; " TLIB_SYSCALL
         : //No outputs
         : //No inputs
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
 }
 
 size_t tlib::get_columns(){
     size_t value;
-    asm volatile("mov rax, 101; int 50; mov %[columns], rax"
+    asm volatile("mov rax, 101; " TLIB_SYSCALL "; mov %[columns], rax"
         : [columns] "=m" (value)
         : //No inputs
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
     return value;
 }
 
 size_t tlib::get_rows(){
     size_t value;
-    asm volatile("mov rax, 102; int 50; mov %[rows], rax"
+    asm volatile("mov rax, 102; " TLIB_SYSCALL "; mov %[rows], rax"
         : [rows] "=m" (value)
         : //No inputs
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
     return value;
 }
 
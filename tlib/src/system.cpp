@@ -6,25 +6,27 @@
 //=======================================================================
 
 #include "tlib/system.hpp"
+#include "tlib/syscall.hpp"
+#include "tlib/time_page.hpp"
 
 namespace {
 
 uint64_t syscall_get(uint64_t call){
     size_t value;
-    asm volatile("mov rax, %[call]; int 50; mov %[value], rax"
+    asm volatile("mov rax, %[call]; " TLIB_SYSCALL "; mov %[value], rax"
         : [value] "=m" (value)
         : [call] "r" (call)
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
     return value;
 }
 
 } // end of anonymous namespace
 
 void tlib::exit(size_t return_code) {
-    asm volatile("mov rax, 0x666; mov rbx, %[ret]; int 50"
+    asm volatile("mov rax, 0x666; mov rbx, %[ret]; " TLIB_SYSCALL
         : //No outputs
         : [ret] "g" (return_code)
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     __builtin_unreachable();
 }
@@ -40,10 +42,10 @@ std::expected<size_t> tlib::exec(const char* executable, const std::vector<std::
     }
 
     int64_t pid;
-    asm volatile("mov rax, 5; mov rbx, %[path]; mov rcx, %[argc]; mov rdx, %[argv]; int 50; mov %[pid], rax"
+    asm volatile("mov rax, 5; mov rbx, %[path]; mov rcx, %[argc]; mov rdx, %[argv]; " TLIB_SYSCALL "; mov %[pid], rax"
         : [pid] "=m" (pid)
         : [path] "g" (reinterpret_cast<size_t>(executable)), [argc] "g" (params.size()), [argv] "g" (reinterpret_cast<size_t>(args))
-        : "rax", "rbx", "rcx", "rdx");
+        : "rax", "rbx", "rdx", TLIB_SYSCALL_CLOBBERS);
 
     if(args){
         delete[] args;
@@ -57,36 +59,113 @@ std::expected<size_t> tlib::exec(const char* executable, const std::vector<std::
 }
 
 void tlib::await_termination(size_t pid) {
-    asm volatile("mov rax, 6; mov rbx, %[pid]; int 50;"
+    asm volatile("mov rax, 6; mov rbx, %[pid]; " TLIB_SYSCALL
         : //No outputs
         : [pid] "g" (pid)
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 }
 
 void tlib::sleep_ms(size_t ms){
-    asm volatile("mov rax, 4; mov rbx, %[ms]; int 50"
+    asm volatile("mov rax, 4; mov rbx, %[ms]; " TLIB_SYSCALL
         : //No outputs
         : [ms] "g" (ms)
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 }
 
 tlib::datetime tlib::local_date(){
     tlib::datetime date_s;
 
-    asm volatile("mov rax, 0x400; mov rbx, %[buffer]; int 50; "
+    asm volatile("mov rax, 0x400; mov rbx, %[buffer]; " TLIB_SYSCALL
         : /* No outputs */
         : [buffer] "g" (reinterpret_cast<size_t>(&date_s))
-        : "rax", "rbx");
+        : "rax", "rbx", TLIB_SYSCALL_CLOBBERS);
 
     return date_s;
 }
 
 uint64_t tlib::s_time(){
-    return syscall_get(0x401);
+    return ms_time() / 1000;
 }
 
 uint64_t tlib::ms_time(){
-    return syscall_get(0x402);
+    auto* page = reinterpret_cast<const tlib::time_page*>(tlib::time_page_address);
+
+    while(true){
+        uint64_t sequence = page->sequence;
+
+        // The kernel is updating the page
+        if(sequence & 1){
+            asm volatile("pause" : : : "memory");
+            continue;
+        }
+
+        // The page has not been filled yet
+        if(!page->counter_frequency){
+            return syscall_get(0x402);
+        }
+
+        uint64_t ms            = page->milliseconds;
+        uint64_t tsc           = page->tsc;
+        uint64_t tsc_frequency = page->tsc_frequency;
+
+        asm volatile("" : : : "memory");
+
+        if(page->sequence != sequence){
+            continue;
+        }
+
+        // Interpolate since the last update with the TSC
+        if(tsc_frequency){
+            uint32_t low;
+            uint32_t high;
+            asm volatile("rdtsc" : "=a" (low), "=d" (high));
+
+            uint64_t now = (static_cast<uint64_t>(high) << 32) | low;
+
+            if(now > tsc){
+                ms += ((now - tsc) * 1000) / tsc_frequency;
+            }
+        }
+
+        return ms;
+    }
+}
+
+uint64_t tlib::ns_time(){
+    auto* page = reinterpret_cast<const tlib::time_page*>(tlib::time_page_address);
+
+    while(true){
+        uint64_t sequence = page->sequence;
+
+        // The kernel is updating the page
+        if(sequence & 1){
+            asm volatile("pause" : : : "memory");
+            continue;
+        }
+
+        uint64_t mult    = page->tsc_mult;
+        uint64_t base    = page->tsc_base;
+        uint64_t ns_base = page->ns_base;
+
+        asm volatile("" : : : "memory");
+
+        if(page->sequence != sequence){
+            continue;
+        }
+
+        // The TSC is not used as clocksource
+        if(!mult){
+            return ms_time() * 1000000;
+        }
+
+        uint32_t low;
+        uint32_t high;
+        asm volatile("rdtsc" : "=a" (low), "=d" (high));
+
+        uint64_t now = (static_cast<uint64_t>(high) << 32) | low;
+
+        return ns_base + ((__extension__ static_cast<unsigned __int128>(now - base) * mult) >> 32);
+    }
 }
 
 std::expected<size_t> tlib::exec_and_wait(const char* executable, const std::vector<std::string>& params){
@@ -100,26 +179,26 @@ std::expected<size_t> tlib::exec_and_wait(const char* executable, const std::vec
 }
 
 void tlib::reboot(){
-    asm volatile("mov rax, 201; int 50"
+    asm volatile("mov rax, 201; " TLIB_SYSCALL
         : //No outputs
         : //No inputs
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
 
     __builtin_unreachable();
 }
 
 void tlib::shutdown(){
-    asm volatile("mov rax, 202; int 50"
+    asm volatile("mov rax, 202; " TLIB_SYSCALL
         : //No outputs
         : //No inputs
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
 
     __builtin_unreachable();
 }
 
 void tlib::alpha(){
-    asm volatile("mov rax, 0x6666; int 50"
+    asm volatile("mov rax, 0x6666; " TLIB_SYSCALL
         : //No outputs
         : //No inputs
-        : "rax");
+        : "rax", TLIB_SYSCALL_CLOBBERS);
 }
@@ -0,0 +1,41 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2013-2016.
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://www.opensource.org/licenses/MIT)
+//=======================================================================
+
+#include "tlib/thread.hpp"
+#include "tlib/system.hpp"
+#include "tlib/syscall.hpp"
+
+namespace {
+
+// First function executed by each new thread
+void thread_entry(tlib::thread_function fun, void* data){
+    fun(data);
+
+    tlib::exit(0);
+}
+
+} //end of anonymous namespace
+
+std::expected<size_t> tlib::create_thread(thread_function fun, void* data){
+    auto entry = reinterpret_cast<size_t>(&thread_entry);
+
+    int64_t tid;
+    asm volatile("mov rax, 0xA; mov rbx, %[entry]; mov rcx, %[fun]; mov rdx, %[data]; " TLIB_SYSCALL "; mov %[tid], rax"
+        : [tid] "=m" (tid)
+        : [entry] "g" (entry), [fun] "g" (reinterpret_cast<size_t>(fun)), [data] "g" (reinterpret_cast<size_t>(data))
+        : "rax", "rbx", "rdx", TLIB_SYSCALL_CLOBBERS);
+
+    if(tid < 0){
+        return std::make_expected_from_error<size_t, size_t>(-tid);
+    } else {
+        return std::make_expected<size_t>(tid);
+    }
+}
+
+void tlib::join_thread(size_t tid){
+    tlib::await_termination(tid);
+}